@@ -0,0 +1,208 @@
+# Finds the addresses of the memory card SDK functions the mod uses that
+# aren't in the symbol maps (CARDCreateAsync, CARDWriteAsync) in a region's
+# main.dol, and adds them to that region's symbol list (ttyd.<region>.lst).
+#
+# Usage: python cardsyms.py [options] <region>=<main.dol> ...
+#
+#   <region>=<file>  e.g. us=extracted_us/sys/main.dol.
+#   --lst=<dir>      Where the symbol lists are (defaults to ../rel/include).
+#   --dry-run        Print the addresses found without writing the lists.
+#
+# Starts from the region's known card.a symbols. CARDCreate.c, CARDRead.c and
+# CARDWrite.c are linked in that order, and each ends with a synchronous
+# wrapper that calls its async function, then __CARDSync; so the wrapper
+# calling CARDReadAsync gives __CARDSync, and the calls to __CARDSync nearest
+# to it are preceded by calls to CARDCreateAsync and CARDWriteAsync. Each
+# candidate is then checked against what the function is known to call
+# (__CARDGetControlBlock, as CARDOpen does; __CARDSeek, as CARDReadAsync
+# does). Exits non-zero, writing nothing, if any region's checks fail.
+
+import os
+import re
+import struct
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_LST_DIR = os.path.join(SCRIPT_DIR, "..", "rel", "include")
+
+# How far from CARDReadAsync to search (in instructions).
+SCAN_WINDOW = 0x800
+# How many instructions before a call to __CARDSync to look for the call to
+# the async function.
+CALL_LOOKBACK = 8
+# How far into a function to look for the calls it's checked by.
+CHECK_WINDOW = 0x40
+INSTRUCTION_BLR = 0x4e800020
+INSTRUCTION_MFLR_R0 = 0x7c0802a6
+
+class Dol:
+	def __init__(self, data):
+		self.data = data
+		# (address, file offset, size) of each text / data section.
+		self.sections = []
+		for i in range(18):
+			(offset,) = struct.unpack_from(">I", data, i * 4)
+			(address,) = struct.unpack_from(">I", data, 0x48 + i * 4)
+			(size,) = struct.unpack_from(">I", data, 0x90 + i * 4)
+			if size:
+				self.sections.append((address, offset, size))
+
+	def word(self, address):
+		for (start, offset, size) in self.sections:
+			if start <= address < start + size:
+				(value,) = struct.unpack_from(">I", self.data, offset + address - start)
+				return value
+		raise ValueError("%08x isn't in the DOL" % address)
+
+	def call_target(self, address):
+		# Returns the target of the instruction at `address` if it's a `bl`.
+		instruction = self.word(address)
+		if instruction & 0xfc000003 != 0x48000001:
+			return None
+		offset = instruction & 0x03fffffc
+		if offset & 0x02000000:
+			offset -= 0x04000000
+		return (address + offset) & 0xffffffff
+
+	def calls(self, function, limit=CHECK_WINDOW):
+		# Returns the targets of the calls near the start of a function.
+		targets = []
+		for i in range(limit):
+			address = function + i * 4
+			if self.word(address) == INSTRUCTION_BLR:
+				break
+			target = self.call_target(address)
+			if target is not None:
+				targets.append(target)
+		return targets
+
+	def previous_call(self, address):
+		for i in range(1, CALL_LOOKBACK + 1):
+			target = self.call_target(address - i * 4)
+			if target is not None:
+				return target
+		return None
+
+	def has_prologue(self, function):
+		# stwu r1, -x(r1), then mflr r0 (or the other way around).
+		words = (self.word(function), self.word(function + 4))
+		return INSTRUCTION_MFLR_R0 in words and any(w >> 16 == 0x9421 for w in words)
+
+def read_symbols(filename):
+	symbols = {}
+	with open(filename) as f:
+		for line in f:
+			match = re.match(r"([0-9a-fA-F]{8}):(\w+)", line.strip())
+			if match:
+				symbols[match.group(2)] = int(match.group(1), 16)
+	return symbols
+
+def find_card_symbols(dol, symbols):
+	# Returns {name: address}, or raises ValueError if any check fails.
+	for name in ("CARDOpen", "CARDReadAsync"):
+		if name not in symbols:
+			raise ValueError("%s isn't in the symbol list" % name)
+	card_open = symbols["CARDOpen"]
+	read_async = symbols["CARDReadAsync"]
+	open_calls = dol.calls(card_open)
+	read_calls = dol.calls(read_async)
+	if not open_calls or not read_calls:
+		raise ValueError("CARDOpen / CARDReadAsync don't call anything")
+	get_control_block = open_calls[0]
+	card_seek = read_calls[0]
+
+	# The synchronous CARDRead calls CARDReadAsync, then __CARDSync.
+	end = read_async + SCAN_WINDOW * 4
+	address = read_async
+	while address < end and dol.call_target(address) != read_async:
+		address += 4
+	card_sync = None
+	for address in range(address + 4, end, 4):
+		card_sync = dol.call_target(address)
+		if card_sync is not None:
+			break
+	if card_sync is None:
+		raise ValueError("no CARDRead after CARDReadAsync")
+
+	write_async = None
+	for address in range(address + 4, end, 4):
+		if dol.call_target(address) == card_sync:
+			write_async = dol.previous_call(address)
+			break
+	create_async = None
+	for address in range(read_async - 4, read_async - SCAN_WINDOW * 4, -4):
+		if dol.call_target(address) == card_sync:
+			create_async = dol.previous_call(address)
+			break
+
+	if create_async is None or not card_open < create_async < read_async:
+		raise ValueError("CARDCreateAsync not found between CARDOpen and CARDReadAsync")
+	if write_async is None or write_async <= read_async:
+		raise ValueError("CARDWriteAsync not found after CARDReadAsync")
+	if not dol.has_prologue(create_async) or get_control_block not in dol.calls(create_async):
+		raise ValueError("%08x doesn't look like CARDCreateAsync" % create_async)
+	if not dol.has_prologue(write_async) or card_seek not in dol.calls(write_async):
+		raise ValueError("%08x doesn't look like CARDWriteAsync" % write_async)
+	return {"CARDCreateAsync": create_async, "CARDWriteAsync": write_async}
+
+def update_lst(filename, found):
+	# Adds (or replaces) each symbol's section after the card.a section of
+	# the file it follows in the link order.
+	sections = (
+		("CARDCreateAsync", "CARDCreate.c", "CARDOpen.c"),
+		("CARDWriteAsync", "CARDWrite.c", "CARDRead.c"),
+	)
+	with open(filename) as f:
+		lines = f.read().split("\n")
+	for (name, source, previous) in sections:
+		# Drops the old entry, or the placeholder left until this is run.
+		lines = [l for l in lines if not re.match(r"([0-9a-fA-F]{8}:|// )%s\b" % name, l)]
+		header = "// card.a %s" % source
+		if header in lines:
+			lines.insert(lines.index(header) + 1, "%08x:%s" % (found[name], name))
+			continue
+		# After the previous file's section (and the blank line ending it).
+		pos = lines.index("// card.a %s" % previous)
+		while lines[pos]:
+			pos += 1
+		lines[pos + 1:pos + 1] = [header, "%08x:%s" % (found[name], name), ""]
+	with open(filename, "w") as f:
+		f.write("\n".join(lines))
+
+def main(argc, argv):
+	options = {}
+	regions = {}
+	for arg in argv[1:]:
+		if arg.startswith("--"):
+			(key, _, value) = arg[2:].partition("=")
+			options[key] = value
+		elif "=" in arg:
+			(region, dol_file) = arg.split("=", 1)
+			regions[region.lower()] = dol_file
+		else:
+			sys.exit("Expected <region>=<main.dol>, got '%s'." % arg)
+	if not regions:
+		sys.exit("Usage: python cardsyms.py [options] <region>=<main.dol> ...")
+
+	lst_dir = options.get("lst", DEFAULT_LST_DIR)
+	results = {}
+	for (region, dol_file) in sorted(regions.items()):
+		lst_file = os.path.join(lst_dir, "ttyd.%s.lst" % region)
+		with open(dol_file, "rb") as f:
+			dol = Dol(f.read())
+		try:
+			results[region] = find_card_symbols(dol, read_symbols(lst_file))
+		except ValueError as e:
+			sys.exit("%s: %s" % (region, e))
+		for (name, address) in sorted(results[region].items()):
+			print("%s: %08x:%s" % (region, address, name))
+
+	if "dry-run" not in options:
+		for (region, found) in sorted(results.items()):
+			lst_file = os.path.join(lst_dir, "ttyd.%s.lst" % region)
+			update_lst(lst_file, found)
+			print("Updated %s." % lst_file)
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main(len(sys.argv), sys.argv))
@@ -0,0 +1,412 @@
+# Validates the Pit's enemy data (pit_enemies.txt) and generates the constexpr
+# tables used by rel/source/randomizer_data.cpp from it.
+#
+# Usage: python enemygen.py [pit_enemies.txt] [randomizer_enemy_tables.inc]
+#
+# By default, reads pit_enemies.txt from this directory and writes
+# ../rel/source/randomizer_enemy_tables.inc. Names of unit types, modules and
+# events are checked against the mod's headers in ../rel/include.
+
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+INCLUDE_DIR = os.path.join(SCRIPT_DIR, "..", "rel", "include")
+DEFAULT_INPUT = os.path.join(SCRIPT_DIR, "pit_enemies.txt")
+DEFAULT_OUTPUT = os.path.normpath(os.path.join(
+	SCRIPT_DIR, "..", "rel", "source", "randomizer_enemy_tables.inc"))
+
+NUM_FLOOR_GROUPS = 11
+# Level offsets given base weights by `floors` records.
+MIN_WEIGHTED_LEVEL = 2
+MAX_WEIGHTED_LEVEL = 10
+MAX_LOADOUT_SIZE = 5
+NUM_DROP_TABLES = 5
+NUM_AUDIENCE_TYPES = 12
+NPC_EVENT_KINDS = ["init", "move", "dead", "find", "lost", "return", "blow"]
+
+# Spawn flags, and their names in EnemySpawn_Flags.
+SPAWN_FLAGS = {
+	"special": "kSpecial",
+	"needs_damaging_sp": "kNeedsDamagingSp",
+	"yux": "kYux",
+	"no_ceiling": "kNoCeiling",
+	"may_fly": "kMayFly",
+}
+
+class DataError(Exception):
+	pass
+
+def read_enum_names(header, namespace):
+	with open(os.path.join(INCLUDE_DIR, header)) as f:
+		text = f.read()
+	match = re.search(
+		r"namespace %s \{\s*enum e \{(.*?)\};" % namespace, text, re.S)
+	if not match:
+		raise DataError("couldn't find %s in %s" % (namespace, header))
+	body = re.sub(r"//.*", "", match.group(1))
+	return set(re.findall(r"^\s*([A-Z][A-Z0-9_]*)\b", body, re.M))
+
+def read_event_names():
+	with open(os.path.join(INCLUDE_DIR, "ttyd", "npc_event.h")) as f:
+		return set(re.findall(r"extern int32_t (\w+_event);", f.read()))
+
+def parse_int(token, line_num, lo, hi, what):
+	try:
+		value = int(token, 0)
+	except ValueError:
+		raise DataError("line %d: bad %s '%s'" % (line_num, what, token))
+	if value < lo or value > hi:
+		raise DataError(
+			"line %d: %s %d out of range [%d, %d]" %
+			(line_num, what, value, lo, hi))
+	return value
+
+def expect_fields(fields, count, line_num, usage):
+	if len(fields) != count:
+		raise DataError("line %d: expected `%s`" % (line_num, usage))
+
+class EnemyData:
+	def __init__(self):
+		self.unit_types = read_enum_names(
+			os.path.join("ttyd", "battle_database_common.h"), "BattleUnitType")
+		self.modules = read_enum_names("common_types.h", "ModuleId")
+		self.events = read_event_names()
+		self.floor_groups = {}
+		self.npcs = []
+		self.npc_index = {}
+		self.enemies = []
+		self.enemy_index = {}
+		self.spawns = []
+		self.spawn_index = {}
+		self.loadouts = []
+		self.loadout_index = {}
+
+	def parse(self, filename):
+		with open(filename) as f:
+			for line_num, line in enumerate(f, 1):
+				fields = line.split("#", 1)[0].split()
+				if not fields:
+					continue
+				parser = getattr(self, "parse_" + fields[0], None)
+				if not parser:
+					raise DataError(
+						"line %d: unknown record type '%s'" %
+						(line_num, fields[0]))
+				parser(fields[1:], line_num)
+		self.validate()
+
+	def parse_floors(self, fields, line_num):
+		num_weights = MAX_WEIGHTED_LEVEL - MIN_WEIGHTED_LEVEL + 1
+		expect_fields(
+			fields, 2 + num_weights, line_num,
+			"floors <group> <target> <weight x %d>" % num_weights)
+		group = parse_int(
+			fields[0], line_num, 0, NUM_FLOOR_GROUPS - 1, "floor group")
+		if group in self.floor_groups:
+			raise DataError(
+				"line %d: floor group %d already defined" % (line_num, group))
+		target = parse_int(fields[1], line_num, 1, 127, "target level sum")
+		weights = [
+			parse_int(x, line_num, 0, 127, "weight") for x in fields[2:]]
+		self.floor_groups[group] = (target, weights)
+
+	def parse_npc(self, fields, line_num):
+		expect_fields(
+			fields, 1 + len(NPC_EVENT_KINDS), line_num,
+			"npc <name> <%s events>" % " ".join(NPC_EVENT_KINDS))
+		name = fields[0]
+		if name in self.npc_index:
+			raise DataError(
+				"line %d: npc '%s' already defined" % (line_num, name))
+		events = []
+		for event in fields[1:]:
+			if event == "-":
+				events.append(None)
+			elif event not in self.events:
+				raise DataError(
+					"line %d: unknown event '%s'" % (line_num, event))
+			else:
+				events.append(event)
+		self.npc_index[name] = len(self.npcs)
+		self.npcs.append((name, events))
+
+	def parse_enemy(self, fields, line_num):
+		expect_fields(
+			fields, 11, line_num,
+			"enemy <unit_type> <tribe> <hp> <atk> <def> <atk_base> "
+			"<atk_offset> <level> <audience> <hp_drops> <fp_drops>")
+		unit_type = fields[0]
+		if unit_type not in self.unit_types:
+			raise DataError(
+				"line %d: unknown unit type '%s'" % (line_num, unit_type))
+		if unit_type in self.enemy_index:
+			raise DataError(
+				"line %d: enemy '%s' already defined" % (line_num, unit_type))
+		enemy = {
+			"unit_type": unit_type,
+			"tribe": parse_int(fields[1], line_num, -1, 0x7fff, "tribe"),
+			"hp": parse_int(fields[2], line_num, 0, 0x7fff, "hp scale"),
+			"atk": parse_int(fields[3], line_num, 0, 0x7fff, "atk scale"),
+			"def": parse_int(fields[4], line_num, 0, 0x7fff, "def scale"),
+			"atk_base": parse_int(fields[5], line_num, 0, 99, "atk base"),
+			"atk_offset": parse_int(
+				fields[6], line_num, -99, 99, "atk offset"),
+			"level": parse_int(fields[7], line_num, 0, 127, "level"),
+			"audience": parse_int(
+				fields[8], line_num, -1, NUM_AUDIENCE_TYPES - 1,
+				"audience type"),
+			"hp_drops": parse_int(
+				fields[9], line_num, 1, NUM_DROP_TABLES, "hp drop table"),
+			"fp_drops": parse_int(
+				fields[10], line_num, 1, NUM_DROP_TABLES, "fp drop table"),
+		}
+		self.enemy_index[unit_type] = len(self.enemies)
+		self.enemies.append(enemy)
+
+	def parse_spawn(self, fields, line_num):
+		if len(fields) < 3:
+			raise DataError(
+				"line %d: expected `spawn <UNIT@MODULE> <setup_offset> "
+				"<npc> [flags]`" % line_num)
+		name = fields[0]
+		if name.count("@") != 1:
+			raise DataError(
+				"line %d: spawn '%s' should be UNIT@MODULE" % (line_num, name))
+		unit_type, module = name.split("@")
+		if unit_type not in self.enemy_index:
+			raise DataError(
+				"line %d: no enemy stats for '%s'" % (line_num, unit_type))
+		if module not in self.modules:
+			raise DataError(
+				"line %d: unknown module '%s'" % (line_num, module))
+		if name in self.spawn_index:
+			raise DataError(
+				"line %d: spawn '%s' already defined" % (line_num, name))
+		offset = parse_int(
+			fields[1], line_num, 0, 0x7fffffff, "setup offset")
+		if offset % 4:
+			raise DataError(
+				"line %d: setup offset %#x is misaligned" % (line_num, offset))
+		npc = fields[2]
+		if npc != "-":
+			if npc not in self.npc_index:
+				raise DataError("line %d: unknown npc '%s'" % (line_num, npc))
+			if self.enemies[self.enemy_index[unit_type]]["tribe"] < 0:
+				raise DataError(
+					"line %d: '%s' can't lead without an npc tribe" %
+					(line_num, unit_type))
+		flags = []
+		unit_kind = 0
+		for flag in fields[3:]:
+			if flag.startswith("unit_kind="):
+				unit_kind = parse_int(
+					flag[len("unit_kind="):], line_num,
+					0x80000000, 0x817fffff, "unit_kind address")
+			elif flag in SPAWN_FLAGS:
+				flags.append(flag)
+			else:
+				raise DataError(
+					"line %d: unknown spawn flag '%s'" % (line_num, flag))
+		if "no_ceiling" in flags and "may_fly" in flags:
+			raise DataError(
+				"line %d: no_ceiling and may_fly are exclusive" % line_num)
+		self.spawn_index[name] = len(self.spawns)
+		self.spawns.append({
+			"name": name,
+			"symbol": name.replace("@", "_"),
+			"unit_type": unit_type,
+			"module": module,
+			"offset": offset,
+			"npc": npc,
+			"flags": flags,
+			"unit_kind": unit_kind,
+		})
+
+	def parse_loadout(self, fields, line_num):
+		if len(fields) < 2:
+			raise DataError(
+				"line %d: expected `loadout <name> <spawns> "
+				"[fallback=<name>]`" % line_num)
+		name = fields[0]
+		if name in self.loadout_index:
+			raise DataError(
+				"line %d: loadout '%s' already defined" % (line_num, name))
+		spawns = []
+		fallback = None
+		for token in fields[1:]:
+			if token.startswith("fallback="):
+				fallback = token[len("fallback="):]
+			elif token not in self.spawn_index:
+				raise DataError(
+					"line %d: unknown spawn '%s'" % (line_num, token))
+			else:
+				spawns.append(token)
+		if not spawns or len(spawns) > MAX_LOADOUT_SIZE:
+			raise DataError(
+				"line %d: loadouts need 1 ~ %d spawns" %
+				(line_num, MAX_LOADOUT_SIZE))
+		if self.spawns[self.spawn_index[spawns[0]]]["npc"] == "-":
+			raise DataError(
+				"line %d: '%s' can't lead a loadout" % (line_num, spawns[0]))
+		self.loadout_index[name] = len(self.loadouts)
+		self.loadouts.append({
+			"name": name,
+			"spawns": spawns,
+			"fallback": fallback,
+			"line_num": line_num,
+		})
+
+	def loadout_needs_damaging_sp(self, loadout):
+		return any(
+			"needs_damaging_sp" in self.spawns[self.spawn_index[s]]["flags"]
+			for s in loadout["spawns"])
+
+	def validate(self):
+		missing = set(range(NUM_FLOOR_GROUPS)) - set(self.floor_groups)
+		if missing:
+			raise DataError(
+				"floor groups %s not defined" %
+				", ".join(str(x) for x in sorted(missing)))
+		if not self.spawns:
+			raise DataError("no spawns defined")
+		if len(self.spawns) > 0x7fff:
+			raise DataError("too many spawns")
+		if not self.loadouts:
+			raise DataError("no loadouts defined")
+		for loadout in self.loadouts:
+			fallback = loadout["fallback"]
+			needs_sp = self.loadout_needs_damaging_sp(loadout)
+			if fallback is None:
+				if needs_sp:
+					raise DataError(
+						"line %d: loadout '%s' needs a fallback=, since it "
+						"has needs_damaging_sp spawns" %
+						(loadout["line_num"], loadout["name"]))
+				continue
+			if fallback not in self.loadout_index:
+				raise DataError(
+					"line %d: unknown fallback loadout '%s'" %
+					(loadout["line_num"], fallback))
+			if self.loadout_needs_damaging_sp(
+					self.loadouts[self.loadout_index[fallback]]):
+				raise DataError(
+					"line %d: fallback loadout '%s' has needs_damaging_sp "
+					"spawns" % (loadout["line_num"], fallback))
+
+	# Base weight of a spawn for a given floor group, before the modules loaded
+	# for the floor (and the player's Star Powers) are taken into account.
+	def base_weight(self, spawn, group):
+		if "special" in spawn["flags"]:
+			return 0
+		level = self.enemies[self.enemy_index[spawn["unit_type"]]]["level"]
+		if level < MIN_WEIGHTED_LEVEL or level > MAX_WEIGHTED_LEVEL:
+			return 0
+		return self.floor_groups[group][1][level - MIN_WEIGHTED_LEVEL]
+
+def event_ref(event):
+	return "&" + event if event else "nullptr"
+
+def drop_table_ref(kind, index):
+	suffix = str(index) if index > 1 else ""
+	return "&battle_%s_drop_param_default%s" % (kind, suffix)
+
+def write_tables(data, out):
+	w = out.write
+	w("// Generated by enemygen.py from pit_enemies.txt; do not edit by hand.\n")
+	w("// Included inside randomizer_data.cpp's anonymous namespace.\n")
+	w("\n")
+
+	w("// Enemies that can be spawned (indices of kEnemyModuleInfo).\n")
+	w("namespace EnemySpawn {\n")
+	w("    enum e {\n")
+	for i, spawn in enumerate(data.spawns):
+		w("        %s = %d,\n" % (spawn["symbol"], i))
+	w("    };\n")
+	w("}\n")
+	w("constexpr const int32_t kNumEnemySpawns = %d;\n" % len(data.spawns))
+	w("constexpr const int32_t kNumFloorGroups = %d;\n" % NUM_FLOOR_GROUPS)
+	w("\n")
+
+	w("constexpr const NpcEntTypeInfo kNpcInfo[] = {\n")
+	for name, events in data.npcs:
+		w("    // %s\n" % name)
+		w("    { %s },\n" % ", ".join(event_ref(e) for e in events))
+	w("};\n")
+	w("\n")
+
+	w("constexpr const EnemyTypeInfo kEnemyInfo[] = {\n")
+	for e in data.enemies:
+		w("    { BattleUnitType::%s, %d, %d, %d, %d, %d, %d, %d, %d, %s, %s },\n" %
+		  (e["unit_type"], e["tribe"], e["hp"], e["atk"], e["def"],
+		   e["atk_base"], e["atk_offset"], e["level"], e["audience"],
+		   drop_table_ref("heart", e["hp_drops"]),
+		   drop_table_ref("flower", e["fp_drops"])))
+	w("    { /* invalid enemy */ },\n")
+	w("};\n")
+	w("\n")
+
+	w("constexpr const EnemyModuleInfo kEnemyModuleInfo[kNumEnemySpawns] = {\n")
+	for spawn in data.spawns:
+		npc = spawn["npc"]
+		npc_idx = data.npc_index[npc] if npc != "-" else -1
+		flags = " | ".join(
+			"EnemySpawn_Flags::" + SPAWN_FLAGS[f] for f in spawn["flags"])
+		w("    // %s\n" % spawn["symbol"])
+		w("    { BattleUnitType::%s, ModuleId::%s, %#x, %d, %d, %#x, %s },\n" %
+		  (spawn["unit_type"], spawn["module"], spawn["offset"], npc_idx,
+		   data.enemy_index[spawn["unit_type"]], spawn["unit_kind"],
+		   flags or "0"))
+	w("};\n")
+	w("\n")
+
+	w("constexpr const PresetLoadout kPresetLoadouts[] = {\n")
+	for loadout in data.loadouts:
+		spawns = ["EnemySpawn::" + data.spawns[data.spawn_index[s]]["symbol"]
+				  for s in loadout["spawns"]]
+		spawns += ["-1"] * (MAX_LOADOUT_SIZE - len(spawns))
+		fallback = loadout["fallback"]
+		w("    // %s%s\n" % (
+			loadout["name"],
+			" (falls back to %s)" % fallback if fallback else ""))
+		w("    { { %s }, %d },\n" % (
+			", ".join(spawns),
+			data.loadout_index[fallback] if fallback else -1))
+	w("};\n")
+	w("\n")
+
+	w("// The target sum of enemy level_offsets for each floor group.\n")
+	w("constexpr const int8_t kTargetLevelSums[kNumFloorGroups] = {\n")
+	w("    %s\n" % ", ".join(
+		str(data.floor_groups[g][0]) for g in range(NUM_FLOOR_GROUPS)))
+	w("};\n")
+	w("\n")
+
+	w("// Base weights of each spawn per floor group (00s, 10s, ...), from its\n")
+	w("// level_offset; special enemies and other levels have no weight.\n")
+	w("constexpr const int8_t kSpawnBaseWeights[kNumFloorGroups][kNumEnemySpawns] = {\n")
+	for group in range(NUM_FLOOR_GROUPS):
+		weights = [str(data.base_weight(s, group)) for s in data.spawns]
+		w("    {\n")
+		for i in range(0, len(weights), 20):
+			w("        %s,\n" % ", ".join(weights[i:i + 20]))
+		w("    },\n")
+	w("};\n")
+
+def main(argc, argv):
+	input_file = argv[1] if argc > 1 else DEFAULT_INPUT
+	output_file = argv[2] if argc > 2 else DEFAULT_OUTPUT
+	data = EnemyData()
+	try:
+		data.parse(input_file)
+	except DataError as e:
+		print("%s: %s" % (input_file, e))
+		sys.exit(1)
+	with open(output_file, "w") as out:
+		write_tables(data, out)
+	print("Wrote %d enemies, %d spawns and %d loadouts to %s." % (
+		len(data.enemies), len(data.spawns), len(data.loadouts), output_file))
+
+if __name__ == "__main__":
+	main(len(sys.argv), sys.argv)
@@ -0,0 +1,134 @@
+# Prints the results of the evt profiler (rel/source/evt_profiler.cpp) from a
+# dump of MEM1 taken while running a profiling build (`make PROFILE=1`).
+#
+# Usage: python evtprof.py <mem1.raw> <ttyd.us.lst> [num_scripts]
+
+import os
+import sys
+import struct
+
+MEM1_BASE = 0x80000000
+DUMP_MAGIC = b"EVTP"
+DUMP_VERSION = 1
+NUM_OPCODES = 0x77
+MAX_DUMP_SCRIPTS = 32
+HEADER_SIZE = 11 * 4
+SCRIPT_SIZE = 7 * 4
+OSTIME_TICKS_PER_USEC = 40.5
+
+MODULE_NAMES = [
+	None, "aaa", "aji", "bom", "dmo", "dou", "eki", "end",
+	"gon", "gor", "gra", "hei", "hom", "jin", "jon", "kpa",
+	"las", "moo", "mri", "muj", "nok", "pik", "rsh", "sys",
+	"tik", "tou", "tou2", "usu", "win", "yuu"
+]
+
+def load_symbols(filename):
+	symbols = []
+	for line in open(filename, "r"):
+		line = line.strip()
+		if not line or line.startswith("//"):
+			continue
+		address, name = line.split(":", 1)
+		symbols.append((int(address, 16), name))
+	symbols.sort()
+	return symbols
+
+def load_mnemonics():
+	# Opcode names from the table in docs/ttyd-opc-summary.txt, if present.
+	mnemonics = {}
+	filename = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "docs", "ttyd-opc-summary.txt")
+	if not os.path.exists(filename):
+		return mnemonics
+	for line in open(filename, "r"):
+		fields = [field.strip() for field in line.split("|")]
+		if len(fields) < 5 or not fields[2].isdigit():
+			continue
+		mnemonics[int(fields[2])] = fields[3] or fields[4]
+	return mnemonics
+
+def read_string(mem, address):
+	offset = address - MEM1_BASE
+	if offset < 0 or offset >= len(mem):
+		return None
+	end = mem.find(b"\0", offset, offset + 64)
+	if end < 0:
+		return None
+	return mem[offset:end].decode("ascii", "replace")
+
+def symbolize(address, symbols, modules):
+	# Scripts in relocatable modules are shown relative to the module's base.
+	best_module = None
+	for base, module_id in modules:
+		if base and address >= base and (not best_module or base > best_module[0]):
+			best_module = (base, module_id)
+	if best_module and address - best_module[0] < 0x100000:
+		module_id = best_module[1]
+		name = MODULE_NAMES[module_id] if module_id < len(MODULE_NAMES) else "rel%d" % module_id
+		return "%s+%x" % (name, address - best_module[0])
+	# Otherwise, look for the closest preceding symbol in the main executable.
+	best = None
+	for symbol_address, name in symbols:
+		if symbol_address > address:
+			break
+		best = (symbol_address, name)
+	if best and address - best[0] < 0x10000:
+		if address == best[0]:
+			return best[1]
+		return "%s+%x" % (best[1], address - best[0])
+	return "%08x" % address
+
+mem = open(sys.argv[1], "rb").read()
+symbols = load_symbols(sys.argv[2])
+num_to_print = int(sys.argv[3]) if len(sys.argv) > 3 else MAX_DUMP_SCRIPTS
+
+# Find the dump buffer by its magic number and version.
+offset = 0
+while True:
+	offset = mem.find(DUMP_MAGIC, offset)
+	if offset < 0:
+		sys.exit("No evt profiler results found; is this a profiling build?")
+	if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == DUMP_VERSION:
+		break
+	offset += 4
+
+(magic, version, window_frames, windows_published, num_scripts,
+ untracked_ticks, total_ticks, rel_file_base, rel_file_id,
+ map_alloc_base, map_alloc_id) = struct.unpack(">4s10L", mem[offset:offset+HEADER_SIZE])
+opcode_counts = struct.unpack(">%dL" % NUM_OPCODES,
+	mem[offset+HEADER_SIZE:offset+HEADER_SIZE+4*NUM_OPCODES])
+modules = [(rel_file_base, rel_file_id), (map_alloc_base, map_alloc_id)]
+
+if not windows_published:
+	sys.exit("Profiler has not published any results yet.")
+
+def usec(ticks):
+	return ticks / OSTIME_TICKS_PER_USEC / window_frames
+
+print("Window: %d frames (#%d); evt total %.1f us/frame, untracked %.1f us/frame" %
+	(window_frames, windows_published, usec(total_ticks), usec(untracked_ticks)))
+print("")
+print("%-40s %10s %8s %8s %8s %10s" %
+	("script", "us/frame", "ops/fr", "ufn/fr", "runs/fr", "max us"))
+
+script_offset = offset + HEADER_SIZE + 4 * NUM_OPCODES
+for i in range(min(num_scripts, num_to_print)):
+	(evt_code, name_ptr, dispatches, instructions, user_funcs, ticks,
+	 max_ticks) = struct.unpack(">7L",
+		mem[script_offset + i * SCRIPT_SIZE:script_offset + (i + 1) * SCRIPT_SIZE])
+	name = read_string(mem, name_ptr) if name_ptr else None
+	if not name:
+		name = symbolize(evt_code, symbols, modules)
+	print("%-40s %10.1f %8.1f %8.1f %8.1f %10.1f" % (
+		name[:40], usec(ticks), instructions / window_frames,
+		user_funcs / window_frames, dispatches / window_frames,
+		max_ticks / OSTIME_TICKS_PER_USEC))
+
+print("")
+print("Most executed opcodes (per frame):")
+mnemonics = load_mnemonics()
+ranked = sorted(range(NUM_OPCODES), key=lambda op: -opcode_counts[op])
+for op in ranked[:16]:
+	if not opcode_counts[op]:
+		break
+	print("  0x%02x %-20s %.1f" % (op, mnemonics.get(op, ""), opcode_counts[op] / window_frames))
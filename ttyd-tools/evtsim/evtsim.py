@@ -0,0 +1,713 @@
+# Host-side interpreter for the mod's custom evt scripts.
+#
+# Reads the EVT_BEGIN(...) / EVT_END() blocks from a source file, encodes them
+# using the command macros in rel/include/evt_cmd.h, and runs them against
+# mocked USER_FUNCs and in-memory LW / LF / GW / GF / GSW / GSWF / LSW / LSWF
+# storage, counting instructions, frames and USER_FUNC calls along the way.
+#
+# Usage:
+#   python evtsim.py <source.cpp> --list
+#   python evtsim.py <source.cpp> <ScriptName> [options]
+#
+# Options:
+#   --set VAR=VALUE      Initial value of a variable, e.g. --set GSW(1321)=9
+#   --mock FUNC=V[,V..]  Values a USER_FUNC writes to its last argument on
+#                        successive calls (the last value repeats), e.g.
+#                        --mock CheckRewardClaimed=1
+#   --sweep VAR=LO:HI    Runs the script once per value in [LO, HI) and
+#                        prints a one-line summary of each path.
+#   --trace              Prints each instruction as it is executed.
+#   --max-frames N       Stops runaway scripts after N frames (default 600).
+#
+# Unmocked USER_FUNCs, and scripts / functions living outside the source file
+# (REL_PTR(...), raw addresses, vanilla evts), are logged and treated as
+# completing immediately without side effects.
+#
+# The Simulator class can also be imported and driven from Python, with
+# callables registered in Simulator.mocks for more involved USER_FUNCs.
+
+import os
+import re
+import sys
+import time
+
+EVT_CMD_HEADER = os.path.join(
+	os.path.dirname(os.path.abspath(__file__)), "..", "rel", "include", "evt_cmd.h")
+
+# Expression bases from evt_cmd.h, in the order evtGetValue checks them.
+LW_BASE = -30000000
+GW_BASE = -50000000
+LF_BASE = -70000000
+GF_BASE = -90000000
+LSWF_BASE = -110000000
+GSWF_BASE = -130000000
+LSW_BASE = -150000000
+GSW_BASE = -170000000
+UW_BASE = -190000000
+UF_BASE = -210000000
+FLOAT_BASE = -230000000
+POINTER_BASE = -250000000
+
+VAR_BASES = {
+	"LW": LW_BASE, "GW": GW_BASE, "LF": LF_BASE, "GF": GF_BASE,
+	"LSWF": LSWF_BASE, "GSWF": GSWF_BASE, "LSW": LSW_BASE, "GSW": GSW_BASE,
+	"UW": UW_BASE, "UF": UF_BASE,
+}
+
+# Opcodes with special handling in the interpreter.
+OP_END = 1
+OP_RETURN = 2
+OP_LBL = 3
+OP_GOTO = 4
+OP_DO = 5
+OP_WHILE = 6
+OP_DO_BREAK = 7
+OP_DO_CONTINUE = 8
+OP_WAIT_FRM = 9
+OP_WAIT_MSEC = 10
+OP_HALT = 11
+OP_ELSE = 32
+OP_END_IF = 33
+OP_SWITCH = 34
+OP_SWITCHI = 35
+OP_CASE_ETC = 42
+OP_CASE_OR = 43
+OP_CASE_AND = 44
+OP_CASE_END = 46
+OP_SWITCH_BREAK = 48
+OP_END_SWITCH = 49
+OP_USER_FUNC = 91
+OP_RUN_EVT = 92
+OP_RUN_EVT_ID = 93
+OP_RUN_CHILD_EVT = 94
+OP_DELETE_EVT = 95
+OP_CHK_EVT = 106
+OP_INLINE_EVT = 107
+OP_INLINE_EVT_ID = 108
+OP_END_INLINE = 109
+OP_BROTHER_EVT = 110
+OP_BROTHER_EVT_ID = 111
+OP_END_BROTHER = 112
+
+IF_OPS = range(12, 32)
+CASE_OPS = range(36, 48)
+
+class Symbol:
+	# A reference to something outside the script (function, vanilla evt, ...)
+	def __init__(self, name):
+		self.name = name
+	def __repr__(self):
+		return self.name
+	def __eq__(self, other):
+		return isinstance(other, Symbol) and other.name == self.name
+	def __hash__(self):
+		return hash(self.name)
+
+class Instruction:
+	def __init__(self, opcode, args, macro):
+		self.opcode = opcode
+		self.args = args
+		self.macro = macro
+	def __repr__(self):
+		return "%s(%s)" % (self.macro, ", ".join(format_value(a) for a in self.args))
+
+def format_value(value):
+	if isinstance(value, int) and not isinstance(value, bool):
+		for name, base in sorted(VAR_BASES.items(), key=lambda kv: kv[1]):
+			if base <= value < base + 20000000:
+				return "%s(%d)" % (name, value - base)
+		if POINTER_BASE < value < UF_BASE:
+			return "FLOAT(%g)" % ((value - FLOAT_BASE) / 1024.0)
+	if isinstance(value, str):
+		return '"%s"' % value
+	return str(value)
+
+def load_commands(filename=EVT_CMD_HEADER):
+	# Maps each command macro to (opcode, parameter count or None if variadic).
+	commands = {}
+	text = open(filename, "r").read().replace("\\\n", " ")
+	for match in re.finditer(r"#define\s+(\w+)\(([^)]*)\)\s*(.*)", text):
+		name, body = match.group(1), match.group(3)
+		cmd = re.search(r"EVT_HELPER_CMD\(\s*([^,]+?)\s*,\s*(\d+)\s*\)", body)
+		if not cmd:
+			continue
+		count = cmd.group(1)
+		commands[name] = (int(cmd.group(2)), int(count) if count.isdigit() else None)
+	return commands
+
+def split_args(text):
+	args, depth, current, in_string = [], 0, "", False
+	for i, c in enumerate(text):
+		if c == '"' and (i == 0 or text[i-1] != "\\"):
+			in_string = not in_string
+		if not in_string:
+			if c in "(<[":
+				depth += 1
+			elif c in ")>]":
+				depth -= 1
+			elif c == "," and depth == 0:
+				args.append(current.strip())
+				current = ""
+				continue
+		current += c
+	if current.strip():
+		args.append(current.strip())
+	return args
+
+def parse_int(text):
+	text = text.replace("'", "").rstrip("uUlL")
+	return int(text, 0)
+
+def evaluate(text, constants):
+	text = text.strip()
+	match = re.fullmatch(r"(\w+)\((.*)\)", text, re.S)
+	if match and match.group(1) in VAR_BASES:
+		return VAR_BASES[match.group(1)] + evaluate(match.group(2), constants)
+	if match and match.group(1) == "FLOAT":
+		return FLOAT_BASE + int(float(match.group(2).rstrip("fF")) * 1024)
+	if match and match.group(1) == "PTR":
+		return evaluate(match.group(2), constants)
+	if match and match.group(1) == "REL_PTR":
+		module, offset = split_args(match.group(2))
+		return Symbol("%s+%s" % (module.split("::")[-1].lower(), offset))
+	cast = re.fullmatch(r"(?:static|reinterpret)_cast<[^>]*>\((.*)\)", text, re.S)
+	if cast:
+		return evaluate(cast.group(1), constants)
+	if text.startswith('"'):
+		return bytes(text[1:-1], "ascii").decode("unicode_escape")
+	if text.startswith("&"):
+		return Symbol(text[1:].strip())
+	try:
+		return parse_int(text)
+	except ValueError:
+		pass
+	if text.startswith("-"):
+		inner = evaluate(text[1:], constants)
+		if isinstance(inner, int):
+			return -inner
+	if text in constants:
+		return constants[text]
+	return Symbol(text)
+
+def parse_scripts(filename, commands):
+	source = open(filename, "r").read()
+	source = re.sub(r"//[^\n]*", "", source)
+	source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+
+	# Integer constants (e.g. "constexpr const uint32_t kFoo = 0x1234;").
+	constants = {}
+	for match in re.finditer(r"const\s+\w+\s+(k\w+)\s*=\s*([-\w']+)\s*;", source):
+		try:
+			constants[match.group(1)] = parse_int(match.group(2))
+		except ValueError:
+			pass
+
+	scripts = {}
+	pattern = r"EVT_BEGIN\((\w+)\)(.*?)EVT_(?:PATCH_)?END\(\)"
+	for match in re.finditer(pattern, source, re.S):
+		name, body = match.group(1), match.group(2)
+		instructions, pos = [], 0
+		while True:
+			call = re.compile(r"(\w+)\s*\(").search(body, pos)
+			if not call:
+				break
+			# Find the matching close paren for the macro's arguments.
+			depth, end, in_string = 1, call.end(), False
+			while depth:
+				c = body[end]
+				if c == '"' and body[end-1] != "\\":
+					in_string = not in_string
+				elif not in_string and c == "(":
+					depth += 1
+				elif not in_string and c == ")":
+					depth -= 1
+				end += 1
+			macro = call.group(1)
+			args = [evaluate(a, constants) for a in split_args(body[call.end():end-1])]
+			pos = end
+			if macro in ("USER_FUNC", "UNCHECKED_USER_FUNC"):
+				instructions.append(Instruction(OP_USER_FUNC, args, "USER_FUNC"))
+			elif macro in commands:
+				instructions.append(Instruction(commands[macro][0], args, macro))
+			else:
+				raise ValueError("%s: unknown command %s" % (name, macro))
+		instructions.append(Instruction(OP_END, [], "EVT_END"))
+		scripts[name] = instructions
+	return scripts
+
+class Thread:
+	next_id = 1
+
+	def __init__(self, name, instructions, pc=0, parent=None):
+		self.name = name
+		self.instructions = instructions
+		self.pc = pc
+		self.parent = parent
+		self.id = Thread.next_id
+		Thread.next_id += 1
+		self.lw = [0] * 16
+		self.lf = [0] * 16
+		self.loops = []     # [pc of DO, iterations left]
+		self.switches = []  # [value, matched]
+		self.wait_frames = 0
+		self.halt_on = None
+		self.waiting_on_child = None
+		self.done = False
+		self.inline_end = None
+
+class Simulator:
+	def __init__(self, scripts, max_frames=600, trace=False):
+		self.scripts = scripts
+		self.max_frames = max_frames
+		self.trace = trace
+		self.mocks = {}
+		self.gw = [0] * 32
+		self.gf = [0] * 96
+		self.gsw = {}
+		self.gswf = {}
+		self.lsw = {}
+		self.lswf = {}
+		self.threads = []
+		self.frames = 0
+		self.instructions = 0
+		self.opcode_counts = {}
+		self.user_func_calls = []
+		self.external_calls = []
+
+	# --- Variable access, mirroring evtGetValue / evtSetValue. ---
+
+	def storage(self, thread, value):
+		if not isinstance(value, int) or value <= POINTER_BASE or value >= LW_BASE + 20000000:
+			return None, None
+		for name, base in VAR_BASES.items():
+			if base <= value < base + 20000000:
+				index = value - base
+				if name == "LW":
+					return thread.lw, index
+				if name == "LF":
+					return thread.lf, index
+				if name == "GW":
+					return self.gw, index
+				if name == "GF":
+					return self.gf, index
+				return getattr(self, name.lower(), self.gsw), index
+		return None, None
+
+	def get(self, thread, value):
+		if isinstance(value, int) and POINTER_BASE < value < UF_BASE:
+			return (value - FLOAT_BASE) / 1024.0
+		store, index = self.storage(thread, value)
+		if store is None:
+			return value
+		if isinstance(store, dict):
+			return store.get(index, 0)
+		return store[index]
+
+	def set(self, thread, var, value):
+		store, index = self.storage(thread, var)
+		if store is None:
+			raise ValueError("%s: cannot assign to %s" % (thread.name, format_value(var)))
+		store[index] = value
+
+	def set_var(self, name, value):
+		# Sets a global variable given its textual form, e.g. "GSW(1321)".
+		var = evaluate(name, {})
+		if not isinstance(var, int) or LF_BASE <= var < LF_BASE + 20000000 or var >= LW_BASE:
+			raise ValueError("cannot set %s from outside a script" % name)
+		store, index = self.storage(None, var)
+		store[index] = value
+
+	# --- Thread management. ---
+
+	def start(self, name, parent=None, copy_from=None):
+		if isinstance(name, Symbol):
+			name = name.name
+		if name not in self.scripts:
+			self.external_calls.append(str(name))
+			return None
+		thread = Thread(name, self.scripts[name], parent=parent)
+		if copy_from:
+			thread.lw = list(copy_from.lw)
+			thread.lf = list(copy_from.lf)
+		self.threads.append(thread)
+		return thread
+
+	def run(self, name):
+		root = self.start(name)
+		if not root:
+			raise ValueError("no script named %s" % name)
+		while not root.done:
+			if self.frames >= self.max_frames:
+				raise RuntimeError("%s did not finish within %d frames" % (name, self.max_frames))
+			for thread in list(self.threads):
+				if not thread.done:
+					self.step_thread(thread)
+			self.threads = [t for t in self.threads if not t.done]
+			self.frames += 1
+		# Let any threads started by the script finish as well.
+		while self.threads and self.frames < self.max_frames:
+			for thread in list(self.threads):
+				if not thread.done:
+					self.step_thread(thread)
+			self.threads = [t for t in self.threads if not t.done]
+			self.frames += 1
+		return root
+
+	def finish(self, thread):
+		thread.done = True
+		parent = thread.parent
+		if parent and parent.waiting_on_child is thread:
+			# Child evts write their local words back to the parent.
+			parent.lw = list(thread.lw)
+			parent.lf = list(thread.lf)
+			parent.waiting_on_child = None
+
+	def step_thread(self, thread):
+		if thread.waiting_on_child:
+			return
+		if thread.wait_frames > 0:
+			thread.wait_frames -= 1
+			return
+		if thread.halt_on is not None:
+			if self.get(thread, thread.halt_on):
+				return
+			thread.halt_on = None
+		while not thread.done:
+			ins = thread.instructions[thread.pc]
+			self.instructions += 1
+			self.opcode_counts[ins.macro] = self.opcode_counts.get(ins.macro, 0) + 1
+			if self.trace:
+				print("  [%4d] %s:%d %s" % (self.frames, thread.name, thread.pc, ins))
+			thread.pc += 1
+			if self.execute(thread, ins):
+				return
+
+	# --- Control flow helpers. ---
+
+	def skip(self, thread, targets, openers, closers):
+		# Advances past nested blocks to the next target op at this depth.
+		depth = 0
+		while True:
+			op = thread.instructions[thread.pc].opcode
+			if depth == 0 and op in targets:
+				return op
+			if op in openers:
+				depth += 1
+			elif op in closers:
+				depth -= 1
+			elif op == OP_END:
+				raise RuntimeError("%s: unterminated block" % thread.name)
+			thread.pc += 1
+
+	def skip_if(self, thread):
+		self.skip(thread, (OP_ELSE, OP_END_IF), IF_OPS, (OP_END_IF,))
+		thread.pc += 1
+
+	def skip_case(self, thread):
+		self.skip(thread, tuple(CASE_OPS) + (OP_END_SWITCH,), (OP_SWITCH, OP_SWITCHI), (OP_END_SWITCH,))
+
+	def skip_switch(self, thread):
+		self.skip(thread, (OP_END_SWITCH,), (OP_SWITCH, OP_SWITCHI), (OP_END_SWITCH,))
+
+	def compare(self, opcode, lhs, rhs):
+		index = (opcode - 12) % 6
+		return [lhs == rhs, lhs != rhs, lhs < rhs, lhs > rhs, lhs <= rhs, lhs >= rhs][index]
+
+	def check_case(self, opcode, value, args, thread):
+		get = lambda a: self.get(thread, a)
+		if opcode == 36 or opcode == OP_CASE_OR or opcode == OP_CASE_AND:
+			return value == get(args[0])
+		if opcode == 37:
+			return value != get(args[0])
+		if opcode == 38:
+			return value < get(args[0])
+		if opcode == 39:
+			return value > get(args[0])
+		if opcode == 40:
+			return value <= get(args[0])
+		if opcode == 41:
+			return value >= get(args[0])
+		if opcode == OP_CASE_ETC:
+			return True
+		if opcode == 45:
+			return bool(value & args[0])
+		if opcode == 47:
+			return get(args[0]) <= value <= get(args[1])
+		return False
+
+	# --- Instruction execution; returns True if the thread yields. ---
+
+	def execute(self, thread, ins):
+		op, args = ins.opcode, ins.args
+		get = lambda a: self.get(thread, a)
+
+		if op == OP_END or op == OP_RETURN:
+			self.finish(thread)
+			return True
+		if op == OP_END_INLINE or op == OP_END_BROTHER:
+			if thread.inline_end == thread.pc - 1:
+				self.finish(thread)
+				return True
+			return False
+		if op == OP_LBL:
+			return False
+		if op == OP_GOTO:
+			target = get(args[0])
+			for pc, other in enumerate(thread.instructions):
+				if other.opcode == OP_LBL and other.args[0] == target:
+					thread.pc = pc + 1
+					return False
+			raise RuntimeError("%s: missing label %s" % (thread.name, target))
+		if op == OP_DO:
+			thread.loops.append([thread.pc, get(args[0])])
+			return False
+		if op == OP_WHILE:
+			loop = thread.loops[-1]
+			if loop[1] != 0:
+				loop[1] -= 1
+				if loop[1] == 0:
+					thread.loops.pop()
+					return False
+			thread.pc = loop[0]
+			return False
+		if op == OP_DO_BREAK:
+			self.skip(thread, (OP_WHILE,), (OP_DO,), (OP_WHILE,))
+			thread.pc += 1
+			thread.loops.pop()
+			return False
+		if op == OP_DO_CONTINUE:
+			self.skip(thread, (OP_WHILE,), (OP_DO,), (OP_WHILE,))
+			return False
+		if op == OP_WAIT_FRM:
+			thread.wait_frames = max(get(args[0]) - 1, 0)
+			return True
+		if op == OP_WAIT_MSEC:
+			thread.wait_frames = max((get(args[0]) * 60 + 999) // 1000 - 1, 0)
+			return True
+		if op == OP_HALT:
+			if get(args[0]):
+				thread.halt_on = args[0]
+				return True
+			return False
+		if op in IF_OPS:
+			if op <= 17:
+				result = self.compare(op - 12 + 24, str(get(args[0])), str(get(args[1])))
+			elif op <= 23:
+				result = self.compare(op - 18 + 24, float(get(args[0])), float(get(args[1])))
+			elif op <= 29:
+				result = self.compare(op, get(args[0]), get(args[1]))
+			elif op == 30:
+				result = bool(get(args[0]) & args[1])
+			else:
+				result = not (get(args[0]) & args[1])
+			if not result:
+				self.skip_if(thread)
+			return False
+		if op == OP_ELSE:
+			# Reached the end of a taken if-branch; skip the else-branch.
+			self.skip(thread, (OP_END_IF,), IF_OPS, (OP_END_IF,))
+			thread.pc += 1
+			return False
+		if op == OP_END_IF:
+			return False
+		if op == OP_SWITCH or op == OP_SWITCHI:
+			thread.switches.append([get(args[0]) if op == OP_SWITCH else args[0], False])
+			self.skip_case(thread)
+			return False
+		if op in CASE_OPS:
+			switch = thread.switches[-1]
+			if switch[1] and op not in (OP_CASE_OR, OP_CASE_AND):
+				# Fell through to the next case from a matched one; done.
+				self.skip_switch(thread)
+				return False
+			if op == OP_CASE_END:
+				if switch[1]:
+					self.skip_switch(thread)
+				return False
+			matched = self.check_case(op, switch[0], args, thread)
+			if op == OP_CASE_OR:
+				switch[1] = switch[1] or matched
+				if not switch[1] and thread.instructions[thread.pc].opcode != OP_CASE_OR:
+					self.skip(thread, (OP_CASE_END,), (OP_SWITCH, OP_SWITCHI), (OP_END_SWITCH,))
+				return False
+			if op == OP_CASE_AND:
+				if not matched:
+					self.skip(thread, (OP_CASE_END,), (OP_SWITCH, OP_SWITCHI), (OP_END_SWITCH,))
+				elif thread.instructions[thread.pc].opcode != OP_CASE_AND:
+					switch[1] = True
+				return False
+			if matched:
+				switch[1] = True
+			else:
+				self.skip_case(thread)
+			return False
+		if op == OP_SWITCH_BREAK:
+			self.skip_switch(thread)
+			return False
+		if op == OP_END_SWITCH:
+			thread.switches.pop()
+			return False
+		if 50 <= op <= 61:
+			lhs, rhs = args
+			if op == 50 or op == 52:
+				self.set(thread, lhs, get(rhs))
+			elif op == 51:
+				self.set(thread, lhs, rhs)
+			else:
+				a, b = get(lhs), get(rhs)
+				if op >= 58:
+					a, b = float(a), float(b)
+				result = {
+					53: lambda: a + b, 54: lambda: a - b, 55: lambda: a * b,
+					56: lambda: int(a / b), 57: lambda: a % b,
+					58: lambda: a + b, 59: lambda: a - b, 60: lambda: a * b,
+					61: lambda: a / b,
+				}[op]()
+				self.set(thread, lhs, result)
+			return False
+		if 77 <= op <= 80:
+			out, lhs, rhs = args
+			a = get(lhs)
+			b = get(rhs) if op in (77, 79) else rhs
+			self.set(thread, out, a & b if op <= 78 else a | b)
+			return False
+		if op == OP_USER_FUNC:
+			return self.call_user_func(thread, args[0], args[1:])
+		if op == OP_RUN_EVT or op == OP_RUN_EVT_ID:
+			child = self.start(args[0], copy_from=thread)
+			if op == OP_RUN_EVT_ID:
+				self.set(thread, args[1], child.id if child else 0)
+			return False
+		if op == OP_RUN_CHILD_EVT:
+			child = self.start(args[0], parent=thread, copy_from=thread)
+			if child:
+				thread.waiting_on_child = child
+				# Run the child immediately, as the game does.
+				self.step_thread(child)
+				return thread.waiting_on_child is not None
+			return False
+		if op == OP_DELETE_EVT:
+			target = get(args[0])
+			for other in self.threads:
+				if other.id == target:
+					other.done = True
+			return False
+		if op == OP_CHK_EVT:
+			target = get(args[0])
+			running = any(t.id == target and not t.done for t in self.threads)
+			self.set(thread, args[1], 1 if running else 0)
+			return False
+		if op in (OP_INLINE_EVT, OP_INLINE_EVT_ID, OP_BROTHER_EVT, OP_BROTHER_EVT_ID):
+			end_op = OP_END_INLINE if op <= OP_INLINE_EVT_ID else OP_END_BROTHER
+			child = Thread(thread.name + "/inline", thread.instructions, pc=thread.pc)
+			child.lw = list(thread.lw)
+			child.lf = list(thread.lf)
+			self.skip(thread, (end_op,), (OP_INLINE_EVT, OP_INLINE_EVT_ID, OP_BROTHER_EVT, OP_BROTHER_EVT_ID),
+				(OP_END_INLINE, OP_END_BROTHER))
+			child.inline_end = thread.pc
+			thread.pc += 1
+			if op in (OP_INLINE_EVT_ID, OP_BROTHER_EVT_ID):
+				self.set(thread, args[0], child.id)
+			self.threads.append(child)
+			return False
+		# Everything else (debug ops, priorities, user work, ...) is a no-op.
+		return False
+
+	def call_user_func(self, thread, func, args):
+		name = func.name if isinstance(func, Symbol) else format_value(func)
+		short_name = name.split("::")[-1]
+		self.user_func_calls.append(short_name)
+		mock = self.mocks.get(short_name)
+		if mock is None:
+			return False
+		if callable(mock):
+			# Callables receive the simulator, thread and raw args; they may
+			# return a number of frames to wait before continuing.
+			frames = mock(self, thread, args)
+			if frames:
+				thread.wait_frames = frames - 1
+				return True
+			return False
+		# Otherwise, the mock is a list of values written to the last argument.
+		value = mock[0] if len(mock) == 1 else mock.pop(0)
+		if args:
+			self.set(thread, args[-1], value)
+		return False
+
+def parse_assignment(text):
+	name, value = text.split("=", 1)
+	return name.strip(), value.strip()
+
+def summarize(sim, root):
+	print("%s: %d instructions, %d frames, %d USER_FUNC calls" % (
+		root.name, sim.instructions, sim.frames, len(sim.user_func_calls)))
+	print("  LW: " + " ".join("%d=%s" % (i, format_value(v)) for i, v in enumerate(root.lw) if v != 0))
+	if sim.gsw:
+		print("  GSW: " + " ".join("%d=%s" % (k, v) for k, v in sorted(sim.gsw.items())))
+	if sim.gswf:
+		print("  GSWF: " + " ".join("%#x=%s" % (k, v) for k, v in sorted(sim.gswf.items())))
+	print("  USER_FUNCs: " + " ".join(sim.user_func_calls))
+	if sim.external_calls:
+		print("  External evts: " + " ".join(sim.external_calls))
+	print("  Opcodes: " + " ".join("%s=%d" % kv for kv in sorted(sim.opcode_counts.items(), key=lambda kv: -kv[1])))
+
+def main(argv):
+	if len(argv) < 3:
+		sys.exit("usage: evtsim.py <source.cpp> <ScriptName|--list> [options]")
+	commands = load_commands()
+	scripts = parse_scripts(argv[1], commands)
+	if argv[2] == "--list":
+		for name, instructions in scripts.items():
+			print("%-32s %4d instructions" % (name, len(instructions)))
+		return
+
+	script, sets, mocks, sweep = argv[2], [], {}, None
+	trace, max_frames = False, 600
+	i = 3
+	while i < len(argv):
+		if argv[i] == "--set":
+			sets.append(parse_assignment(argv[i+1]))
+			i += 1
+		elif argv[i] == "--mock":
+			name, values = parse_assignment(argv[i+1])
+			mocks[name] = [parse_int(v) for v in values.split(",")]
+			i += 1
+		elif argv[i] == "--sweep":
+			name, values = parse_assignment(argv[i+1])
+			lo, hi = values.split(":")
+			sweep = (name, parse_int(lo), parse_int(hi))
+			i += 1
+		elif argv[i] == "--trace":
+			trace = True
+		elif argv[i] == "--max-frames":
+			max_frames = int(argv[i+1])
+			i += 1
+		else:
+			sys.exit("unknown option " + argv[i])
+		i += 1
+
+	def simulate(extra_sets):
+		sim = Simulator(scripts, max_frames, trace)
+		for name, values in mocks.items():
+			sim.mocks[name] = list(values)
+		for name, value in sets + extra_sets:
+			sim.set_var(name, parse_int(value) if isinstance(value, str) else value)
+		return sim, sim.run(script)
+
+	if not sweep:
+		sim, root = simulate([])
+		summarize(sim, root)
+		return
+
+	start = time.time()
+	for value in range(sweep[1], sweep[2]):
+		sim, root = simulate([(sweep[0], value)])
+		print("%s=%-6d instructions=%-5d frames=%-4d LW(0)=%-4s %s" % (
+			sweep[0], value, sim.instructions, sim.frames,
+			format_value(root.lw[0]), " ".join(sim.user_func_calls)))
+	elapsed = time.time() - start
+	count = sweep[2] - sweep[1]
+	print("%d paths in %.3f s (%.0f paths / s)" % (count, elapsed, count / max(elapsed, 1e-9)))
+
+if __name__ == "__main__":
+	main(sys.argv)
@@ -0,0 +1,233 @@
+# Prints the mod's flight recorder (rel/source/flight_recorder.cpp) from a dump
+# of MEM1, taken after a crash (or after freezing it with the secret code),
+# symbolizing the crashed context and call stack. The copy the mod writes to
+# the memory card when frozen with the secret code (pit_flight_recorder, e.g.
+# exported as a .gci) can be read instead of a dump, though without the call
+# stack; crashes are only recorded in RAM.
+#
+# Usage: python flightrec.py <mem1.raw|card file> <rel.us.elf.map> <ttyd.us.lst> [num_events]
+#
+# The map file is written next to the REL when building (build.us/rel.us.elf.map);
+# the .lst file is the one the REL was linked against (rel/include/ttyd.us.lst).
+
+import re
+import sys
+import struct
+
+RECORDER_MAGIC = b"PFRC"
+RECORDER_VERSION = 2
+HEADER_SIZE = 10 * 4
+CONTEXT_SIZE = 42 * 4 + 32 * 8
+ENTRY_SIZE = 4 * 4
+MEM1_BASE = 0x80000000
+MEM1_SIZE = 0x1800000
+ANCHOR_SYMBOL = "_ZN3mod15flight_recorder4InitEv"
+
+FROZEN_REASONS = ["still recording", "crashed", "snapshot requested"]
+# Keep in sync with flight_recorder::HookId.
+HOOK_NAMES = [
+	None, "map loaded", "map unloading", "SelectEnemies", "battle start",
+	"battle end", "OnFileLoad"
+]
+# Hooks whose value is an interned map id (see map_events.h).
+MAP_EVENT_HOOKS = (1, 2, 4, 5)
+# Keep in sync with ModuleNameFromId.
+AREA_NAMES = [
+	None, "aaa", "aji", "bom", "dmo", "dou", "eki", "end",
+	"gon", "gor", "gra", "hei", "hom", "jin", "jon", "kpa",
+	"las", "moo", "mri", "muj", "nok", "pik", "rsh", "sys",
+	"tik", "tou", "tou2", "usu", "win", "yuu"
+]
+# OSTime ticks run at 40.5 MHz.
+TICKS_PER_MS = 40500.0
+# Non-heap "heap" ids in alloc failure entries (see heap_tracker.cpp).
+ALLOC_HEAP_NAMES = {0xff: "map heap", 0xfe: "pMapAlloc slot", 0xfd: "REL bss buffer"}
+
+def find_recorder(mem):
+	offset = 0
+	while True:
+		offset = mem.find(RECORDER_MAGIC, offset)
+		if offset < 0:
+			sys.exit("No flight recorder found in the dump.")
+		if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == RECORDER_VERSION:
+			return offset
+		offset += 4
+
+def read_word(mem, address):
+	offset = address - MEM1_BASE
+	if address % 4 or offset < 0 or offset + 4 > len(mem):
+		return None
+	return struct.unpack(">L", mem[offset:offset+4])[0]
+
+def load_lst(filename):
+	# Returns a list of (address, name) for the game's symbols.
+	symbols = []
+	for line in open(filename):
+		line = line.strip()
+		if not line or line.startswith("//"):
+			continue
+		(address, name) = line.split(":", 1)
+		symbols.append((int(address, 16), name))
+	return sorted(symbols)
+
+def load_map(filename):
+	# Returns a list of (link address, name) for the REL's functions, from
+	# both symbol lines and the per-function .text sections.
+	symbols = {}
+	section = None
+	for line in open(filename):
+		match = re.match(r"^\s*\.text\.(\S+)(?:\s+0x([0-9a-f]+))?", line)
+		if match:
+			section = match.group(1)
+			if match.group(2):
+				symbols[int(match.group(2), 16)] = section
+				section = None
+			continue
+		match = re.match(r"^\s+0x([0-9a-f]+)\s+(?:0x[0-9a-f]+\s+\S+|(\S+))\s*$", line)
+		if match:
+			address = int(match.group(1), 16)
+			if match.group(2):
+				symbols[address] = match.group(2)
+			elif section:
+				symbols.setdefault(address, section)
+		section = None
+	return sorted(symbols.items())
+
+def lookup(symbols, address):
+	# Finds the nearest symbol at or below the address (binary search).
+	(lo, hi) = (0, len(symbols))
+	while lo < hi:
+		mid = (lo + hi) // 2
+		if symbols[mid][0] <= address:
+			lo = mid + 1
+		else:
+			hi = mid
+	return symbols[lo - 1] if lo else None
+
+class Symbolizer:
+	def __init__(self, recorder, map_symbols, lst_symbols):
+		self.lst_symbols = lst_symbols
+		(anchor,) = struct.unpack(">L", recorder[24:28])
+		link_anchor = [a for (a, name) in map_symbols if name == ANCHOR_SYMBOL]
+		if not link_anchor:
+			sys.exit("%s not found in the map file." % ANCHOR_SYMBOL)
+		# Relocate the REL's symbols to where it was loaded.
+		bias = anchor - link_anchor[0]
+		self.rel_symbols = [(a + bias, name) for (a, name) in map_symbols]
+		self.modules = []
+
+	def add_module(self, module_id, base):
+		self.modules.append((base, module_id))
+
+	def __call__(self, address):
+		# Try the game's and the REL's symbols, taking the closest below.
+		best = None
+		for symbols in (self.lst_symbols, self.rel_symbols):
+			found = lookup(symbols, address)
+			if found and address - found[0] < 0x10000 and (not best or found[0] > best[0]):
+				best = found
+		if best:
+			return "%s+0x%x" % (best[1], address - best[0])
+		# Otherwise, show it relative to the nearest module linked below it.
+		bases = [m for m in self.modules if m[0] <= address]
+		if bases:
+			(base, module_id) = max(bases)
+			return "module %d+0x%x" % (module_id, address - base)
+		return "?"
+
+def print_context(mem, context, symbolize):
+	words = struct.unpack(">42L", context[:42 * 4])
+	(gpr, (cr, lr, ctr, xer, srr0, srr1, dsisr, dar, fpscr, fprs_valid)) = (
+		words[:32], words[32:])
+	print("Crashed at %08x  %s" % (srr0, symbolize(srr0)))
+	print("LR         %08x  %s" % (lr, symbolize(lr)))
+	print("CR %08x  CTR %08x  XER %08x  MSR %08x  DSISR %08x  DAR %08x" % (
+		cr, ctr, xer, srr1, dsisr, dar))
+	for row in range(8):
+		print("  ".join("r%-2d %08x" % (r, gpr[r]) for r in range(row * 4, row * 4 + 4)))
+	if fprs_valid:
+		fpr = struct.unpack(">32d", context[42 * 4:])
+		print("FPSCR %08x" % fpscr)
+		for row in range(8):
+			print("  ".join("f%-2d %12.6g" % (r, fpr[r]) for r in range(row * 4, row * 4 + 4)))
+	if len(mem) < MEM1_SIZE:
+		print("(No call stack; not a full dump of MEM1.)")
+		return
+	# Walk the stack's back-chain; each frame saves its caller's LR at sp + 4.
+	print("Call stack:")
+	sp = gpr[1]
+	for depth in range(32):
+		back_chain = read_word(mem, sp)
+		if not back_chain or back_chain <= sp:
+			break
+		saved_lr = read_word(mem, back_chain + 4)
+		if saved_lr is None:
+			break
+		print("  #%-2d %08x  %s" % (depth, saved_lr, symbolize(saved_lr)))
+		sp = back_chain
+
+def map_name(map_id):
+	if map_id == 0xff:
+		return "title"
+	area = map_id >> 8
+	if not map_id or area >= len(AREA_NAMES):
+		return "unknown map"
+	return "%s_%02d" % (AREA_NAMES[area], map_id & 0xff)
+
+def format_event(entry):
+	(entry_type, arg, frame, v0, v1, v2) = entry
+	if entry_type == 1:
+		return "frame  %6.2f ms  state %08x  floor %d" % (v0 / TICKS_PER_MS, v1, v2 + 1)
+	if entry_type == 2:
+		name = HOOK_NAMES[arg] if arg < len(HOOK_NAMES) else "hook %d" % arg
+		if arg in MAP_EVENT_HOOKS:
+			return "hook   %s (%s)" % (name, map_name(v0))
+		return "hook   %s (%d)" % (name, v0)
+	if entry_type == 3:
+		return "floor  %d  state %08x" % (v0 + 1, v1)
+	if entry_type == 4:
+		return "seed   %08x" % v0
+	if entry_type == 5:
+		return "%s module %d @ %08x" % ("link  " if arg else "unlink", v0, v1)
+	if entry_type == 6:
+		return "heap   modules %d + %d: peak %dK live, %dK min largest free" % (
+			v0 >> 16, v0 & 0xffff, v1 >> 10, v2 >> 10)
+	if entry_type == 7:
+		heap = ALLOC_HEAP_NAMES.get(arg, "heap %d" % arg)
+		return "alloc  %d bytes from %s failed" % (v0, heap)
+	return "type %d: %08x %08x %08x" % (entry_type, v0, v1, v2)
+
+def main(argc, argv):
+	if argc < 4:
+		sys.exit("Usage: python flightrec.py <mem1.raw> <rel.us.elf.map> <ttyd.us.lst> [num_events]")
+	mem = open(argv[1], "rb").read()
+	num_events = int(argv[4]) if argc > 4 else 64
+	offset = find_recorder(mem)
+	recorder = mem[offset:offset + HEADER_SIZE + CONTEXT_SIZE]
+	(magic, version, capacity, count, frame, frozen_reason, anchor,
+		rel_file_base, map_alloc_base, context_valid) = struct.unpack(
+			">4s9L", recorder[:HEADER_SIZE])
+	symbolize = Symbolizer(recorder, load_map(argv[2]), load_lst(argv[3]))
+
+	entries = []
+	for index in range(max(0, count - capacity), count):
+		entry_offset = offset + HEADER_SIZE + CONTEXT_SIZE + (index % capacity) * ENTRY_SIZE
+		entries.append(struct.unpack(">2BH3L", mem[entry_offset:entry_offset+ENTRY_SIZE]))
+	for entry in entries:
+		if entry[0] == 5 and entry[1]:
+			symbolize.add_module(entry[3], entry[4])
+
+	reason = FROZEN_REASONS[frozen_reason] if frozen_reason < 3 else str(frozen_reason)
+	location = ("%08x" % (MEM1_BASE + offset) if len(mem) >= MEM1_SIZE
+		else "file offset 0x%x" % offset)
+	print("Flight recorder at %s: %s, frame %d, %d events recorded" % (
+		location, reason, frame, count))
+	print("Modules: rel %08x  map %08x" % (rel_file_base, map_alloc_base))
+	if context_valid:
+		print_context(mem, recorder[HEADER_SIZE:], symbolize)
+	print("Last %d events:" % min(num_events, len(entries)))
+	for entry in entries[-num_events:]:
+		print("  [%5d] %s" % (entry[2], format_event(entry)))
+
+if __name__ == "__main__":
+	main(len(sys.argv), sys.argv)
@@ -0,0 +1,122 @@
+# Summarizes (and optionally extracts or decodes) the mod's recorded input
+# log (rel/source/input_replay.cpp) from a dump of MEM1, or from the memory
+# card file the mod streams it to (pit_input_log, e.g. exported as a .gci).
+# A dump only holds the most recent part of a long recording.
+#
+# Usage: python inputlog.py <mem1.raw|card file> [--out=<file>] [--runs]
+#
+# --out writes the header and encoded runs to a file laid out like the card
+# file (which this can read back), to keep a recording around for comparing
+# later builds; --runs prints each decoded run.
+
+import struct
+import sys
+
+LOG_MAGIC = b"PINP"
+LOG_VERSION = 2
+HEADER_FORMAT = ">11Lhh20s"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+MEM1_BASE = 0x80000000
+MEM1_SIZE = 0x1800000
+FRAMES_PER_SECOND = 60
+
+MODES = [
+	"idle", "armed (recording)", "recording", "armed (replay)", "replaying",
+	"loading (replay)"]
+FIELDS = [
+	"button", "button_trg", "button_rep", "dir", "dir_trg", "dir_rep",
+	"stick_x", "stick_y", "substick_y"
+]
+
+def find_log(mem):
+	offset = 0
+	while True:
+		offset = mem.find(LOG_MAGIC, offset)
+		if offset < 0:
+			sys.exit("No input log found in the dump.")
+		if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == LOG_VERSION:
+			return offset
+		offset += 4
+
+def decode_runs(data):
+	runs = []
+	values = [0] * len(FIELDS)
+	pos = 0
+	while pos + 3 <= len(data):
+		mask = (data[pos] << 8) | data[pos+1]
+		pos += 2
+		frames = 0
+		shift = 0
+		while True:
+			frames |= (data[pos] & 0x7f) << shift
+			shift += 7
+			pos += 1
+			if not data[pos-1] & 0x80:
+				break
+		for i in range(len(FIELDS)):
+			if mask & (1 << i):
+				values[i] = (data[pos] << 8) | data[pos+1]
+				pos += 2
+		runs.append((frames, list(values)))
+	return runs
+
+def main(argc, argv):
+	options = {}
+	args = []
+	for arg in argv[1:]:
+		if arg.startswith("--"):
+			(key, _, value) = arg[2:].partition("=")
+			options[key] = value
+		else:
+			args.append(arg)
+	if len(args) != 1:
+		sys.exit("Usage: python inputlog.py <mem1.raw|card file> [--out=<file>] [--runs]")
+	mem = open(args[0], "rb").read()
+	offset = find_log(mem)
+	(_, _, mode, data_address, capacity, size, card_data_offset, num_frames,
+		irand_seed, overflowed, file_options, hp_mult, atk_mult,
+		filename) = struct.unpack(HEADER_FORMAT, mem[offset:offset+HEADER_SIZE])
+	if len(mem) < MEM1_SIZE:
+		# The card file (or one written with --out) has all of the runs.
+		data_offset = offset + card_data_offset
+		if data_offset + size > len(mem):
+			sys.exit("Log data is truncated (%d of %d bytes)." % (
+				max(0, len(mem) - data_offset), size))
+	else:
+		if not data_address:
+			sys.exit("Input recording was never armed.")
+		if size > capacity:
+			sys.exit("Only the last %d of %d bytes are in RAM; read the "
+				"memory card file (pit_input_log) instead." % (capacity, size))
+		data_offset = data_address - MEM1_BASE
+		if data_offset < 0 or data_offset + size > len(mem):
+			sys.exit("Log data (at %08x) is outside the dump." % data_address)
+	data = mem[data_offset:data_offset+size]
+	runs = decode_runs(data)
+
+	seconds = num_frames / float(FRAMES_PER_SECOND)
+	print("File name:   %s" % filename.split(b"\0")[0].decode("ascii", "replace"))
+	print("Options:     %08x (HP x%d%%, ATK x%d%%)" % (file_options, hp_mult, atk_mult))
+	print("Mode:        %s" % (MODES[mode] if mode < len(MODES) else mode))
+	print("irand seed:  %08x" % irand_seed)
+	print("Frames:      %d (%.1f s)" % (num_frames, seconds))
+	print("Runs:        %d (%.1f frames each)" % (len(runs), num_frames / float(max(1, len(runs)))))
+	print("Bytes:       %d%s" % (size, " (overflowed)" if overflowed else ""))
+	if seconds > 0:
+		print("Per hour:    %.1f KiB" % (size * 3600.0 / seconds / 1024))
+
+	if "runs" in options:
+		print("")
+		print("frames\t" + "\t".join(FIELDS))
+		for (frames, values) in runs:
+			print("%d\t%s" % (frames, "\t".join("%04x" % v for v in values)))
+	if options.get("out"):
+		with open(options["out"], "wb") as out:
+			out.write(mem[offset:offset+HEADER_SIZE])
+			out.write(b"\0" * (card_data_offset - HEADER_SIZE))
+			out.write(data)
+		print("Wrote %d bytes to %s." % (card_data_offset + size, options["out"]))
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main(len(sys.argv), sys.argv))
@@ -0,0 +1,242 @@
+# Checks the memory footprint of every module pairing the Pit can load (jon,
+# plus the secondary area REL SelectEnemies picks enemies from), using the area
+# RELs from your own copy of the game and the mod's REL and map file.
+#
+# Usage: python modfootprint.py [options] <region>=<disc rel dir> ...
+#
+#   <region>=<dir>          e.g. us=extracted/files/rel; the mod's build for
+#                           the region is read from ../rel (rel.<region>.rel and
+#                           build.<region>/rel.<region>.elf.map).
+#   --data=<file>           Enemy data to take the pairings from (defaults to
+#                           ../enemygen/pit_enemies.txt).
+#   --map-alloc-size=<hex>  Size of the pMapAlloc area the secondary REL is
+#                           copied into. If not given, the size the mod
+#                           measured is taken from --dump; with neither, the
+#                           secondary RELs aren't checked against it.
+#   --map-heap-size=<hex>   Size of the map heap jon's REL is allocated from.
+#   --dump=<mem1.raw>       MEM1 dump with the mod's heap tracker stats, to
+#                           include each pairing's measured peaks.
+#
+# Pairings are checked in parallel, one process per CPU.
+
+import concurrent.futures
+import os
+import re
+import struct
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REL_DIR = os.path.join(SCRIPT_DIR, "..", "rel")
+sys.path.insert(0, os.path.join(SCRIPT_DIR, "..", "enemygen"))
+import enemygen
+
+PRIMARY_MODULE = "JON"
+# Bytes of a spawn's BattleUnitSetup that must lie within its module.
+SETUP_SIZE = 0x30
+SECONDARY_BSS_SYMBOL = "g_AdditionalRelBss"
+
+TRACKER_MAGIC = b"PHEP"
+TRACKER_VERSION = 2
+
+class RelInfo:
+	def __init__(self, filename):
+		data = open(filename, "rb").read()
+		(self.module_id, num_sections, section_info_offset) = struct.unpack(
+			">L8xLL", data[:0x14])
+		(self.bss_size,) = struct.unpack(">L", data[0x20:0x24])
+		self.file_size = len(data)
+		(self.code, self.data) = (0, 0)
+		for i in range(num_sections):
+			(offset, size) = struct.unpack(
+				">LL", data[section_info_offset + i * 8:section_info_offset + i * 8 + 8])
+			if not offset:
+				continue  # bss (or an empty section)
+			if offset & 1:
+				self.code += size
+			else:
+				self.data += size
+
+def module_file(module):
+	return module.lower() + ".rel"
+
+def load_map_sections(filename):
+	# Returns {section name: size} for the input sections in a map file.
+	sections = {}
+	pending = None
+	for line in open(filename):
+		match = re.match(r"^ (\.\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+))?", line)
+		if match:
+			if match.group(2):
+				sections[match.group(1)] = int(match.group(3), 16)
+			else:
+				pending = match.group(1)
+			continue
+		match = re.match(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+\S", line)
+		if match and pending:
+			sections[pending] = int(match.group(2), 16)
+		pending = None
+	return sections
+
+def find_section_size(sections, symbol):
+	for (name, size) in sections.items():
+		if symbol in name:
+			return size
+	sys.exit("%s not found in the mod's map file." % symbol)
+
+def read_module_names():
+	# Returns the ModuleId enum's names, in order.
+	with open(os.path.join(enemygen.INCLUDE_DIR, "common_types.h")) as f:
+		text = f.read()
+	body = re.search(r"namespace ModuleId \{\s*enum e \{(.*?)\};", text, re.S).group(1)
+	return re.findall(r"^\s*([A-Z][A-Z0-9_]*)\b", re.sub(r"//.*", "", body), re.M)
+
+def load_tracker_stats(filename):
+	# Returns ({(primary, secondary): (maps, failures, main heap peak,
+	# main heap min largest free block, map heap bytes, map heap min largest
+	# free block)}, pMapAlloc size (0 if unknown)) from a MEM1 dump.
+	mem = open(filename, "rb").read()
+	offset = 0
+	while True:
+		offset = mem.find(TRACKER_MAGIC, offset)
+		if offset < 0:
+			sys.exit("No heap tracker stats found in %s." % filename)
+		if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == TRACKER_VERSION:
+			break
+		offset += 4
+	(num_heaps, num_pairings, map_alloc_capacity) = struct.unpack(
+		">LLL", mem[offset+8:offset+20])
+	peaks_size = (num_heaps * 2 + 3) * 4
+	# Header, live bytes and largest free blocks, current peaks and failures.
+	pos = offset + 24 + num_heaps * 8 + peaks_size + 4
+	module_names = read_module_names()
+	name = lambda module: module_names[module] if module < len(module_names) else str(module)
+	stats = {}
+	for i in range(num_pairings):
+		(primary, secondary, num_maps, failures) = struct.unpack(">4H", mem[pos:pos+8])
+		peaks = struct.unpack(">%dL" % (num_heaps * 2 + 3), mem[pos+8:pos+8+peaks_size])
+		stats[(name(primary), name(secondary))] = (
+			num_maps, failures, peaks[0], peaks[num_heaps], peaks[num_heaps * 2],
+			peaks[num_heaps * 2 + 2])
+		pos += 8 + peaks_size
+	return (stats, map_alloc_capacity)
+
+def check_pairing(task):
+	(region, rel_dir, primary, secondary, offsets) = task
+	# Returns (region, primary, secondary, primary info, secondary info,
+	# spawns whose setup lies outside their module).
+	infos = {}
+	for module in (primary, secondary):
+		if module:
+			infos[module] = RelInfo(os.path.join(rel_dir, module_file(module)))
+	# Check the primary module's spawns only once, with no secondary module.
+	checked = secondary or primary
+	bad_spawns = [
+		name for (name, module, offset) in offsets
+		if module == checked and offset + SETUP_SIZE > infos[module].file_size]
+	return (region, primary, secondary, infos.get(primary), infos.get(secondary), bad_spawns)
+
+def format_headroom(capacity, used):
+	if capacity is None:
+		return "-"
+	return "%d" % (capacity - used)
+
+def main(argc, argv):
+	options = {}
+	regions = []
+	for arg in argv[1:]:
+		if arg.startswith("--"):
+			(key, _, value) = arg[2:].partition("=")
+			options[key] = value
+		elif "=" in arg:
+			regions.append(tuple(arg.split("=", 1)))
+		else:
+			sys.exit("Expected <region>=<disc rel dir>, got '%s'." % arg)
+	if not regions:
+		sys.exit("Usage: python modfootprint.py [options] <region>=<disc rel dir> ...")
+
+	data = enemygen.EnemyData()
+	data_file = options.get("data", os.path.join(SCRIPT_DIR, "..", "enemygen", "pit_enemies.txt"))
+	try:
+		data.parse(data_file)
+	except enemygen.DataError as e:
+		sys.exit("%s: %s" % (data_file, e))
+	offsets = [(s["name"], s["module"], s["offset"]) for s in data.spawns]
+	secondaries = sorted(set(s["module"] for s in data.spawns) - set([PRIMARY_MODULE]))
+	map_heap_size = int(options["map-heap-size"], 16) if "map-heap-size" in options else None
+	stats = {}
+	alloc_capacity = None
+	if "dump" in options:
+		(stats, measured_capacity) = load_tracker_stats(options["dump"])
+		if measured_capacity:
+			alloc_capacity = measured_capacity
+	if "map-alloc-size" in options:
+		alloc_capacity = int(options["map-alloc-size"], 16)
+	if alloc_capacity is None:
+		print("pMapAlloc size unknown (pass --map-alloc-size, or a --dump taken "
+			"after an area REL was loaded); secondary RELs not checked against it.")
+
+	tasks = []
+	capacities = {}
+	for (region, rel_dir) in regions:
+		mod_rel = RelInfo(os.path.join(REL_DIR, "rel.%s.rel" % region))
+		sections = load_map_sections(os.path.join(
+			REL_DIR, "build.%s" % region, "rel.%s.elf.map" % region))
+		bss_capacity = find_section_size(sections, SECONDARY_BSS_SYMBOL)
+		capacities[region] = bss_capacity
+		print("%s: mod REL %d bytes (code %d, data %d, bss %d)" % (
+			region, mod_rel.file_size, mod_rel.code, mod_rel.data, mod_rel.bss_size))
+		for secondary in [None] + secondaries:
+			tasks.append((region, rel_dir, PRIMARY_MODULE, secondary, offsets))
+
+	print("%-4s %-10s %8s %8s %8s %8s %8s %8s %10s %10s %10s  %s" % (
+		"reg", "pairing", "code", "data", "bss", "2nd size", "2nd bss",
+		"jon size", "alloc room", "bss room", "heap room", "measured"))
+	unsafe = 0
+	with concurrent.futures.ProcessPoolExecutor() as executor:
+		for result in executor.map(check_pairing, tasks):
+			(region, primary, secondary, info, second, bad_spawns) = result
+			bss_capacity = capacities[region]
+			parts = [info] + ([second] if second else [])
+			code = sum(p.code for p in parts)
+			data_size = sum(p.data for p in parts)
+			bss = sum(p.bss_size for p in parts)
+			pairing = primary + ("+" + secondary if secondary else "")
+			row = "%-4s %-10s %8d %8d %8d %8d %8d %8d" % (
+				region, pairing, code, data_size, bss,
+				second.file_size if second else 0, second.bss_size if second else 0,
+				info.file_size)
+			problems = []
+			if second:
+				bss_room = bss_capacity - second.bss_size
+				if alloc_capacity is not None and second.file_size > alloc_capacity:
+					problems.append("REL overflows pMapAlloc")
+				if bss_room < 0:
+					problems.append("bss overflows %s" % SECONDARY_BSS_SYMBOL)
+				row += " %10s %10d" % (format_headroom(alloc_capacity, second.file_size), bss_room)
+			else:
+				row += " %10s %10s" % ("-", "-")
+			measured = stats.get((primary, secondary or "INVALID_MODULE"))
+			map_heap_used = info.file_size
+			if measured:
+				map_heap_used = max(map_heap_used, measured[4])
+			row += " %10s" % format_headroom(map_heap_size, map_heap_used)
+			if map_heap_size is not None and map_heap_used > map_heap_size:
+				problems.append("map heap exhausted")
+			if measured:
+				(num_maps, failures, peak, min_free, map_bytes, map_min_free) = measured
+				row += "  %d maps, heap0 peak %dK, min free block %dK, map heap %s, %d failures" % (
+					num_maps, peak >> 10, min_free >> 10,
+					"-" if map_min_free == 0xffffffff else "%dK" % (map_min_free >> 10), failures)
+				if failures:
+					problems.append("allocations failed")
+			if bad_spawns:
+				problems.append("setups outside module: " + ", ".join(bad_spawns))
+			print(row)
+			for problem in problems:
+				print("     ^ %s" % problem)
+			unsafe += bool(problems)
+	print("%d of %d pairings have problems." % (unsafe, len(tasks)))
+	return 1 if unsafe else 0
+
+if __name__ == "__main__":
+	sys.exit(main(len(sys.argv), sys.argv))
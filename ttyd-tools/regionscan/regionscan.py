@@ -0,0 +1,227 @@
+# Derives the mod's module offsets for other regions' builds of the game, by
+# taking a byte signature around each US offset and finding it in the other
+# region's copy of the same area REL. Writes a header of the offsets found for
+# each region (region_offsets_<region>.h).
+#
+# Usage: python regionscan.py [options] us=<disc rel dir> <region>=<dir> ...
+#
+#   <region>=<dir>  e.g. jp=extracted_jp/files/rel; the US RELs are required,
+#                   as all the offsets the mod uses are for them.
+#   --out=<dir>     Where to write the headers (defaults to ../rel/include).
+#   --data=<file>   Enemy data to take the spawns' unit setup offsets from
+#                   (defaults to ../enemygen/pit_enemies.txt).
+#
+# Offsets are read from the mod's source: the named k*Offset constants, and the
+# raw offsets patched in OnModuleLoaded (by the module whose branch they're in).
+# Words holding relative branches are wildcards in signatures, since their
+# targets move between regions. Exits non-zero if any offset can't be found.
+
+import concurrent.futures
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+SOURCE_DIR = os.path.join(SCRIPT_DIR, "..", "rel", "source")
+DEFAULT_OUT_DIR = os.path.join(SCRIPT_DIR, "..", "rel", "include")
+sys.path.insert(0, os.path.join(SCRIPT_DIR, "..", "enemygen"))
+import enemygen
+
+BASE_REGION = "us"
+# Files the named offset constants are defined in.
+CONSTANT_FILES = ("common_functions.cpp", "randomizer_patches.cpp")
+PATCH_FILE = "randomizer_patches.cpp"
+# Modules of constants that aren't used in OnModuleLoaded, by name prefix.
+CONSTANT_PREFIX_MODULES = (("kTik06", "TIK"), ("kPit", "JON"))
+# Signature lengths and placements (bytes before the offset, as a fraction of
+# the length) to try, in order; shorter ones are less likely to span changes.
+SIGNATURE_LENGTHS = (16, 32, 64)
+SIGNATURE_PLACEMENTS = (0.5, 0.0, 1.0)
+
+class Offset:
+	def __init__(self, name, module, offset, comment):
+		self.name = name
+		self.module = module
+		self.offset = offset
+		self.comment = comment
+
+def read_source(filename):
+	with open(os.path.join(SOURCE_DIR, filename)) as f:
+		return f.read()
+
+def read_offsets(data):
+	# Returns the list of Offsets the mod uses, in header order.
+	constants = {}
+	for filename in CONSTANT_FILES:
+		for (name, value) in re.findall(
+				r"const uint32_t (k\w+Offset)\s*=\s*(0x[0-9a-fA-F]+);", read_source(filename)):
+			constants[name] = int(value, 16)
+
+	# Find the module each offset in OnModuleLoaded is used with.
+	text = read_source(PATCH_FILE)
+	body = text[text.index("void OnModuleLoaded("):]
+	body = body[:body.index("\n}\n")]
+	modules = {}
+	raw = []
+	module = None
+	for line in body.split("\n"):
+		match = re.search(r"module_id == ModuleId::(\w+)", line)
+		if match:
+			module = match.group(1)
+		for ref in re.findall(r"module_ptr \+\s*(0x[0-9a-fA-F]+|k\w+)", line):
+			if ref.startswith("0x"):
+				raw.append((module, int(ref, 16)))
+			else:
+				modules.setdefault(ref, module)
+
+	offsets = []
+	for (name, value) in sorted(constants.items(), key=lambda c: c[0]):
+		module = modules.get(name)
+		if not module:
+			module = next((m for (p, m) in CONSTANT_PREFIX_MODULES if name.startswith(p)), None)
+		if not module:
+			sys.exit("Can't tell which module %s is in." % name)
+		offsets.append(Offset(name, module, value, "US %#x" % value))
+	for (module, value) in raw:
+		name = "k%sPatch%xOffset" % (module.capitalize(), value)
+		offsets.append(Offset(name, module, value, "OnModuleLoaded, US %#x" % value))
+	for spawn in data.spawns:
+		offsets.append(Offset(
+			None, spawn["module"], spawn["offset"],
+			"%s, US %#x" % (spawn["name"], spawn["offset"])))
+	return offsets
+
+def is_branch(word):
+	# b / bl (opcode 18); their displacements change with the code around them.
+	return word[0] >> 2 == 18
+
+def build_signature(rel, start, end):
+	# Returns a compiled pattern for rel[start:end], with branches wildcarded,
+	# or the literal bytes if there are none.
+	parts = []
+	literal = True
+	for pos in range(start, end, 4):
+		word = rel[pos:pos+4]
+		if len(word) == 4 and is_branch(word):
+			parts.append(b".{4}")
+			literal = False
+		else:
+			parts.append(re.escape(word))
+	if literal:
+		return rel[start:end]
+	return re.compile(b"".join(parts), re.S)
+
+def find_all(data, signature, limit=2):
+	# Returns up to `limit` positions `signature` is found at in `data`.
+	found = []
+	pos = 0
+	while len(found) < limit:
+		if isinstance(signature, bytes):
+			pos = data.find(signature, pos)
+		else:
+			match = signature.search(data, pos)
+			pos = match.start() if match else -1
+		if pos < 0:
+			break
+		found.append(pos)
+		pos += 1
+	return found
+
+def scan_module(task):
+	# Returns (region, module, {US offset: offset in the region or None}).
+	(region, base_dir, rel_dir, module, values) = task
+	filename = module.lower() + ".rel"
+	with open(os.path.join(base_dir, filename), "rb") as f:
+		base = f.read()
+	with open(os.path.join(rel_dir, filename), "rb") as f:
+		rel = f.read()
+	results = {}
+	for value in values:
+		results[value] = None
+		for length in SIGNATURE_LENGTHS:
+			for placement in SIGNATURE_PLACEMENTS:
+				start = max(0, value - int(length * placement) & ~3)
+				end = min(len(base), start + length)
+				signature = build_signature(base, start, end)
+				if len(find_all(base, signature)) != 1:
+					continue
+				found = find_all(rel, signature)
+				if len(found) == 1:
+					results[value] = found[0] + value - start
+					break
+			if results[value] is not None:
+				break
+	return (region, module, results)
+
+def write_header(filename, region, offsets, found):
+	with open(filename, "w") as out:
+		out.write("// Generated by regionscan.py; do not edit.\n")
+		out.write("// Offsets into the %s area RELs matching the US ones.\n\n" % region.upper())
+		out.write("#pragma once\n\n#include <cstdint>\n\n")
+		out.write("namespace mod::region_offsets::%s {\n\n" % region)
+		for offset in offsets:
+			if offset.name:
+				out.write("constexpr const uint32_t %s = %#x;  // %s\n" % (
+					offset.name, found[(offset.module, offset.offset)] or 0, offset.comment))
+		out.write("\n// Battle unit setup offsets, in kEnemyModuleInfo's order.\n")
+		out.write("constexpr const uint32_t kBattleUnitSetupOffsets[] = {\n")
+		for offset in offsets:
+			if not offset.name:
+				out.write("    %#x,  // %s\n" % (
+					found[(offset.module, offset.offset)] or 0, offset.comment))
+		out.write("};\n\n}\n")
+
+def main(argc, argv):
+	options = {}
+	regions = {}
+	for arg in argv[1:]:
+		if arg.startswith("--"):
+			(key, _, value) = arg[2:].partition("=")
+			options[key] = value
+		elif "=" in arg:
+			(region, rel_dir) = arg.split("=", 1)
+			regions[region.lower()] = rel_dir
+		else:
+			sys.exit("Expected <region>=<disc rel dir>, got '%s'." % arg)
+	if BASE_REGION not in regions or len(regions) < 2:
+		sys.exit("Usage: python regionscan.py [options] us=<disc rel dir> <region>=<dir> ...")
+	base_dir = regions.pop(BASE_REGION)
+
+	data = enemygen.EnemyData()
+	data_file = options.get("data", os.path.join(SCRIPT_DIR, "..", "enemygen", "pit_enemies.txt"))
+	try:
+		data.parse(data_file)
+	except enemygen.DataError as e:
+		sys.exit("%s: %s" % (data_file, e))
+	offsets = read_offsets(data)
+
+	by_module = {}
+	for offset in offsets:
+		by_module.setdefault(offset.module, set()).add(offset.offset)
+	tasks = [
+		(region, base_dir, rel_dir, module, sorted(values))
+		for (region, rel_dir) in sorted(regions.items())
+		for (module, values) in sorted(by_module.items())]
+
+	found = dict((region, {}) for region in regions)
+	with concurrent.futures.ProcessPoolExecutor() as executor:
+		for (region, module, results) in executor.map(scan_module, tasks):
+			for (value, result) in results.items():
+				found[region][(module, value)] = result
+
+	missing = 0
+	out_dir = options.get("out", DEFAULT_OUT_DIR)
+	for region in sorted(regions):
+		for offset in offsets:
+			if found[region][(offset.module, offset.offset)] is None:
+				print("%s: %s (%s) not found" % (region, offset.name or "setup", offset.comment))
+				missing += 1
+		filename = os.path.join(out_dir, "region_offsets_%s.h" % region)
+		write_header(filename, region, offsets, found[region])
+		print("Wrote %s." % filename)
+	if missing:
+		print("%d offsets not found; they're 0 in the headers." % missing)
+	return 1 if missing else 0
+
+if __name__ == "__main__":
+	sys.exit(main(len(sys.argv), sys.argv))
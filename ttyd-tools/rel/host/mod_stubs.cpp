@@ -0,0 +1,29 @@
+#include "flight_recorder.h"
+#include "randomizer.h"
+#include "randomizer_menu.h"
+
+#include <cstdint>
+
+// The rest of the mod the host sources reference, reduced to what the
+// randomizer's state needs (no hooks, menus or recording on the host).
+namespace mod::flight_recorder {
+
+void RecordSeed(uint32_t seed) {}
+
+}
+
+namespace mod::pit_randomizer {
+
+namespace {
+
+Randomizer g_HostRandomizer;
+
+}
+
+Randomizer::Randomizer() {}
+RandomizerMenu::RandomizerMenu() {}
+
+// Always set, unlike the mod's (set on Init), since there's nothing to hook.
+Randomizer* g_Randomizer = &g_HostRandomizer;
+
+}
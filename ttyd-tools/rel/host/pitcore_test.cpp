@@ -0,0 +1,153 @@
+#include "platform.h"
+#include "randomizer.h"
+#include "randomizer_data.h"
+#include "randomizer_state.h"
+
+#include <ttyd/mariost.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Checks of the randomizer's generation logic run natively against
+// libpitcore.a (`make check_host`); exits non-zero if any check fails.
+namespace mod::pit_randomizer {
+
+namespace {
+
+int32_t g_NumFailures = 0;
+
+void Check(bool condition, const char* description) {
+    if (condition) return;
+    printf("FAILED: %s\n", description);
+    ++g_NumFailures;
+}
+
+// Starts a new file with the given name, as the game does on file creation
+// (from a cleared state, since Load doesn't reset e.g. the play stats).
+void NewFile(const char* name) {
+    platform::Reset(/* rand_seed = */ 1);
+    memset(&g_Randomizer->state_, 0, sizeof(RandomizerState));
+    strcpy(const_cast<char*>(platform::GetMarioSt()->saveFileName), name);
+    g_Randomizer->state_.Load(/* new_save = */ true);
+}
+
+// Picks the enemies for every floor of a run, and writes them to `out`
+// (5 spawn indices per floor, -1 past the number picked).
+void PickAllEnemies(int32_t* out) {
+    RandomizerState& state = g_Randomizer->state_;
+    for (int32_t floor = 0; floor < 100; ++floor) {
+        state.floor_ = floor;
+        SelectEnemies(floor);
+        int32_t count;
+        const int32_t* enemies = GetSelectedEnemies(&count);
+        for (int32_t i = 0; i < 5; ++i) {
+            out[floor * 5 + i] = i < count ? enemies[i] : -1;
+        }
+    }
+}
+
+void TestSameSeedSameEnemies() {
+    static int32_t first[500];
+    static int32_t second[500];
+    NewFile("pitcore");
+    PickAllEnemies(first);
+    NewFile("pitcore");
+    PickAllEnemies(second);
+    Check(!memcmp(first, second, sizeof(first)),
+          "the same filename picks the same enemies");
+    NewFile("pitcore2");
+    PickAllEnemies(second);
+    Check(memcmp(first, second, sizeof(first)),
+          "a different filename picks different enemies");
+}
+
+void TestSaveLoadRoundTrip() {
+    NewFile("pitcore");
+    RandomizerState& state = g_Randomizer->state_;
+    state.floor_ = 42;
+    state.options_ |= RandomizerState::MERLEE;
+    const uint32_t seed = state.seed_;
+    state.Save();
+    state.floor_ = 0;
+    state.options_ = 0;
+    Check(state.Load(/* new_save = */ false), "a saved state loads");
+    Check(state.floor_ == 42, "loading restores the floor");
+    Check(state.options_ & RandomizerState::MERLEE,
+          "loading restores the options");
+    Check(state.seed_ == seed, "loading restores the seed");
+}
+
+struct PlayStatIncrement {
+    RandomizerState::PlayStats stat;
+    int32_t amount;
+};
+
+// A few battles' worth of increments, with TIMES_RAN_AWAY and ITEMS_USED
+// (capped at 9,999) running past their caps in the middle of the batch.
+constexpr const PlayStatIncrement kPlayStatIncrements[] = {
+    { RandomizerState::TURNS_SPENT, 3 },
+    { RandomizerState::ENEMY_DAMAGE, 4 },
+    { RandomizerState::ENEMY_DAMAGE, 4 },
+    { RandomizerState::TIMES_RAN_AWAY, 9'990 },
+    { RandomizerState::PLAYER_DAMAGE, 2 },
+    { RandomizerState::TIMES_RAN_AWAY, 5 },
+    { RandomizerState::COINS_EARNED, 0x12345 },
+    { RandomizerState::TIMES_RAN_AWAY, 5 },
+    { RandomizerState::ITEMS_USED, 9'999 },
+    { RandomizerState::TIMES_RAN_AWAY, 5 },
+    { RandomizerState::ITEMS_USED, 1 },
+    { RandomizerState::COINS_SPENT, 0x100 },
+    { RandomizerState::ENEMY_DAMAGE, 0xff },
+};
+constexpr const int32_t kNumPlayStatIncrements =
+    sizeof(kPlayStatIncrements) / sizeof(kPlayStatIncrements[0]);
+
+// Batched play stat increments (IncrementPlayStat, then FlushPlayStats once)
+// must give the same totals as flushing after every increment, including
+// once a stat hits its cap partway through the batch.
+void TestBatchedPlayStats() {
+    RandomizerState& state = g_Randomizer->state_;
+    int32_t unbatched_totals[kNumPlayStatIncrements];
+    uint8_t unbatched_stats[sizeof(state.play_stats_)];
+    NewFile("pitcore");
+    for (int32_t i = 0; i < kNumPlayStatIncrements; ++i) {
+        const PlayStatIncrement& inc = kPlayStatIncrements[i];
+        state.IncrementPlayStat(inc.stat, inc.amount);
+        state.FlushPlayStats();
+        unbatched_totals[i] = state.GetPlayStat(inc.stat);
+    }
+    memcpy(unbatched_stats, state.play_stats_, sizeof(unbatched_stats));
+    // GetPlayStat caps what it returns, so check the stored (big-endian)
+    // value; TIMES_RAN_AWAY is the two bytes at play_stats_[3].
+    Check((state.play_stats_[3] << 8 | state.play_stats_[4]) == 9'999,
+          "a play stat is stored capped");
+
+    NewFile("pitcore");
+    for (int32_t i = 0; i < kNumPlayStatIncrements; ++i) {
+        const PlayStatIncrement& inc = kPlayStatIncrements[i];
+        state.IncrementPlayStat(inc.stat, inc.amount);
+        Check(state.GetPlayStat(inc.stat) == unbatched_totals[i],
+              "a pending play stat reads the same as a flushed one");
+    }
+    state.FlushPlayStats();
+    Check(!memcmp(state.play_stats_, unbatched_stats, sizeof(unbatched_stats)),
+          "batched play stats flush to the same totals as unbatched ones");
+}
+
+}
+
+}
+
+int main() {
+    using namespace ::mod::pit_randomizer;
+    TestSameSeedSameEnemies();
+    TestSaveLoadRoundTrip();
+    TestBatchedPlayStats();
+    if (g_NumFailures) {
+        printf("%d check(s) failed.\n", static_cast<int>(g_NumFailures));
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
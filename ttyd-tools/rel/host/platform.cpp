@@ -0,0 +1,93 @@
+#include "platform.h"
+
+#include <ttyd/battle_database_common.h>
+#include <ttyd/battle_monosiri.h>
+#include <ttyd/mario_pouch.h>
+#include <ttyd/mariost.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::platform {
+
+namespace {
+
+using ::ttyd::battle_monosiri::MonosiriMsgEntry;
+using ::ttyd::mario_pouch::PouchData;
+using ::ttyd::mariost::MarioSt_Globals;
+namespace BattleUnitType = ::ttyd::battle_database_common::BattleUnitType;
+
+PouchData g_Pouch;
+// Raw storage, since MarioSt_Globals isn't default-constructible.
+alignas(8) uint8_t g_MarioSt[sizeof(MarioSt_Globals)];
+uint32_t g_RandState = 1;
+uint64_t g_Time = 0;
+// Tattle log entries (all empty), for every unit type up to Bonetail.
+MonosiriMsgEntry g_Monosiri[BattleUnitType::BONETAIL + 1];
+int16_t g_PartyMaxHpTable[32];
+
+}
+
+PouchData* GetPouch() {
+    return &g_Pouch;
+}
+
+MarioSt_Globals* GetMarioSt() {
+    return reinterpret_cast<MarioSt_Globals*>(g_MarioSt);
+}
+
+uint32_t Rand(uint32_t range) {
+    // A plain LCG; doesn't reproduce the game's own sequence.
+    g_RandState = g_RandState * 1103515245 + 12345;
+    const uint32_t value = (g_RandState >> 16) & 0x7fff;
+    return range ? value * range / 0x8000 : 0;
+}
+
+uint64_t GetTime() {
+    return g_Time;
+}
+
+const char* MsgSearch(const char* key) {
+    // No message data on the host; the key stands in for its message.
+    return key;
+}
+
+MonosiriMsgEntry* GetUnitMonosiriPtr(int32_t unit_type) {
+    return &g_Monosiri[unit_type];
+}
+
+int16_t PouchGetMaxHp() {
+    return g_Pouch.max_hp;
+}
+
+uint32_t PouchGetItem(int32_t item_type) {
+    for (int32_t i = 0; i < 20; ++i) {
+        if (!g_Pouch.items[i]) {
+            g_Pouch.items[i] = item_type;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int32_t PouchGetPartyColor(int32_t party_member) {
+    return 0;
+}
+
+int16_t* GetPartyMaxHpTable() {
+    return g_PartyMaxHpTable;
+}
+
+void Reset(uint32_t rand_seed) {
+    memset(&g_Pouch, 0, sizeof(g_Pouch));
+    memset(g_MarioSt, 0, sizeof(g_MarioSt));
+    memset(g_PartyMaxHpTable, 0, sizeof(g_PartyMaxHpTable));
+    g_RandState = rand_seed;
+    g_Time = 0;
+}
+
+void SetTime(uint64_t ticks) {
+    g_Time = ticks;
+}
+
+}
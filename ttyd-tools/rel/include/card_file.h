@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// Writes the mod's debug buffers (flight recorder snapshots, run telemetry,
+// input logs) to files on the memory card in slot A, so the host tools can
+// read them from a copy of the card (e.g. a .gci export) without a RAM dump,
+// and reads them back (e.g. to replay a recorded input log). Requests are
+// queued, and carried out from the main loop over the following frames, one
+// card operation at a time, so the game never waits on the card; they only
+// start once the game has left the card alone for a while.
+namespace mod::card_file {
+
+struct Request;
+typedef void (*RequestCallback)(Request* request, bool success);
+
+// A read / write of part of a file. Owned by the caller, who mustn't change
+// it (or the data it points to) until it's done.
+struct Request {
+    const char*     name;
+    void*           data;
+    uint32_t        size;
+    // Where in the file to start; a multiple of the 8 KiB sector size.
+    uint32_t        offset;
+    // For writes, if the file doesn't exist yet, it's created with room for
+    // at least this many bytes (or offset + size, if larger), rounded up to
+    // whole sectors.
+    uint32_t        file_size;
+    bool            write;
+    // Called from Update once the request is done (or has failed, e.g. if
+    // there's no usable card, or it's out of space).
+    RequestCallback on_done;
+
+    // Set while queued / in progress.
+    bool            pending;
+};
+
+// Queues a request; returns false if it's already pending or the queue is
+// full.
+bool Submit(Request* request);
+// Starts / advances the request in progress; called once per frame.
+void Update();
+
+}
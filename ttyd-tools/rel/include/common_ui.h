@@ -8,6 +8,21 @@ namespace mod {
 
 void RegisterDrawCallback(
     void (*func)(), ttyd::dispdrv::CameraId camera_layer, float order = 0.f);
+
+// A persistent on-screen overlay; drawn by the overlay compositor on its
+// camera layer (in increasing order) on every frame `visible` returns true.
+struct Overlay {
+    void (*draw)();
+    bool (*visible)();      // If nullptr, the overlay is always drawn.
+    ttyd::dispdrv::CameraId camera_layer;
+    float order;
+};
+
+// Adds an overlay to the compositor; `overlay` must stay valid indefinitely.
+void RegisterOverlay(const Overlay* overlay);
+// Registers one display callback per camera layer with visible overlays,
+// drawing them as a batch; should be called once per frame.
+void DrawOverlays();
     
 void GetTextDimensions(
     const char* text, float scale, float* out_width, float* out_height);
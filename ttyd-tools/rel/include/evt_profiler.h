@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Profiler for the evt interpreter, tracking instructions run, USER_FUNC calls
+// and time spent per script. Only compiled into profiling builds (built with
+// `make PROFILE=1`, defining PIT_PROFILING); otherwise all calls are no-ops.
+namespace mod::evt_profiler {
+
+#ifdef PIT_PROFILING
+
+// Hooks the interpreter's per-script dispatch function.
+void Init();
+// Advances the frame counter, publishing results when a window elapses.
+void Update();
+// Toggles whether the on-screen table is displayed.
+void ToggleDisplay();
+// Associates a human-readable name with a script's starting address.
+void RegisterScriptName(const void* evt_code, const char* name);
+
+#else
+
+inline void Init() {}
+inline void Update() {}
+inline void ToggleDisplay() {}
+inline void RegisterScriptName(const void* evt_code, const char* name) {}
+
+#endif
+
+}
+
+// Registers a custom script under the name of its EVT_BEGIN identifier.
+#define EVT_PROFILER_REGISTER(evt) \
+    mod::evt_profiler::RegisterScriptName((evt), #evt)
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <gc/OSLink.h>
+
+#include <cstdint>
+
+// Flight recorder keeping the last few seconds of mod events (frame times, RNG
+// state, floor changes, hooks run, modules linked / unlinked) in a ring buffer.
+// When the game crashes (or a snapshot is requested), recording stops and the
+// CPU context is saved alongside it, for the host tool (flightrec.py) to read
+// and symbolize from a RAM dump (or for a requested snapshot, from the copy
+// written to the memory card).
+namespace mod::flight_recorder {
+
+// Mod hooks whose entry is recorded.
+namespace HookId {
+    enum e {
+        kMapLoad = 1,
+        kMapUnload,
+        kSelectEnemies,
+        kBattleStart,
+        kBattleEnd,
+        kFileLoad,
+    };
+}
+
+// Fills in the recorder's header and subscribes to map / battle events;
+// recording starts with the next frame.
+void Init();
+// Records the OSTime ticks the game's main function took this frame, and
+// starts a new frame.
+void RecordFrame(uint32_t ticks);
+// Records entering one of the mod's hooks, with an optional argument.
+void RecordHook(HookId::e hook, uint32_t value = 0);
+// Records the start of a new floor.
+void RecordFloor(int32_t floor, uint32_t rng_state);
+// Records the RNG being seeded for a new file.
+void RecordSeed(uint32_t seed);
+// Records a relocatable module being linked (loaded) or unlinked.
+void RecordModuleLink(const gc::OSLink::OSModuleInfo* module, bool linked);
+// Records the main heap's peak usage (and smallest largest free block) while
+// a map with the given module pairing was loaded.
+void RecordHeapPeaks(
+    uint32_t primary_module, uint32_t secondary_module,
+    uint32_t live_high_water, uint32_t largest_free_low_water);
+// Records an allocation that failed (or is about to).
+void RecordAllocFailure(uint32_t heap, uint32_t size);
+// Stops recording and saves the crashed context; only the first call has any
+// effect. Called from the game's crash handler, where interrupts are off, so
+// this only touches RAM (the card can't be written from there).
+void OnCrash();
+// Stops recording (saving a snapshot for a RAM dump, and queueing a copy to
+// the memory card), or resumes it if stopped by a previous call (once the
+// copy is written).
+void ToggleSnapshot();
+
+}
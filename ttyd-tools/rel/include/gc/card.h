@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+namespace gc::card {
+
+extern "C" {
+
+// Result codes (CARD_RESULT_*).
+namespace CardResult {
+    enum e {
+        kReady = 0,
+        kBusy = -1,
+        kWrongDevice = -2,
+        kNoCard = -3,
+        kNoFile = -4,
+        kIoError = -5,
+        kBroken = -6,
+        kExist = -7,
+        kNoEntry = -8,
+        kInsSpace = -9,
+        kNoPerm = -10,
+        kLimit = -11,
+        kNameTooLong = -12,
+        kEncoding = -13,
+        kCanceled = -14,
+        kFatalError = -128,
+    };
+}
+
+struct CARDFileInfo {
+    int32_t     chan;
+    int32_t     fileNo;
+    int32_t     offset;
+    int32_t     length;
+    uint16_t    iBlock;
+    uint16_t    unk_12;
+} __attribute__((__packed__));
+
+static_assert(sizeof(CARDFileInfo) == 0x14);
+
+typedef void (*CARDCallback)(int32_t chan, int32_t result);
+
+// CARDBios.c
+int32_t CARDGetResultCode(int32_t chan);
+
+// CARDMount.c
+int32_t CARDProbeEx(int32_t chan, int32_t* memSize, int32_t* sectorSize);
+int32_t CARDMountAsync(
+    int32_t chan, void* workArea, CARDCallback detachCallback,
+    CARDCallback attachCallback);
+int32_t CARDUnmount(int32_t chan);
+
+// CARDOpen.c
+int32_t CARDOpen(int32_t chan, const char* fileName, CARDFileInfo* fileInfo);
+int32_t CARDClose(CARDFileInfo* fileInfo);
+
+// CARDCreate.c
+int32_t CARDCreateAsync(
+    int32_t chan, const char* fileName, uint32_t size, CARDFileInfo* fileInfo,
+    CARDCallback callback);
+
+// CARDRead.c
+int32_t CARDReadAsync(
+    CARDFileInfo* fileInfo, void* buf, int32_t length, int32_t offset,
+    CARDCallback callback);
+
+// CARDWrite.c
+int32_t CARDWriteAsync(
+    CARDFileInfo* fileInfo, const void* buf, int32_t length, int32_t offset,
+    CARDCallback callback);
+
+}
+
+}
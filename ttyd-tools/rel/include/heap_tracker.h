@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Tracks memory pressure on the game's heaps: live bytes and high-water marks
+// for each __memAlloc heap, the largest free block (fragmentation) of those
+// and the map heap, and bytes allocated from the map heap. Peaks are kept per
+// loaded module pairing, and an on-screen warning is shown when a heap is
+// about to run out, or the secondary module won't fit in its slot.
+namespace mod::heap_tracker {
+
+// Hooks the allocators, registers the low-memory warning's overlay, and
+// subscribes to map unloads (to fold each map's peaks into its module
+// pairing's stats, and the flight recorder).
+void Init();
+// Samples the heaps' largest free blocks; should be called once per frame.
+void Update();
+// Records the REL about to be copied into the map's secondary module slot
+// (pMapAlloc), and warns if it won't fit there, or if its bss won't fit in
+// the buffer for it.
+void OnSecondaryModuleLoad(
+    const void* rel_data, uint32_t size, uint32_t bss_capacity);
+// Returns a heap's peak live bytes since the current map was loaded.
+uint32_t GetLiveHighWater(int32_t heap);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Records the first controller's inputs each frame (run-length encoded) from
+// the start of a new file, and plays them back on a later new file, so the
+// same run can be repeated to compare performance before and after a change.
+// While recording or replaying, the game's irand is also replaced with a
+// fixed-seed generator, so the game's own random choices repeat as well.
+// Stick positions are quantized (with a deadzone) as they're recorded, and
+// the recording is streamed out to a memory card file in the background as
+// it's recorded (and back in as it's replayed), so a whole run fits, and can
+// be replayed after a restart.
+namespace mod::input_replay {
+
+// Fills in the log's header; recording / replay is off until armed.
+void Init();
+// Streams the recording out to / the replay in from the memory card (via
+// card_file requests); called once per frame.
+void Update();
+// Arms recording from the next new file, or stops recording / replay if
+// either is in progress. Returns whether recording was armed (not until the
+// last recording has been written out to the card).
+bool ToggleRecording();
+// Arms replay of the last recording (from RAM, or else the memory card, once
+// its header has been read; a warning is shown if there isn't one) from the
+// next new file. Returns false if there is no recording to replay.
+bool ArmReplay();
+// Starts an armed recording / replay; called after a new file is set up.
+// For a replay, the file's name and options are set to the recording's.
+void OnNewFile();
+
+}
@@ -99,6 +99,13 @@ enum class KeyCode : uint8_t
 	kEnter        = 0x61,
 };
 
+struct KeyEvent
+{
+	uint64_t time; // OSTime at which the keyboard was polled
+	KeyCode code;
+	bool down;
+};
+
 class Keyboard
 {
 public:
@@ -107,6 +114,21 @@ public:
 	void setChannel(int channel);
 	void update();
 
+	// Events received since the previous update, in the order they occurred
+	int getEventCount()
+	{
+		return mEventCount;
+	}
+	const KeyEvent &getEvent(int index)
+	{
+		return mEvents[index];
+	}
+	// Events lost since connecting because the queue was full
+	uint32_t getDroppedEventCount()
+	{
+		return mDroppedEventCount;
+	}
+
 	int getKeyDownCount()
 	{
 		return mKeysDownCount;
@@ -202,25 +224,47 @@ public:
 private:
 	bool connect();
 	void disconnect();
+	void poll();
+	void pushEvent(uint64_t time, KeyCode code, bool down);
+
+	static void pollingHandler(int16_t interrupt, void *context);
 
 public:
 	const static int cMaxKeysPressed = 3;
+	// Must be a power of 2
+	const static int cEventQueueSize = 32;
 
 private:
-	int mKeysPrevCount = 0;
-	KeyCode mKeysPrev[cMaxKeysPressed];
-
 	int mKeysDownCount = 0;
 	KeyCode mKeysDown[cMaxKeysPressed];
 
 	int mKeysReleasedCount = 0;
-	KeyCode mKeysReleased[cMaxKeysPressed];
+	KeyCode mKeysReleased[cEventQueueSize];
 
 	int mKeysPressedCount = 0;
-	KeyCode mKeysPressed[cMaxKeysPressed];
+	KeyCode mKeysPressed[cEventQueueSize];
 
+	int mEventCount = 0;
+	KeyEvent mEvents[cEventQueueSize];
+
+	// Single-producer / single-consumer queue; written by poll() (from the
+	// SI polling interrupt, if a handler could be registered), and drained
+	// by update()
+	KeyEvent mEventQueue[cEventQueueSize];
+	volatile uint32_t mEventWrite = 0;
+	volatile uint32_t mEventRead = 0;
+	uint32_t mDroppedEventCount = 0;
+
+	// Keys down as of the last poll (owned by the producer)
+	int mPolledKeysCount = 0;
+	KeyCode mPolledKeys[cMaxKeysPressed];
+
+	volatile bool mDisconnectPending = false;
+	bool mPollingHandlerRegistered = false;
 	bool mConnected = false;
 	int mChannel = -1;
+
+	static Keyboard *sPollingKeyboard;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "common_types.h"
+
+#include <ttyd/seqdrv.h>
+
+#include <cstdint>
+
+// Interns area / map names into integer ids when the map or game sequence
+// changes, and publishes those changes to subscribers, so per-frame code can
+// compare ids (or keep event-driven state) instead of comparing names.
+namespace mod::map_events {
+
+// Interned map name; the area's ModuleId in the upper byte and the map's
+// number in the lower (e.g. "jon_03" is JON << 8 | 3).
+using MapId = uint16_t;
+
+constexpr MapId MakeMapId(ModuleId::e area, int32_t number) {
+    return static_cast<MapId>(area << 8 | number);
+}
+
+// Names that don't correspond to any known area's maps.
+constexpr const MapId kUnknownMap = 0;
+// The pseudo-map loaded to return to the title screen.
+constexpr const MapId kTitleMap = 0xff;
+
+constexpr const MapId kDmo00 = MakeMapId(ModuleId::DMO, 0);
+constexpr const MapId kTik06 = MakeMapId(ModuleId::TIK, 6);
+constexpr const MapId kTou03 = MakeMapId(ModuleId::TOU, 3);
+constexpr const MapId kAaa00 = MakeMapId(ModuleId::AAA, 0);
+
+namespace EventType {
+    enum e {
+        kSeqChanged = 1,    // After the game's next sequence was set.
+        kMapLoaded,         // After a map's module was loaded.
+        kMapUnloading,      // Just before a map's module is unloaded.
+        kBattleStart,
+        kBattleEnd,
+    };
+}
+
+struct Event {
+    EventType::e type;
+    ttyd::seqdrv::SeqIndex seq;     // The next sequence.
+    MapId map;                      // Next map if kSeqChanged, else current.
+    ModuleId::e area;               // The current area.
+};
+
+// Adds a callback to run on every event; `callback` must stay valid
+// indefinitely. Callbacks run in the order they were added.
+void Subscribe(void (*callback)(const Event& event));
+
+// Returns the id for an area name (e.g. "jon"), or INVALID_MODULE.
+ModuleId::e InternArea(const char* name);
+// Returns the id for a map name (e.g. "jon_03"), or kUnknownMap.
+MapId InternMap(const char* name);
+
+// Publish events; called from the sequence change / map load hooks.
+void OnSeqChanged(ttyd::seqdrv::SeqIndex seq, const char* map_name);
+void OnMapLoading();
+void OnMapLoaded();
+void OnMapUnloading();
+
+MapId GetCurrentMapId();
+ModuleId::e GetCurrentAreaId();
+// The map about to be loaded (as of the last sequence change or map load).
+MapId GetNextMapId();
+// The area about to be loaded (as of the last map load).
+ModuleId::e GetNextAreaId();
+
+}
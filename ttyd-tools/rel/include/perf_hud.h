@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// On-screen performance HUD, showing frame times, heap usage, and evt and
+// display entry counts. Does no work (besides checking IsEnabled) when hidden.
+namespace mod::perf_hud {
+
+// Registers the HUD's overlay.
+void Init();
+// Toggles whether the HUD is displayed; the display entry counter's hook is
+// only installed the first time it is shown.
+void ToggleDisplay();
+// Returns whether the HUD is displayed (and frames should be timed).
+bool IsEnabled();
+// Records the OSTime ticks the game's main function took this frame.
+void RecordFrame(uint32_t ticks);
+
+}
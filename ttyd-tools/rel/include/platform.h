@@ -0,0 +1,82 @@
+#pragma once
+
+#include <ttyd/battle_monosiri.h>
+#include <ttyd/mario_pouch.h>
+#include <ttyd/mariost.h>
+
+#ifndef PIT_HOST
+#include <gc/OSTime.h>
+#include <ttyd/msgdrv.h>
+#include <ttyd/system.h>
+#endif
+
+#include <cstdint>
+
+// The game state and services the randomizer's generation / balance logic
+// (randomizer_data, randomizer_state, randomizer_strings) reads directly.
+// In the mod these are inline calls straight into the game; builds made with
+// `make host` (defining PIT_HOST) instead link host/platform.cpp, which backs
+// them with plain structs, so that logic can be run natively.
+namespace mod::platform {
+
+#ifndef PIT_HOST
+
+inline ttyd::mario_pouch::PouchData* GetPouch() {
+    return ttyd::mario_pouch::pouchGetPtr();
+}
+inline ttyd::mariost::MarioSt_Globals* GetMarioSt() {
+    return ttyd::mariost::g_MarioSt;
+}
+// The game's RNG; returns a value in [0, range).
+inline uint32_t Rand(uint32_t range) {
+    return ttyd::system::irand(range);
+}
+// The current time in OSTime ticks.
+inline uint64_t GetTime() {
+    return gc::OSTime::OSGetTime();
+}
+// Looks up a message by its key.
+inline const char* MsgSearch(const char* key) {
+    return ttyd::msgdrv::msgSearch(key);
+}
+// Returns the Tattle log entry for a unit type.
+inline ttyd::battle_monosiri::MonosiriMsgEntry* GetUnitMonosiriPtr(
+    int32_t unit_type) {
+    return ttyd::battle_monosiri::battleGetUnitMonosiriPtr(unit_type);
+}
+inline int16_t PouchGetMaxHp() {
+    return ttyd::mario_pouch::pouchGetMaxHP();
+}
+// Adds an item to the inventory; returns 0 if there's no room.
+inline uint32_t PouchGetItem(int32_t item_type) {
+    return ttyd::mario_pouch::pouchGetItem(item_type);
+}
+inline int32_t PouchGetPartyColor(int32_t party_member) {
+    return ttyd::mario_pouch::pouchGetPartyColor(party_member);
+}
+// The partners' max HP at each rank.
+inline int16_t* GetPartyMaxHpTable() {
+    return ttyd::mario_pouch::_party_max_hp_table;
+}
+
+#else
+
+ttyd::mario_pouch::PouchData* GetPouch();
+ttyd::mariost::MarioSt_Globals* GetMarioSt();
+uint32_t Rand(uint32_t range);
+uint64_t GetTime();
+const char* MsgSearch(const char* key);
+ttyd::battle_monosiri::MonosiriMsgEntry* GetUnitMonosiriPtr(int32_t unit_type);
+int16_t PouchGetMaxHp();
+uint32_t PouchGetItem(int32_t item_type);
+int32_t PouchGetPartyColor(int32_t party_member);
+int16_t* GetPartyMaxHpTable();
+
+// Host-only; resets the state backing the functions above (zeroes the pouch
+// and globals, and reseeds Rand), and sets the time GetTime returns.
+void Reset(uint32_t rand_seed);
+void SetTime(uint64_t ticks);
+
+#endif
+
+}
@@ -15,8 +15,6 @@ public:
     void Init();
     // Code that runs every frame.
     void Update();
-    // Code that runs drawing-related code every frame.
-    void Draw();
     
     RandomizerState state_;
     RandomizerMenu menu_;
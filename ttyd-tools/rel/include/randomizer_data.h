@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common_types.h"
+#include "randomizer_state.h"
 
 #include <ttyd/battle_database_common.h>
 #include <ttyd/battle_unit.h>
@@ -10,9 +11,21 @@
 
 namespace mod::pit_randomizer {
 
+// The pools of items PickRandomItem can pick from.
+namespace ItemPool {
+    enum e {
+        NORMAL = 0,
+        RECIPE,
+        BADGE,      // Stackable badges.
+    };
+}
+
 // Selects the enemies to spawn on a given floor, and returns the supplemental
 // module to be loaded, if any.
 ModuleId::e SelectEnemies(int32_t floor);
+// Returns the enemies picked by the last SelectEnemies call (indices into the
+// spawn table), and sets *out_count to the number picked.
+const int32_t* GetSelectedEnemies(int32_t* out_count);
     
 // Procedurally builds a NpcSetupInfo and BattleSetupData based on the floor #.
 // Returns the salient NPC info (the battle is constructed in place over
@@ -53,6 +66,14 @@ void GetBattleConditionString(char* out_buf);
 int32_t PickRandomItem(
     bool seeded, int32_t normal_item_weight, int32_t recipe_item_weight,
     int32_t badge_weight, int32_t no_item_weight = 0, bool force_no_partner = false);
+
+// Picks `count` distinct items from one of PickRandomItem's pools, using the
+// mod's random state; takes exactly one Rand call per item picked, tagged with
+// `source`. force_no_partner works the same as for PickRandomItem.
+void PickUniqueRandomItems(
+    ItemPool::e pool, int32_t count, int32_t* out_items,
+    bool force_no_partner = false,
+    RandomizerState::RngSource source = RandomizerState::RNG_PICK_RANDOM_ITEM);
     
 // Picks a reward for a chest, updating the randomizer state accordingly.
 // Reward is either an item/badge (if the result > 0) or a partner (-1 to -7).
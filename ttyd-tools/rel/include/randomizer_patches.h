@@ -69,15 +69,18 @@ void DisplayBattleCondition();
 // Changes an enemy's HP and level, as well as a few other minor changes.
 void AlterUnitKindParams(
     ttyd::battle_database_common::BattleUnitKind* unit_kind_params);
-// Temporarily changes an enemy's ATK or DEF power, and returns the result
-// of damage calculation with those changes in effect.
+// Points an enemy unit's parts at copies of their defense tables with DEF
+// scaled for the current floor, and caches its scaled ATK for the battle.
+void ShadowEnemyUnitStats(ttyd::battle_unit::BattleWorkUnit* unit);
+// Runs damage calculation with an enemy's scaled ATK (on a copy of the
+// weapon used) and DEF (from its scaled defense tables) in effect.
 int32_t AlterDamageCalculation(
     ttyd::battle_unit::BattleWorkUnit* attacker,
     ttyd::battle_unit::BattleWorkUnit* target,
     ttyd::battle_unit::BattleWorkUnitPart* target_part,
     ttyd::battle_database_common::BattleWeapon* weapon,
     uint32_t* unk0, uint32_t unk1);
-// Does the same, but with FP damage.
+// Does the same, but with FP damage (only ATK is scaled).
 int32_t AlterFpDamageCalculation(
     ttyd::battle_unit::BattleWorkUnit* attacker,
     ttyd::battle_unit::BattleWorkUnit* target,
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Practice mode; keeps a snapshot in RAM of everything needed to replay the
+// current Pit floor, so it can be retried without reloading from the card.
+namespace mod::pit_randomizer {
+
+// Snapshots the pouch, randomizer state and GSW / GSWF on entering a floor,
+// before its enemies (or Charlieton's stock) are picked.
+void SavePracticeSnapshot();
+// Discards the current snapshot (e.g. when a different file is loaded).
+void ClearPracticeSnapshot();
+// Restores the last snapshot and re-enters the floor it was taken on.
+// Returns false if there is no snapshot, or it can't be restored right now.
+bool RestorePracticeSnapshot();
+
+}
@@ -1,9 +1,34 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace mod::pit_randomizer {
 
+// Options decoded from RandomizerState's options_ and multipliers, so
+// frequently-run code doesn't need to go through GetOptionValue.
+// Not saved; rebuilt whenever the options change.
+struct OptionsSnapshot {
+    int32_t     hp_multiplier;          // Percent.
+    int32_t     atk_multiplier;         // Percent.
+    int32_t     num_chest_rewards;      // 0 ~ 5 (0 = random).
+    int32_t     switch_party_cost_fp;   // 0 ~ 3.
+    uint32_t    battle_reward_mode;     // BATTLE_REWARD_MODE bits.
+    bool        merlee;
+    bool        superguards_cost_fp;
+    bool        no_exp_mode;
+    bool        start_with_fx;
+    bool        start_with_no_items;
+    bool        yoshi_color_select;
+    bool        shine_sprites_mario;
+    bool        always_enable_audience;
+    bool        weaker_rush_badges;
+    bool        post_100_hp_scaling;
+    bool        post_100_atk_scaling;
+    bool        start_with_partners;
+    bool        start_with_sweet_treat;
+};
+
 struct RandomizerState {
     enum Options_Flags {
         // Options that do not change seeding.
@@ -48,10 +73,42 @@ struct RandomizerState {
         COINS_SPENT,
         SHINE_SPRITES_USED,
     };
+    
+    // Call sites of Rand, for tracing RNG consumption (see rng_trace.h).
+    // Append new values to the end, so traces from old builds still match.
+    enum RngSource {
+        RNG_UNTAGGED = 0,
+        RNG_FILENAME,           // Picking a random filename.
+        RNG_YOSHI_COLOR,
+        RNG_SELECT_ENEMIES,
+        RNG_BUILD_BATTLE,
+        RNG_BATTLE_CONDITION,
+        RNG_PICK_RANDOM_ITEM,   // Enemy items, Charlieton stock, etc.
+        RNG_CHEST_REWARD,
+        RNG_NUM_CHEST_REWARDS,
+        RNG_CHARLIETON_STOCK,
+        
+        RNG_NUM_SOURCES,
+    };
+    
+    // Revisions of how seeded results are generated from the RNG; each save
+    // keeps the generation it was created with, so changes to an algorithm
+    // don't change the results on existing files.
+    enum RngGeneration {
+        RNG_GEN_ORIGINAL = 0,
+        // Charlieton's stock is drawn without replacement, rather than
+        // re-rolling duplicates.
+        RNG_GEN_UNIQUE_DRAWS,
+        // Each RngSource (other than untagged / filename calls) draws from
+        // its own stream, keyed by the seed and floor; see StreamSeed.
+        RNG_GEN_KEYED_STREAMS,
+        
+        RNG_GEN_CURRENT = RNG_GEN_KEYED_STREAMS,
+    };
 
     // Save file revision; makes it possible to add fields while maintaining
     // backwards compatibility, and detect when a vanilla file is loaded.
-    // Current version = 2, compatible versions = 1 ~ 2.
+    // Current version = 4, compatible versions = 1 ~ 4.
     uint8_t     version_;
     
     // Game state.
@@ -59,11 +116,20 @@ struct RandomizerState {
     uint32_t    rng_state_;
     int32_t     floor_;
     uint32_t    reward_flags_;
-    // Used for reloading a save.
-    uint32_t    saved_rng_state_;
+    union {
+        // Used for reloading a save (before RNG_GEN_KEYED_STREAMS).
+        uint32_t    saved_rng_state_;
+        // The seed every RNG stream is derived from (RNG_GEN_KEYED_STREAMS).
+        uint32_t    seed_;
+    };
     uint8_t     load_from_save_;
     uint8_t     disable_partner_badges_in_shop_;
-    uint8_t     unused_[6];
+    // Split log header; the splits themselves are varint-encoded in the
+    // pouch's (unused) e-mail id table. See RecordFloorSplit for the layout.
+    uint16_t    split_log_first_set_;
+    uint8_t     split_log_count_;
+    uint8_t     rng_generation_;    // RngGeneration (0 for versions 1 ~ 2).
+    uint8_t     unused_[2];
     
     // Options that can be set by the player at the start of a file.
     int16_t     hp_multiplier_;
@@ -73,6 +139,13 @@ struct RandomizerState {
     // Holds the value of various stats tracked over the course of a file
     // (total turns in battle, number of items used, etc.)
     uint8_t     play_stats_[20];
+    
+    // Fields from here on are not saved.
+    OptionsSnapshot options_snapshot_;
+    // The state of each source's stream, and the floor it was keyed for
+    // (-1 if not yet used since loading the file).
+    uint32_t    stream_states_[RNG_NUM_SOURCES];
+    int32_t     stream_floors_[RNG_NUM_SOURCES];
 
     // Initializes the randomizer state based on the current save file.
     // Returns whether the randomizer was successfully initialized.
@@ -83,13 +156,28 @@ struct RandomizerState {
     // Seeds the randomizer's RNG state with an input string.
     void SeedRng(const char* str);
     // Increments the RNG state and returns a value in a range [0, n).
-    uint32_t Rand(uint32_t range);
+    // `source` tags the call site in RNG traces; it doesn't affect the result.
+    uint32_t Rand(uint32_t range, RngSource source = RNG_UNTAGGED);
+    // Returns whether this file draws from per-source streams, rather than
+    // consuming rng_state_ for everything.
+    bool UsesKeyedStreams() const;
+    // Returns the starting state of `source`'s stream on `floor`, for a file
+    // seeded with `seed` (RNG_GEN_KEYED_STREAMS). Depends on nothing else,
+    // so a floor's results can be regenerated independently of other floors.
+    static uint32_t StreamSeed(uint32_t seed, int32_t floor, RngSource source);
+    // Restarts each stream from its StreamSeed the next time it's used.
+    void ResetStreams();
+    // Restarts a single source's stream (e.g. to regenerate its results).
+    void RestartStream(RngSource source);
     
     // Changes the selected menu option; `change` controls how to change it,
     // -1 / +1 for decreasing / increasing, 0 for toggling or advancing.
     // Will also make any other changes necessary for the option to function
     // (e.g. changing Mario's level and BP for No-EXP mode).
     void ChangeOption(int32_t option, int32_t change);
+    // Rebuilds options_snapshot_; must be called after changing options_ or
+    // the multipliers other than through ChangeOption or Load.
+    void UpdateOptionsSnapshot();
     // Returns the appropriate value for the specified option
     // (e.g. 0 or 1 for boolean options, or the percent for HP/ATK modifiers).
     int32_t GetOptionValue(int32_t option) const;
@@ -104,8 +192,15 @@ struct RandomizerState {
     bool StarPowerEnabled() const;
     
     // Get or update various stats tracked over the course of a file.
+    // Increments are batched until the next FlushPlayStats call, but are
+    // included in the values returned by GetPlayStat in the meantime.
     void IncrementPlayStat(PlayStats stat, int32_t amount = 1);
     int32_t GetPlayStat(PlayStats stat) const;
+    // Writes any batched play stat increments to play_stats_; should be called
+    // at the end of each battle, and is called automatically by Save().
+    void FlushPlayStats();
+    // Discards any batched play stat increments (e.g. when reloading state).
+    void ClearPendingPlayStats();
     // Returns a base-64-esque encoding of this file's user-selectable options.
     const char* GetEncodedOptions() const;
     // Gets a string containing the player's play stats on this save file.
@@ -117,8 +212,22 @@ struct RandomizerState {
     // Get the current RTA play time as a string.
     // Will return empty string if the start time was unset or incompatible.
     const char* GetCurrentTimeString();
-} __attribute__((__packed__));
+    // Records the RTA / in-battle time taken for the set of 10 floors that
+    // was just completed; should be called when floor_ reaches a multiple of 10.
+    void RecordFloorSplit();
+    // Get the most recent split, compared to the previous one, as a string.
+    // The string is cached, and only rebuilt when a new split is recorded.
+    const char* GetLastSplitString();
+};
 
-static_assert(sizeof(RandomizerState) <= 0x3c);
+// The saved fields are laid out to be naturally aligned, so the struct isn't
+// packed; the layout must still match older versions' saves byte for byte.
+static_assert(offsetof(RandomizerState, rng_state_) == 0x08);
+static_assert(offsetof(RandomizerState, split_log_first_set_) == 0x1a);
+static_assert(offsetof(RandomizerState, rng_generation_) == 0x1d);
+static_assert(offsetof(RandomizerState, hp_multiplier_) == 0x20);
+static_assert(offsetof(RandomizerState, options_) == 0x24);
+static_assert(offsetof(RandomizerState, play_stats_) == 0x28);
+static_assert(offsetof(RandomizerState, options_snapshot_) <= 0x3c);
 
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Trace of the randomizer's RNG calls (call site, range and result), kept in
+// a ring buffer for the host tool (rngtrace.py) to read from a RAM dump. Only
+// compiled into builds made with `make RNG_TRACE=1` (defining PIT_RNG_TRACE);
+// otherwise all calls are no-ops.
+namespace mod::rng_trace {
+
+#ifdef PIT_RNG_TRACE
+
+// Discards all previously recorded calls.
+void Reset();
+// Records a call to the randomizer's RNG.
+void Record(
+    uint32_t source, int32_t floor, uint32_t range, uint32_t result,
+    uint32_t rng_state);
+
+#else
+
+inline void Reset() {}
+inline void Record(
+    uint32_t source, int32_t floor, uint32_t range, uint32_t result,
+    uint32_t rng_state) {}
+
+#endif
+
+}
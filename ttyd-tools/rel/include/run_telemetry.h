@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-floor run telemetry (enemies, battle turns and time, map load time,
+// damage, items, coins and peak heap use), kept in a fixed-size ring of
+// compact binary records, for the host tool (telemetry.py) to decode from a
+// RAM dump (or the copy written to the memory card) into CSV.
+namespace mod::run_telemetry {
+
+// Fills in the ring's header and subscribes to map loads.
+void Init();
+// Starts a new run (new file) or continues one (loading a save file),
+// discarding any records made since the last save prompt. The first call
+// also queues a read of the records written to the card in earlier sessions,
+// which the new ones are appended to.
+void OnFileLoad(bool new_file);
+// Called on each step of loading a map; the time from the first step until
+// the one that finishes loading is counted as the floor's load time.
+void OnMapLoadStep(bool done);
+// Records the enemies selected for the current floor (spawn indices).
+void RecordEnemies(const int32_t* enemies, int32_t count);
+// Writes the record for the floor just cleared (0-indexed, like floor_), and
+// starts tracking the next one.
+void EndFloor(int32_t floor);
+// Marks the records written so far as saved, and queues a write of them to
+// the memory card (finished from the main loop); called at the save prompts.
+void Flush();
+
+}
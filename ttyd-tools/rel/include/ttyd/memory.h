@@ -6,6 +6,17 @@ namespace ttyd::memory {
 
 extern "C" {
 
+// Header of each block in a map heap; the heap pointer _mapAlloc takes points
+// at the first, and used and free blocks form a single address-ordered list.
+struct MapAllocEntry {
+    MapAllocEntry*  next;
+    uint32_t        size;       // Bytes following this header.
+    uint16_t        in_use;
+    uint8_t         unk_0a[0x16];
+} __attribute__((__packed__));
+
+static_assert(sizeof(MapAllocEntry) == 0x20);
+
 // memInit
 // memClear
 void *__memAlloc(uint32_t heap, uint32_t size);
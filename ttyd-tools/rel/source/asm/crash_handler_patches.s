@@ -1,8 +1,77 @@
 .global StartCrashHandlerScale
 .global BranchBackCrashHandlerScale
+.global StartCrashHandlerLoop
+.global BranchBackCrashHandlerLoop
 
 StartCrashHandlerScale:
 bl scaleCrashHandlerText
 
 BranchBackCrashHandlerScale:
-b 0
\ No newline at end of file
+b 0
+
+StartCrashHandlerLoop:
+# Save volatile registers (including CTR, XER and the FPRs / FPSCR), since
+# the handler's loop may still be using them.
+stwu %r1, -0x110(%r1)
+stw %r0, 0x8(%r1)
+stmw %r3, 0xc(%r1)
+mfcr %r0
+stw %r0, 0x80(%r1)
+mfctr %r0
+stw %r0, 0x84(%r1)
+mfxer %r0
+stw %r0, 0x88(%r1)
+mflr %r0
+stw %r0, 0x114(%r1)
+stfd %f0, 0x90(%r1)
+stfd %f1, 0x98(%r1)
+stfd %f2, 0xa0(%r1)
+stfd %f3, 0xa8(%r1)
+stfd %f4, 0xb0(%r1)
+stfd %f5, 0xb8(%r1)
+stfd %f6, 0xc0(%r1)
+stfd %f7, 0xc8(%r1)
+stfd %f8, 0xd0(%r1)
+stfd %f9, 0xd8(%r1)
+stfd %f10, 0xe0(%r1)
+stfd %f11, 0xe8(%r1)
+stfd %f12, 0xf0(%r1)
+stfd %f13, 0xf8(%r1)
+mffs %f0
+stfd %f0, 0x100(%r1)
+
+# Call C function to freeze the flight recorder with the crashed context.
+bl onCrashHandlerLoop
+
+lfd %f0, 0x100(%r1)
+mtfsf 0xff, %f0
+lfd %f0, 0x90(%r1)
+lfd %f1, 0x98(%r1)
+lfd %f2, 0xa0(%r1)
+lfd %f3, 0xa8(%r1)
+lfd %f4, 0xb0(%r1)
+lfd %f5, 0xb8(%r1)
+lfd %f6, 0xc0(%r1)
+lfd %f7, 0xc8(%r1)
+lfd %f8, 0xd0(%r1)
+lfd %f9, 0xd8(%r1)
+lfd %f10, 0xe0(%r1)
+lfd %f11, 0xe8(%r1)
+lfd %f12, 0xf0(%r1)
+lfd %f13, 0xf8(%r1)
+lwz %r0, 0x114(%r1)
+mtlr %r0
+lwz %r0, 0x88(%r1)
+mtxer %r0
+lwz %r0, 0x84(%r1)
+mtctr %r0
+lwz %r0, 0x80(%r1)
+mtcr %r0
+lmw %r3, 0xc(%r1)
+lwz %r0, 0x8(%r1)
+addi %r1, %r1, 0x110
+# Replace original opcode (restarts the loop over the crash text).
+li %r26, 0
+
+BranchBackCrashHandlerLoop:
+b 0
@@ -0,0 +1,196 @@
+#include "card_file.h"
+
+#include <gc/card.h>
+#include <gc/OSTime.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::card_file {
+
+namespace {
+
+using ::gc::card::CARDFileInfo;
+namespace CardResult = ::gc::card::CardResult;
+
+// Memory card slot A.
+constexpr const int32_t kChannel = 0;
+// Files are written a sector at a time (the only size the card accepts).
+constexpr const uint32_t kSectorSize = 0x2000;
+// Size of the work area the card is mounted with (CARD_WORKAREA_SIZE).
+constexpr const uint32_t kWorkAreaSize = 0xa000;
+// How long to wait for a card operation before giving up (in OSTime ticks;
+// 5 seconds), e.g. if the card is pulled mid-write.
+constexpr const uint64_t kTimeoutTicks = 40'500'000ULL * 5;
+// How many frames in a row the card has to be idle before a request starts,
+// so requests don't land between the steps of one of the game's own card
+// operations (e.g. mounting, then saving).
+constexpr const int32_t kIdleFramesToStart = 60;
+constexpr const int32_t kMaxRequests = 8;
+
+namespace Step {
+    enum e {
+        kIdle = 0,
+        kMounting,
+        kCreating,
+        kTransferring,
+    };
+}
+
+// The mod's own work area, so it never borrows the game's card manager's
+// (zero-initialized, rather than in .data, to keep it out of the REL file).
+alignas(32) uint8_t g_WorkArea[kWorkAreaSize];
+// Staging buffer for each sector read / written (the card DMAs to / from it,
+// so it must be 32-byte aligned, and a whole sector long).
+alignas(32) uint8_t g_SectorBuffer[kSectorSize];
+
+// Requests in the order submitted; the first is the one in progress.
+Request* g_Requests[kMaxRequests] = { nullptr };
+int32_t g_NumRequests = 0;
+Step::e g_Step = Step::kIdle;
+CARDFileInfo g_FileInfo;
+// Bytes of the request in progress done so far.
+uint32_t g_Done = 0;
+uint64_t g_StepStartTime = 0;
+int32_t g_IdleFrames = 0;
+
+uint32_t RoundUpToSector(uint32_t size) {
+    return (size + kSectorSize - 1) & ~(kSectorSize - 1);
+}
+
+uint32_t GetSectorLength(const Request* request) {
+    const uint32_t left = request->size - g_Done;
+    return left < kSectorSize ? left : kSectorSize;
+}
+
+// Ends the request in progress (closing the file / unmounting the card, if
+// it got that far), and calls back its owner.
+void Finish(bool success) {
+    if (g_Step == Step::kTransferring) gc::card::CARDClose(&g_FileInfo);
+    if (g_Step != Step::kIdle) gc::card::CARDUnmount(kChannel);
+    g_Step = Step::kIdle;
+    Request* request = g_Requests[0];
+    --g_NumRequests;
+    for (int32_t i = 0; i < g_NumRequests; ++i) {
+        g_Requests[i] = g_Requests[i + 1];
+    }
+    request->pending = false;
+    if (request->on_done) request->on_done(request, success);
+}
+
+// Starts the next async operation in `step`, given the result of the call
+// that issued it; false if the call failed.
+bool BeginStep(Step::e step, int32_t result) {
+    if (result != CardResult::kReady) return false;
+    g_Step = step;
+    g_StepStartTime = gc::OSTime::OSGetTime();
+    return true;
+}
+
+// Issues the transfer of the next sector of the request in progress.
+bool StartTransfer(Request* request) {
+    const uint32_t length = GetSectorLength(request);
+    if (request->write) {
+        memcpy(
+            g_SectorBuffer,
+            reinterpret_cast<const uint8_t*>(request->data) + g_Done, length);
+        memset(g_SectorBuffer + length, 0, kSectorSize - length);
+        return BeginStep(Step::kTransferring, gc::card::CARDWriteAsync(
+            &g_FileInfo, g_SectorBuffer, kSectorSize,
+            request->offset + g_Done, nullptr));
+    }
+    return BeginStep(Step::kTransferring, gc::card::CARDReadAsync(
+        &g_FileInfo, g_SectorBuffer, kSectorSize, request->offset + g_Done,
+        nullptr));
+}
+
+// Opens the request's file once the card is mounted, creating it if need be.
+bool OpenFile(Request* request) {
+    const int32_t result =
+        gc::card::CARDOpen(kChannel, request->name, &g_FileInfo);
+    if (result == CardResult::kNoFile && request->write) {
+        uint32_t file_size = request->offset + request->size;
+        if (file_size < request->file_size) file_size = request->file_size;
+        return BeginStep(Step::kCreating, gc::card::CARDCreateAsync(
+            kChannel, request->name, RoundUpToSector(file_size), &g_FileInfo,
+            nullptr));
+    }
+    if (result != CardResult::kReady) return false;
+    g_Step = Step::kTransferring;
+    return StartTransfer(request);
+}
+
+// Called when the async operation in progress has finished with `result`;
+// returns false if the request failed.
+bool Advance(Request* request, int32_t result) {
+    if (result != CardResult::kReady) return false;
+    switch (g_Step) {
+        case Step::kMounting:
+            return OpenFile(request);
+        case Step::kCreating:
+            g_Step = Step::kTransferring;
+            return StartTransfer(request);
+        case Step::kTransferring: {
+            const uint32_t length = GetSectorLength(request);
+            if (!request->write) {
+                memcpy(
+                    reinterpret_cast<uint8_t*>(request->data) + g_Done,
+                    g_SectorBuffer, length);
+            }
+            g_Done += length;
+            if (g_Done >= request->size) {
+                Finish(/* success = */ true);
+                return true;
+            }
+            return StartTransfer(request);
+        }
+        default:
+            return false;
+    }
+}
+
+// Probes the card and starts mounting it for the next request.
+bool Start() {
+    int32_t sector_size = 0;
+    if (gc::card::CARDProbeEx(kChannel, nullptr, &sector_size) !=
+            CardResult::kReady ||
+        static_cast<uint32_t>(sector_size) != kSectorSize) {
+        return false;
+    }
+    g_Done = 0;
+    return BeginStep(Step::kMounting, gc::card::CARDMountAsync(
+        kChannel, g_WorkArea, nullptr, nullptr));
+}
+
+}
+
+bool Submit(Request* request) {
+    if (request->pending || g_NumRequests == kMaxRequests) return false;
+    request->pending = true;
+    g_Requests[g_NumRequests++] = request;
+    return true;
+}
+
+void Update() {
+    const int32_t result = gc::card::CARDGetResultCode(kChannel);
+    if (g_Step == Step::kIdle) {
+        // Wait for the card to be left alone (by the game) for a while.
+        if (result == CardResult::kBusy) {
+            g_IdleFrames = 0;
+        } else if (g_IdleFrames < kIdleFramesToStart) {
+            ++g_IdleFrames;
+        }
+        if (!g_NumRequests || g_IdleFrames < kIdleFramesToStart) return;
+        if (!Start()) Finish(/* success = */ false);
+        return;
+    }
+    if (result == CardResult::kBusy) {
+        if (gc::OSTime::OSGetTime() - g_StepStartTime > kTimeoutTicks) {
+            Finish(/* success = */ false);
+        }
+        return;
+    }
+    if (!Advance(g_Requests[0], result)) Finish(/* success = */ false);
+}
+
+}
@@ -1,6 +1,7 @@
 #include "common_functions.h"
 
 #include "evt_cmd.h"
+#include "map_events.h"
 
 #include <ttyd/mariost.h>
 #include <ttyd/seqdrv.h>
@@ -14,7 +15,8 @@
 
 namespace mod {
 
-// TODO: #ifdef switch for multiple regions.
+// TODO: #ifdef switch for multiple regions; ../regionscan/regionscan.py can
+// derive the other regions' offsets from these.
 const uint32_t kTik06PitBeroEntryOffset = 0x1f240;
 const uint32_t kTik06RightBeroEntryOffset = 0x1f2f4;
 const uint32_t kPitBattleSetupTblOffset = 0x1d460;
@@ -40,6 +42,9 @@ const uint32_t kPitSetupNpcExtraParametersFuncOffset = 0x388;
 const uint32_t kPitSetKillFlagFuncOffset = 0x3e8;
 
 
+// Reads the game's state directly; not available in host builds.
+#ifndef PIT_HOST
+
 bool CheckSeq(ttyd::seqdrv::SeqIndex sequence) {
     const ttyd::seqdrv::SeqIndex next_seq = ttyd::seqdrv::seqGetNextSeq();
     const ttyd::seqdrv::SeqIndex cur_seq = ttyd::seqdrv::seqGetSeq();
@@ -51,8 +56,9 @@ bool InMainGameModes() {
     int32_t game = static_cast<int32_t>(ttyd::seqdrv::SeqIndex::kGame);
     int32_t game_over = static_cast<int32_t>(ttyd::seqdrv::SeqIndex::kGameOver);
 
-    bool next_map_demo = !strcmp(ttyd::seq_mapchange::NextMap, "dmo_00");
-    bool next_map_title = !strcmp(ttyd::seq_mapchange::NextMap, "title");
+    const map_events::MapId next_map = map_events::GetNextMapId();
+    bool next_map_demo = next_map == map_events::kDmo00;
+    bool next_map_title = next_map == map_events::kTitleMap;
     
     return (sequence >= game) && (sequence <= game_over) && 
            !next_map_demo && !next_map_title;
@@ -70,6 +76,8 @@ const char* GetNextMap() {
     return ttyd::seq_mapchange::NextMap;
 }
 
+#endif
+
 const char* ModuleNameFromId(ModuleId::e module_id) {
     static const char* kModuleNames[] = {
         nullptr, "aaa", "aji", "bom", "dmo", "dou", "eki", "end",
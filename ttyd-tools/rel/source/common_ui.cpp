@@ -13,6 +13,240 @@ namespace {
 
 using ::ttyd::dispdrv::CameraId;
 
+// Maximum number of strings whose layout can be cached at once.
+constexpr const int32_t kNumTextLayouts = 32;
+// Maximum number of lines in a cached string.
+constexpr const int32_t kMaxLayoutLines = 16;
+// Size of the shared buffer holding cached strings' text.
+constexpr const int32_t kTextArenaSize = 4096;
+// Maximum number of overlays that can be registered with the compositor.
+constexpr const int32_t kMaxOverlays = 16;
+// Height of a line of text at scale 1, and of the space between lines.
+constexpr const float kLineHeight = 25.f;
+constexpr const float kLineSpacing = 9.f;
+
+// Cached measurements of a string, so unchanged text drawn every frame
+// doesn't need to be re-measured or split into lines every frame.
+struct TextLayout {
+    // The string pointer and contents' hash the layout was computed for.
+    const char* text;
+    uint32_t    hash;
+    uint32_t    last_used;
+    // Copy of the text in g_TextArena, with each line null-terminated.
+    char*       lines;
+    uint16_t    capacity;
+    uint16_t    num_lines;
+    // Unscaled width of the widest line, and of each line.
+    uint16_t    width;
+    uint16_t    line_widths[kMaxLayoutLines];
+};
+
+// Font state last set while drawing a batch of overlays, so consecutive
+// strings drawn with the same settings don't need to set it again.
+struct FontState {
+    bool        valid;
+    bool        edge;
+    uint8_t     alpha;
+    uint32_t    color;
+    float       scale;
+};
+
+// Registered overlays, sorted by camera layer, then order.
+const Overlay* g_Overlays[kMaxOverlays];
+bool g_OverlayVisible[kMaxOverlays];
+int32_t g_NumOverlays = 0;
+bool g_InOverlayBatch = false;
+FontState g_FontState;
+
+TextLayout g_TextLayouts[kNumTextLayouts];
+char g_TextArena[kTextArenaSize];
+int32_t g_TextArenaUsed = 0;
+uint32_t g_TextLayoutClock = 0;
+
+// Returns the FNV-1a hash of a string, as well as its size (including the
+// null terminator) and number of lines.
+uint32_t HashText(const char* text, int32_t* out_size, int32_t* out_lines) {
+    uint32_t hash = 2166136261U;
+    int32_t num_lines = 1;
+    const char* ch = text;
+    for (; *ch; ++ch) {
+        hash = (hash ^ static_cast<uint8_t>(*ch)) * 16777619U;
+        if (*ch == '\n') ++num_lines;
+    }
+    *out_size = ch - text + 1;
+    *out_lines = num_lines;
+    return hash;
+}
+
+// Returns the cached layout for the given text, computing it if necessary.
+// Returns nullptr if the text is too large to be cached.
+const TextLayout* GetTextLayout(const char* text) {
+    int32_t size, num_lines;
+    const uint32_t hash = HashText(text, &size, &num_lines);
+    ++g_TextLayoutClock;
+    
+    TextLayout* layout = g_TextLayouts;
+    for (int32_t i = 0; i < kNumTextLayouts; ++i) {
+        TextLayout* entry = g_TextLayouts + i;
+        if (entry->text == text && entry->hash == hash && entry->lines) {
+            entry->last_used = g_TextLayoutClock;
+            return entry;
+        }
+        // Otherwise, replace the least recently used entry.
+        if (entry->last_used < layout->last_used) layout = entry;
+    }
+    if (size > kTextArenaSize || num_lines > kMaxLayoutLines) return nullptr;
+    
+    // Reuse the entry's space in the arena if it's large enough; otherwise,
+    // allocate more, clearing the whole cache if the arena is full.
+    if (!layout->lines || layout->capacity < size) {
+        if (g_TextArenaUsed + size > kTextArenaSize) {
+            memset(g_TextLayouts, 0, sizeof(g_TextLayouts));
+            g_TextArenaUsed = 0;
+        }
+        layout->lines = g_TextArena + g_TextArenaUsed;
+        layout->capacity = size;
+        g_TextArenaUsed += size;
+    }
+    
+    // Split the text into null-terminated lines, measuring each one.
+    char* lines = layout->lines;
+    memcpy(lines, text, size);
+    uint16_t width = 0;
+    char* line = lines;
+    for (int32_t i = 0; i < num_lines; ++i) {
+        char* end = strchr(line, '\n');
+        if (end) *end = '\0';
+        uint16_t unused;
+        const uint16_t line_width =
+            ttyd::fontmgr::FontGetMessageWidthLine(line, &unused);
+        layout->line_widths[i] = line_width;
+        if (line_width > width) width = line_width;
+        line += strlen(line) + 1;
+    }
+    layout->text = text;
+    layout->hash = hash;
+    layout->last_used = g_TextLayoutClock;
+    layout->num_lines = num_lines;
+    layout->width = width;
+    return layout;
+}
+
+void SetTextDrawState(uint8_t alpha, bool edge, uint32_t color, float scale) {
+    // Outside of an overlay batch, other code may have changed the state.
+    FontState& state = g_FontState;
+    const bool restart =
+        !g_InOverlayBatch || !state.valid || state.alpha != alpha;
+    if (restart) ttyd::fontmgr::FontDrawStart_alpha(alpha);
+    if (restart || state.color != color) {
+        ttyd::fontmgr::FontDrawColor(reinterpret_cast<uint8_t *>(&color));
+    }
+    if (restart || state.edge != edge) {
+        if (edge) {
+            ttyd::fontmgr::FontDrawEdge();
+        } else {
+            ttyd::fontmgr::FontDrawEdgeOff();
+        }
+    }
+    if (restart || state.scale != scale) {
+        ttyd::fontmgr::FontDrawScale(scale);
+    }
+    state.valid = g_InOverlayBatch;
+    state.alpha = alpha;
+    state.color = color;
+    state.edge = edge;
+    state.scale = scale;
+}
+
+void DrawOverlayLayer(CameraId camera_layer, void* user) {
+    g_InOverlayBatch = true;
+    g_FontState.valid = false;
+    for (int32_t i = 0; i < g_NumOverlays; ++i) {
+        if (g_Overlays[i]->camera_layer == camera_layer && g_OverlayVisible[i]) {
+            g_Overlays[i]->draw();
+        }
+    }
+    g_InOverlayBatch = false;
+}
+
+void DrawTextLayout(
+    const TextLayout& layout, float x, float y, float scale,
+    int32_t alignment) {
+    const float height = (kLineHeight * layout.num_lines - kLineSpacing) * scale;
+    // Set initial height of text based on top, middle, or bottom v-alignment.
+    y += height * (alignment / 3) / 2;
+    // Nudge up slightly so capital letters look ~exactly centered.
+    y += 4.f * scale;
+    
+    const char* line = layout.lines;
+    for (int32_t i = 0; i < layout.num_lines; ++i) {
+        // Set individual lines' x-position based on h-alignment.
+        const float width = layout.line_widths[i] * scale;
+        ttyd::fontmgr::FontDrawString(
+            x - width * (alignment % 3) / 2, y, line);
+        // Advance to the next line.
+        line += strlen(line) + 1;
+        y -= kLineHeight * scale;
+    }
+}
+
+// Returns whether the byte starts a two-byte Shift-JIS character.
+bool IsSjisLeadByte(uint8_t c) {
+    return (c >= 0x81 && c <= 0x9f) || (c >= 0xe0 && c <= 0xfc);
+}
+
+// Returns the length of the longest prefix of the first `length` bytes of
+// `text` that's at most `max_length` bytes and doesn't split a character.
+int32_t GetPieceLength(const char* text, int32_t length, int32_t max_length) {
+    int32_t piece_length = 0;
+    while (piece_length < length) {
+        const int32_t char_length =
+            IsSjisLeadByte(text[piece_length]) &&
+            piece_length + 1 < length ? 2 : 1;
+        if (piece_length + char_length > max_length) break;
+        piece_length += char_length;
+    }
+    return piece_length;
+}
+
+// Draws text too large to be cached, a line (or part of one) at a time.
+void DrawTextUncached(
+    const char* text, float x, float y, float scale, int32_t alignment) {
+    float width, height;
+    GetTextDimensions(text, scale, &width, &height);
+    // Set initial height of text based on top, middle, or bottom v-alignment.
+    y += height * (alignment / 3) / 2;
+    // Nudge up slightly so capital letters look ~exactly centered.
+    y += 4.f * scale;
+    
+    char buf[128];
+    uint16_t unused;
+    for (const char* line = text; line; y -= kLineHeight * scale) {
+        const char* end = strchr(line, '\n');
+        const int32_t line_length = end ? end - line : strlen(line);
+        // Measure the line in buffer-sized pieces (split between characters),
+        // then draw the pieces one after another.
+        float line_width = 0.f;
+        for (int32_t i = 0, length = 0; i < line_length; i += length) {
+            length = GetPieceLength(line + i, line_length - i, sizeof(buf) - 1);
+            memcpy(buf, line + i, length);
+            buf[length] = '\0';
+            line_width += 
+                ttyd::fontmgr::FontGetMessageWidthLine(buf, &unused) * scale;
+        }
+        float piece_x = x - line_width * (alignment % 3) / 2;
+        for (int32_t i = 0, length = 0; i < line_length; i += length) {
+            length = GetPieceLength(line + i, line_length - i, sizeof(buf) - 1);
+            memcpy(buf, line + i, length);
+            buf[length] = '\0';
+            ttyd::fontmgr::FontDrawString(piece_x, y, buf);
+            piece_x += 
+                ttyd::fontmgr::FontGetMessageWidthLine(buf, &unused) * scale;
+        }
+        line = end ? end + 1 : nullptr;
+    }
+}
+
 }
 
 void RegisterDrawCallback(void (*func)(), CameraId camera_layer, float order) {
@@ -23,64 +257,73 @@ void RegisterDrawCallback(void (*func)(), CameraId camera_layer, float order) {
         }, reinterpret_cast<void*>(func));
 }
     
+void RegisterOverlay(const Overlay* overlay) {
+    if (g_NumOverlays >= kMaxOverlays) return;
+    // Insert after any overlays on earlier layers or with lower / equal order.
+    int32_t pos = g_NumOverlays;
+    for (; pos > 0; --pos) {
+        const Overlay* prev = g_Overlays[pos - 1];
+        if (prev->camera_layer < overlay->camera_layer ||
+            (prev->camera_layer == overlay->camera_layer &&
+             prev->order <= overlay->order)) {
+            break;
+        }
+        g_Overlays[pos] = prev;
+    }
+    g_Overlays[pos] = overlay;
+    ++g_NumOverlays;
+}
+
+void DrawOverlays() {
+    // Check each overlay's visibility once per frame, and register a single
+    // display callback for each camera layer with anything to draw.
+    for (int32_t i = 0; i < g_NumOverlays; ++i) {
+        const Overlay* overlay = g_Overlays[i];
+        g_OverlayVisible[i] = !overlay->visible || overlay->visible();
+    }
+    for (int32_t i = 0; i < g_NumOverlays; ++i) {
+        if (!g_OverlayVisible[i]) continue;
+        const CameraId camera_layer = g_Overlays[i]->camera_layer;
+        ttyd::dispdrv::dispEntry(
+            camera_layer, /* render_mode = */ 2, /* order = */ 0.f,
+            DrawOverlayLayer, nullptr);
+        // Skip the rest of the overlays on this layer.
+        while (i + 1 < g_NumOverlays && 
+               g_Overlays[i + 1]->camera_layer == camera_layer) {
+            ++i;
+        }
+    }
+}
+    
 void GetTextDimensions(
     const char* text, float scale, float* out_width, float* out_height) {
+    const TextLayout* layout = GetTextLayout(text);
+    if (layout) {
+        *out_width = layout->width * scale;
+        *out_height = (kLineHeight * layout->num_lines - kLineSpacing) * scale;
+        return;
+    }
+    
     uint16_t num_lines;
     uint16_t length = ttyd::fontmgr::FontGetMessageWidthLine(text, &num_lines);
     ++num_lines;
     
     *out_width = (length + 0) * scale;
-    *out_height = (25 * num_lines - 9) * scale;
+    *out_height = (kLineHeight * num_lines - kLineSpacing) * scale;
 }
     
 void DrawText(
     const char* text, float x, float y, uint8_t alpha, bool edge, 
     uint32_t color, float scale, int32_t alignment) {
-    ttyd::fontmgr::FontDrawStart_alpha(alpha);
-    ttyd::fontmgr::FontDrawColor(reinterpret_cast<uint8_t *>(&color));
-    if (edge) {
-        ttyd::fontmgr::FontDrawEdge();
-    } else {
-        ttyd::fontmgr::FontDrawEdgeOff();
-    }
-    ttyd::fontmgr::FontDrawScale(scale);
-    
+    SetTextDrawState(alpha, edge, color, scale);
     if (alignment < 0 || alignment >= 9) alignment = 0;
     
-    float width, height;
-    GetTextDimensions(text, scale, &width, &height);
-    // Set initial height of text based on top, middle, or bottom v-alignment.
-    y += height * (alignment / 3) / 2;
-    // Nudge up slightly so capital letters look ~exactly centered.
-    y += 4.f * scale;
-    
-    char buf[100];
-    int32_t line_start = 0;
-    float line_x = 0;
-    (void)buf;
-    
-    // Print the text a line at a time, if applicable.
-    for (int32_t i = 0; text[i]; ++i) {
-        if (text[i] == '\n') {
-            // Copy this line to the temporary buffer and append a null byte.
-            int32_t line_length = i - line_start < 99 ? i - line_start : 99;
-            strncpy(buf, text + line_start, line_length);
-            buf[line_length] = '\0';
-            
-            // Set individual lines' x-position based on h-alignment.
-            GetTextDimensions(buf, scale, &width, &height);
-            line_x = x - width * (alignment % 3) / 2;
-            ttyd::fontmgr::FontDrawString(line_x, y, buf);
-            
-            // Advance to the next line.
-            line_start = i + 1;
-            y -= 25.f * scale;
-        }
+    const TextLayout* layout = GetTextLayout(text);
+    if (layout) {
+        DrawTextLayout(*layout, x, y, scale, alignment);
+    } else {
+        DrawTextUncached(text, x, y, scale, alignment);
     }
-    // Print the remainder of the string.
-    GetTextDimensions(text + line_start, scale, &width, &height);
-    line_x = x - width * (alignment % 3) / 2;
-    ttyd::fontmgr::FontDrawString(line_x, y, text + line_start);
 }
     
 void DrawWindow(
@@ -89,20 +332,36 @@ void DrawWindow(
     uint8_t *color_u8ptr   = reinterpret_cast<uint8_t *>(&color);
     ttyd::windowdrv::windowDispGX_Waku_col(
         0, color_u8ptr, x, y, width, height, corner_radius);
+    // Drawing the window changes the GX state, so text needs to be restarted.
+    g_FontState.valid = false;
 }
     
 void DrawCenteredTextWindow(
     const char* text, float x, float y, uint8_t text_alpha, bool text_edge,
     uint32_t text_color, float text_scale, uint32_t window_color, 
     float window_pad, float window_corner_radius) {
-    float width, height;
-    GetTextDimensions(text, text_scale, &width, &height);
+    const TextLayout* layout = GetTextLayout(text);
+    if (!layout) {
+        float width, height;
+        GetTextDimensions(text, text_scale, &width, &height);
+        DrawWindow(window_color,
+                   x - width / 2 - window_pad, y + height / 2 + window_pad,
+                   width + 2 * window_pad, height + 2 * window_pad,
+                   window_corner_radius);
+        DrawText(text, x, y, text_alpha, text_edge, text_color, text_scale, 4);
+        return;
+    }
     
+    // Measure the text once for both the window and the text itself.
+    const float width = layout->width * text_scale;
+    const float height = 
+        (kLineHeight * layout->num_lines - kLineSpacing) * text_scale;
     DrawWindow(window_color,
                x - width / 2 - window_pad, y + height / 2 + window_pad,
                width + 2 * window_pad, height + 2 * window_pad,
                window_corner_radius);
-    DrawText(text, x, y, text_alpha, text_edge, text_color, text_scale, 4);
+    SetTextDrawState(text_alpha, text_edge, text_color, text_scale);
+    DrawTextLayout(*layout, x, y, text_scale, /* center */ 4);
 }
 
 }
\ No newline at end of file
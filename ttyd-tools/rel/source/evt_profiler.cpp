@@ -0,0 +1,327 @@
+#include "evt_profiler.h"
+
+#ifdef PIT_PROFILING
+
+#include "common_ui.h"
+#include "patch.h"
+
+#include <gc/OSLink.h>
+#include <gc/OSTime.h>
+#include <ttyd/dispdrv.h>
+#include <ttyd/evtmgr.h>
+#include <ttyd/evtmgr_cmd.h>
+#include <ttyd/mariost.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace mod::evt_profiler {
+
+namespace {
+
+using ::gc::OSLink::OSModuleInfo;
+using ::ttyd::dispdrv::CameraId;
+using ::ttyd::evtmgr::EvtEntry;
+
+// Number of frames to accumulate results over before publishing them.
+constexpr const int32_t kWindowFrames = 60;
+// Maximum number of distinct scripts tracked per window (power of 2).
+constexpr const int32_t kMaxScripts = 128;
+// Number of scripts published to the dump buffer / drawn on screen.
+constexpr const int32_t kMaxDumpScripts = 32;
+constexpr const int32_t kMaxDrawnScripts = 10;
+constexpr const int32_t kMaxNames = 48;
+// Evt opcodes are in the range [0x00, 0x76]; USER_FUNC is 0x5b.
+constexpr const int32_t kNumOpcodes = 0x77;
+constexpr const uint32_t kUserFuncOpcode = 0x5b;
+// Opcodes that end a script (RETURN, END_SCRIPT).
+constexpr const uint32_t kReturnOpcode = 0x02;
+constexpr const uint32_t kEndScriptOpcode = 0x01;
+// EvtEntry flags bit set while the entry is in use.
+constexpr const uint8_t kEvtEntryInUse = 0x01;
+// Longest straight-line run of instructions walked after a single dispatch.
+constexpr const int32_t kMaxWalkWords = 0x800;
+
+struct ScriptProfile {
+    uint32_t evt_code;          // Script's starting address.
+    uint32_t name;              // Address of registered name string, or 0.
+    uint32_t dispatches;        // Times the interpreter ran the script.
+    uint32_t instructions;
+    uint32_t user_funcs;
+    uint32_t ticks;             // Total OSTime ticks spent in the script.
+    uint32_t max_ticks;         // Longest single dispatch.
+};
+
+// Published results, laid out for the host tool (evtprof.py) to find in a
+// RAM dump; keep the two in sync if changing the layout.
+struct ProfileDump {
+    uint32_t magic;             // 'EVTP'
+    uint32_t version;
+    uint32_t window_frames;
+    uint32_t windows_published;
+    uint32_t num_scripts;
+    uint32_t untracked_ticks;   // Time in scripts that didn't fit the table.
+    uint32_t total_ticks;
+    uint32_t rel_file_base;     // Loaded modules, for symbolizing addresses.
+    uint32_t rel_file_id;
+    uint32_t map_alloc_base;
+    uint32_t map_alloc_id;
+    uint32_t opcode_counts[kNumOpcodes];
+    ScriptProfile scripts[kMaxDumpScripts];
+};
+
+struct ScriptName {
+    const void* evt_code;
+    const char* name;
+};
+
+// Trampoline for the interpreter's per-script dispatch function.
+int32_t (*g_evtmgrCmd_trampoline)(EvtEntry*) = nullptr;
+
+ScriptProfile g_Window[kMaxScripts];
+uint32_t g_WindowOpcodes[kNumOpcodes];
+uint32_t g_WindowUntrackedTicks = 0;
+int32_t g_WindowFrame = 0;
+
+ScriptName g_Names[kMaxNames];
+int32_t g_NumNames = 0;
+
+ProfileDump g_EvtProfileDump = { 0x45565450, 1, kWindowFrames };
+
+bool g_DisplayEnabled = false;
+
+// Finds the interpreter's per-script dispatch function (evtmgrCmd), which is
+// not in the symbol map, as the only call evtmgrMain makes into evtmgr_cmd.o.
+void* FindDispatchFunction() {
+    const uint32_t* start =
+        reinterpret_cast<const uint32_t*>(ttyd::evtmgr::evtmgrMain);
+    const uint32_t* end =
+        reinterpret_cast<const uint32_t*>(ttyd::evtmgr::evtRestart);
+    const uint32_t lower =
+        reinterpret_cast<uint32_t>(ttyd::evtmgr_cmd::evtGetValue);
+    const uint32_t upper =
+        reinterpret_cast<uint32_t>(ttyd::evtmgr::evtGetPtrID);
+    for (const uint32_t* ins = start; ins < end; ++ins) {
+        // Only consider relative `bl` instructions.
+        if ((*ins & 0xfc000003) != 0x48000001) continue;
+        int32_t offset = *ins & 0x03fffffc;
+        if (offset & 0x02000000) offset -= 0x04000000;
+        const uint32_t target = reinterpret_cast<uint32_t>(ins) + offset;
+        if (target > lower && target < upper) {
+            return reinterpret_cast<void*>(target);
+        }
+    }
+    return nullptr;
+}
+
+ScriptProfile* LookupScript(uint32_t evt_code) {
+    uint32_t slot = (evt_code >> 2) & (kMaxScripts - 1);
+    for (int32_t i = 0; i < kMaxScripts; ++i) {
+        ScriptProfile* profile = &g_Window[slot];
+        if (profile->evt_code == evt_code) return profile;
+        if (profile->evt_code == 0) {
+            profile->evt_code = evt_code;
+            return profile;
+        }
+        slot = (slot + 1) & (kMaxScripts - 1);
+    }
+    return nullptr;
+}
+
+// Tallies the instructions between the script's program counter before and
+// after a dispatch. Control flow that jumps backwards (loops, gotos) can't be
+// followed this way, so those dispatches only count the final instruction.
+// If `end` is null (the script ended, so its entry may have been freed or
+// reused), counts up to the instruction that ends the script instead.
+void CountInstructions(
+    const int32_t* pc, const int32_t* end, uint32_t last_opcode,
+    ScriptProfile* profile) {
+    if (!end) {
+        for (int32_t i = 0; i < kMaxWalkWords; ++i) {
+            const uint32_t opcode = *pc & 0xffff;
+            const int32_t num_params = *pc >> 16;
+            if (opcode < kNumOpcodes) ++g_WindowOpcodes[opcode];
+            if (opcode == kUserFuncOpcode) ++profile->user_funcs;
+            ++profile->instructions;
+            if (opcode == kReturnOpcode || opcode == kEndScriptOpcode ||
+                num_params < 0) {
+                break;
+            }
+            pc += 1 + num_params;
+        }
+        return;
+    }
+    if (pc >= end || end - pc > kMaxWalkWords) {
+        if (last_opcode < kNumOpcodes) ++g_WindowOpcodes[last_opcode];
+        if (last_opcode == kUserFuncOpcode) ++profile->user_funcs;
+        ++profile->instructions;
+        return;
+    }
+    while (pc < end) {
+        const uint32_t opcode = *pc & 0xffff;
+        const int32_t num_params = *pc >> 16;
+        if (opcode < kNumOpcodes) ++g_WindowOpcodes[opcode];
+        if (opcode == kUserFuncOpcode) ++profile->user_funcs;
+        ++profile->instructions;
+        if (num_params < 0) break;
+        pc += 1 + num_params;
+    }
+}
+
+int32_t ProfileDispatch(EvtEntry* evt) {
+    // Capture state before dispatching, since the entry may be freed (or
+    // reused by another script) by the time it returns.
+    const uint32_t evt_code =
+        reinterpret_cast<uint32_t>(evt->restartFromLocation);
+    const int32_t thread_id = evt->threadId;
+    const int32_t* pc = reinterpret_cast<const int32_t*>(evt->nextCommandPtr);
+
+    const uint64_t start_time = gc::OSTime::OSGetTime();
+    const int32_t result = g_evtmgrCmd_trampoline(evt);
+    const uint32_t ticks =
+        static_cast<uint32_t>(gc::OSTime::OSGetTime() - start_time);
+
+    ScriptProfile* profile = LookupScript(evt_code);
+    if (!profile) {
+        g_WindowUntrackedTicks += ticks;
+        return result;
+    }
+    ++profile->dispatches;
+    profile->ticks += ticks;
+    if (ticks > profile->max_ticks) profile->max_ticks = ticks;
+    const bool same_script = (evt->flags & kEvtEntryInUse) &&
+        evt->threadId == thread_id &&
+        reinterpret_cast<uint32_t>(evt->restartFromLocation) == evt_code;
+    if (same_script) {
+        CountInstructions(
+            pc, reinterpret_cast<const int32_t*>(evt->nextCommandPtr),
+            evt->opcode, profile);
+    } else {
+        CountInstructions(pc, nullptr, 0, profile);
+    }
+    return result;
+}
+
+const char* LookupName(uint32_t evt_code) {
+    for (int32_t i = 0; i < g_NumNames; ++i) {
+        if (reinterpret_cast<uint32_t>(g_Names[i].evt_code) == evt_code) {
+            return g_Names[i].name;
+        }
+    }
+    return nullptr;
+}
+
+void Publish() {
+    ProfileDump& dump = g_EvtProfileDump;
+    int32_t num_scripts = 0;
+    dump.untracked_ticks = g_WindowUntrackedTicks;
+    dump.total_ticks = g_WindowUntrackedTicks;
+
+    // Insert each script into the published list, sorted by time spent.
+    for (int32_t i = 0; i < kMaxScripts; ++i) {
+        const ScriptProfile& profile = g_Window[i];
+        if (!profile.evt_code) continue;
+        dump.total_ticks += profile.ticks;
+
+        int32_t pos = num_scripts;
+        while (pos > 0 && dump.scripts[pos - 1].ticks < profile.ticks) --pos;
+        if (pos >= kMaxDumpScripts) continue;
+        if (num_scripts < kMaxDumpScripts) ++num_scripts;
+        for (int32_t j = num_scripts - 1; j > pos; --j) {
+            dump.scripts[j] = dump.scripts[j - 1];
+        }
+        dump.scripts[pos] = profile;
+        dump.scripts[pos].name =
+            reinterpret_cast<uint32_t>(LookupName(profile.evt_code));
+    }
+    dump.num_scripts = num_scripts;
+    memcpy(dump.opcode_counts, g_WindowOpcodes, sizeof(g_WindowOpcodes));
+
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    const OSModuleInfo* rel_file = mario_st->pRelFileBase;
+    const OSModuleInfo* map_alloc = mario_st->pMapAlloc;
+    dump.rel_file_base = reinterpret_cast<uint32_t>(rel_file);
+    dump.rel_file_id = rel_file ? rel_file->id : 0;
+    dump.map_alloc_base = reinterpret_cast<uint32_t>(map_alloc);
+    dump.map_alloc_id = map_alloc ? map_alloc->id : 0;
+    ++dump.windows_published;
+
+    memset(g_Window, 0, sizeof(g_Window));
+    memset(g_WindowOpcodes, 0, sizeof(g_WindowOpcodes));
+    g_WindowUntrackedTicks = 0;
+}
+
+void DrawProfile() {
+    const ProfileDump& dump = g_EvtProfileDump;
+    // OSTime ticks run at 40.5 MHz; print results in microseconds per frame.
+    const uint32_t kTicksPer2Usec = 81;
+    const int32_t num_scripts = static_cast<int32_t>(dump.num_scripts);
+
+    char buf[1024];
+    char* ptr = buf;
+    ptr += sprintf(
+        ptr, "evt: %" PRIu32 " us/frame\n",
+        dump.total_ticks * 2 / kTicksPer2Usec / kWindowFrames);
+    for (int32_t i = 0; i < kMaxDrawnScripts && i < num_scripts; ++i) {
+        const ScriptProfile& profile = dump.scripts[i];
+        const uint32_t us_per_frame =
+            profile.ticks * 2 / kTicksPer2Usec / kWindowFrames;
+        if (profile.name) {
+            ptr += sprintf(
+                ptr, "%-24.24s", reinterpret_cast<const char*>(profile.name));
+        } else {
+            ptr += sprintf(ptr, "%08" PRIx32 "                ",
+                           profile.evt_code);
+        }
+        ptr += sprintf(
+            ptr, " %5" PRIu32 "us %5" PRIu32 "op %3" PRIu32 "uf %3" PRIu32 "x\n",
+            us_per_frame, profile.instructions / kWindowFrames,
+            profile.user_funcs / kWindowFrames,
+            profile.dispatches / kWindowFrames);
+    }
+    DrawText(buf, -260, 170, 0xFF, true, ~0U, 0.55f, /* top-left */ 0);
+}
+
+bool ShouldDrawProfile() {
+    return g_DisplayEnabled && g_EvtProfileDump.windows_published;
+}
+
+// Draws the most expensive scripts from the last published window.
+const Overlay kProfileOverlay = {
+    DrawProfile, ShouldDrawProfile, CameraId::kDebug3d, 1.f
+};
+
+}
+
+void Init() {
+    RegisterOverlay(&kProfileOverlay);
+    
+    void* dispatch = FindDispatchFunction();
+    if (!dispatch) return;
+    g_evtmgrCmd_trampoline = patch::hookFunction(
+        reinterpret_cast<int32_t(*)(EvtEntry*)>(dispatch), ProfileDispatch);
+}
+
+void Update() {
+    if (++g_WindowFrame >= kWindowFrames) {
+        g_WindowFrame = 0;
+        Publish();
+    }
+}
+
+void ToggleDisplay() {
+    g_DisplayEnabled = !g_DisplayEnabled;
+}
+
+void RegisterScriptName(const void* evt_code, const char* name) {
+    if (g_NumNames >= kMaxNames) return;
+    g_Names[g_NumNames].evt_code = evt_code;
+    g_Names[g_NumNames].name = name;
+    ++g_NumNames;
+}
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include "flight_recorder.h"
+
+#include "card_file.h"
+#include "map_events.h"
+#include "randomizer.h"
+
+#include <gc/OSLink.h>
+#include <ttyd/mariost.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::flight_recorder {
+
+namespace {
+
+using ::gc::OSLink::OSModuleInfo;
+
+// Number of events kept in the ring buffer (power of 2); one is recorded per
+// frame, so this covers the last few seconds.
+constexpr const int32_t kNumEntries = 256;
+// Address the OS keeps a pointer to the current thread's context at; while
+// the crash handler runs, this is the context the exception was taken in.
+constexpr const uint32_t kCurrentContextAddr = 0x800000d4;
+// OSContext's state flag set if the FPRs were saved in it.
+constexpr const uint16_t kContextFprsSaved = 0x1;
+// Memory card file requested snapshots are written to.
+constexpr const char* kCardFileName = "pit_flight_recorder";
+
+namespace EntryType {
+    enum e {
+        kFrame = 1,         // OSTime ticks, rng_state_, floor_
+        kHook,              // arg = HookId, hook-specific value
+        kFloor,             // floor_, rng_state_
+        kSeed,              // seed
+        kModuleLink,        // arg = linked, module id, module address
+        kHeapPeaks,         // modules, heap 0 live bytes / largest free block
+        kAllocFailure,      // arg = heap, size
+    };
+}
+
+struct Entry {
+    uint8_t type;
+    uint8_t arg;
+    uint16_t frame;             // Low 16 bits of the frame counter.
+    uint32_t values[3];
+};
+
+// Layout of the parts of OSContext saved on a crash.
+struct CrashContext {
+    uint32_t gpr[32];
+    uint32_t cr;
+    uint32_t lr;
+    uint32_t ctr;
+    uint32_t xer;
+    uint32_t srr0;
+    uint32_t srr1;
+    uint32_t dsisr;
+    uint32_t dar;
+    uint32_t fpscr;
+    uint32_t fprs_valid;        // Only saved if the thread had used the FPU.
+    uint64_t fpr[32];
+};
+
+// Laid out for the host tool (flightrec.py) to find in a RAM dump;
+// keep the two in sync if changing the layout.
+struct Recorder {
+    uint32_t magic;             // 'PFRC'
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;             // Total events recorded.
+    uint32_t frame;
+    uint32_t frozen_reason;     // 0 = recording, 1 = crash, 2 = requested.
+    uint32_t anchor;            // Runtime address of Init, to relocate the map.
+    uint32_t rel_file_base;     // Loaded modules at the time of the freeze.
+    uint32_t map_alloc_base;
+    uint32_t context_valid;
+    CrashContext context;
+    Entry entries[kNumEntries];
+};
+
+// Zero-initialized (rather than in .data) to keep it out of the REL file.
+Recorder g_Recorder;
+card_file::Request g_CardRequest;
+
+void Record(
+    EntryType::e type, uint32_t arg,
+    uint32_t value0, uint32_t value1 = 0, uint32_t value2 = 0) {
+    if (g_Recorder.frozen_reason) return;
+    Entry& entry = g_Recorder.entries[g_Recorder.count % kNumEntries];
+    entry.type = type;
+    entry.arg = arg;
+    entry.frame = g_Recorder.frame;
+    entry.values[0] = value0;
+    entry.values[1] = value1;
+    entry.values[2] = value2;
+    ++g_Recorder.count;
+}
+
+// Records map changes and battles, with the id of the map.
+void RecordMapEvent(const map_events::Event& event) {
+    switch (event.type) {
+        case map_events::EventType::kMapLoaded:
+            RecordHook(HookId::kMapLoad, event.map);
+            break;
+        case map_events::EventType::kMapUnloading:
+            RecordHook(HookId::kMapUnload, event.map);
+            break;
+        case map_events::EventType::kBattleStart:
+            RecordHook(HookId::kBattleStart, event.map);
+            break;
+        case map_events::EventType::kBattleEnd:
+            RecordHook(HookId::kBattleEnd, event.map);
+            break;
+        default:
+            break;
+    }
+}
+
+void Freeze(uint32_t reason) {
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    g_Recorder.rel_file_base =
+        reinterpret_cast<uint32_t>(mario_st->pRelFileBase);
+    g_Recorder.map_alloc_base =
+        reinterpret_cast<uint32_t>(mario_st->pMapAlloc);
+    g_Recorder.frozen_reason = reason;
+}
+
+}
+
+void Init() {
+    g_Recorder.magic = 0x50465243;
+    g_Recorder.version = 2;
+    g_Recorder.capacity = kNumEntries;
+    g_Recorder.anchor = reinterpret_cast<uint32_t>(Init);
+    map_events::Subscribe(RecordMapEvent);
+}
+
+void RecordFrame(uint32_t ticks) {
+    const auto* randomizer = pit_randomizer::g_Randomizer;
+    Record(
+        EntryType::kFrame, 0, ticks,
+        randomizer ? randomizer->state_.rng_state_ : 0,
+        randomizer ? randomizer->state_.floor_ : 0);
+    if (!g_Recorder.frozen_reason) ++g_Recorder.frame;
+}
+
+void RecordHook(HookId::e hook, uint32_t value) {
+    Record(EntryType::kHook, hook, value);
+}
+
+void RecordFloor(int32_t floor, uint32_t rng_state) {
+    Record(EntryType::kFloor, 0, floor, rng_state);
+}
+
+void RecordSeed(uint32_t seed) {
+    Record(EntryType::kSeed, 0, seed);
+}
+
+void RecordModuleLink(const OSModuleInfo* module, bool linked) {
+    Record(
+        EntryType::kModuleLink, linked, module->id,
+        reinterpret_cast<uint32_t>(module));
+}
+
+void RecordHeapPeaks(
+    uint32_t primary_module, uint32_t secondary_module,
+    uint32_t live_high_water, uint32_t largest_free_low_water) {
+    Record(
+        EntryType::kHeapPeaks, 0, primary_module << 16 | secondary_module,
+        live_high_water, largest_free_low_water);
+}
+
+void RecordAllocFailure(uint32_t heap, uint32_t size) {
+    Record(EntryType::kAllocFailure, heap, size);
+}
+
+void OnCrash() {
+    if (g_Recorder.frozen_reason == 1) return;
+
+    const uint8_t* context =
+        *reinterpret_cast<const uint8_t**>(kCurrentContextAddr);
+    if (context) {
+        // GPRs, CR, LR, CTR and XER are contiguous at the start of OSContext,
+        // followed by the FPRs, FPSCR, then SRR0 and SRR1 (the faulting PC
+        // and MSR).
+        CrashContext& saved = g_Recorder.context;
+        memcpy(&saved, context, 0x90);
+        memcpy(saved.fpr, context + 0x90, sizeof(saved.fpr));
+        memcpy(&saved.fpscr, context + 0x194, 4);
+        memcpy(&saved.srr0, context + 0x198, 8);
+        const uint16_t state = *reinterpret_cast<const uint16_t*>(
+            context + 0x1a2);
+        saved.fprs_valid = (state & kContextFprsSaved) ? 1 : 0;
+        g_Recorder.context_valid = 1;
+    }
+    // The data access fault registers aren't saved in the context.
+    uint32_t dsisr, dar;
+    __asm__ volatile("mfspr %0, 18" : "=r"(dsisr));
+    __asm__ volatile("mfspr %0, 19" : "=r"(dar));
+    g_Recorder.context.dsisr = dsisr;
+    g_Recorder.context.dar = dar;
+
+    // Replaces any requested snapshot, so the crash is always what's kept.
+    Freeze(/* reason = */ 1);
+}
+
+void ToggleSnapshot() {
+    switch (g_Recorder.frozen_reason) {
+        case 0:
+            g_Recorder.context_valid = 0;
+            Freeze(/* reason = */ 2);
+            // Keep a copy on the memory card too, in case there's no way to
+            // take a RAM dump (e.g. on console).
+            g_CardRequest.name = kCardFileName;
+            g_CardRequest.data = &g_Recorder;
+            g_CardRequest.size = sizeof(g_Recorder);
+            g_CardRequest.write = true;
+            card_file::Submit(&g_CardRequest);
+            break;
+        case 2:
+            // Not until the copy is written, so it isn't changed mid-write.
+            if (!g_CardRequest.pending) g_Recorder.frozen_reason = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+}
@@ -0,0 +1,388 @@
+#include "heap_tracker.h"
+
+#include "common_types.h"
+#include "common_ui.h"
+#include "flight_recorder.h"
+#include "map_events.h"
+#include "patch.h"
+
+#include <gc/OSLink.h>
+#include <gc/os.h>
+#include <ttyd/dispdrv.h>
+#include <ttyd/mariost.h>
+#include <ttyd/memory.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+namespace mod::heap_tracker {
+
+namespace {
+
+using ::gc::os::ChunkInfo;
+using ::gc::os::HeapInfo;
+using ::gc::OSLink::OSModuleInfo;
+using ::ttyd::memory::MapAllocEntry;
+using ::ttyd::dispdrv::CameraId;
+
+// Number of __memAlloc heaps tracked; memInit creates them in order, so
+// their indices match the OS heaps'.
+constexpr const int32_t kMaxHeaps = 6;
+// Number of distinct module pairings kept.
+constexpr const int32_t kMaxPairings = 32;
+// OSAlloc keeps each block's chunk header (including its size) before it.
+constexpr const uint32_t kChunkHeaderSize = 0x20;
+// Warn once a heap's largest free block drops below this.
+constexpr const uint32_t kLowFreeBlockBytes = 0x8000;
+// Number of frames a warning stays on screen (~5 seconds).
+constexpr const int32_t kWarningFrames = 300;
+// Heap ids used for the map heap, and the secondary module's pMapAlloc slot
+// and bss buffer, in warnings and the flight recorder.
+constexpr const uint32_t kMapHeapId = 0xff;
+constexpr const uint32_t kMapAllocSlotId = 0xfe;
+constexpr const uint32_t kRelBssId = 0xfd;
+// Bit in g_WarnedHeaps for the map heap.
+constexpr const uint32_t kMapHeapWarnedBit = 1U << 31;
+// Most map heap blocks walked when sampling it (in case of a broken list).
+constexpr const int32_t kMaxMapHeapEntries = 0x1000;
+
+struct HeapPeaks {
+    uint32_t live_high_water[kMaxHeaps];
+    uint32_t largest_free_low_water[kMaxHeaps];
+    uint32_t map_heap_bytes;        // Total _mapAlloc'd while the map ran.
+    uint32_t secondary_rel_size;    // Size of the REL in the pMapAlloc slot.
+    uint32_t map_heap_largest_free_low_water;
+};
+
+struct PairingStats {
+    uint16_t primary_module;        // ModuleId of the map's own REL.
+    uint16_t secondary_module;      // ModuleId::INVALID_MODULE if none.
+    uint16_t num_maps;
+    uint16_t num_alloc_failures;
+    HeapPeaks peaks;
+};
+
+// Laid out for the host tool (modfootprint.py) to find in a RAM dump;
+// keep the two in sync if changing the layout.
+struct Tracker {
+    uint32_t magic;                 // 'PHEP'
+    uint32_t version;
+    uint32_t num_heaps;
+    uint32_t num_pairings;
+    uint32_t map_alloc_capacity;    // Size of the pMapAlloc slot (0 if unknown).
+    uint32_t map_heap_largest_free; // As of the last _mapAlloc.
+    uint32_t live_bytes[kMaxHeaps];
+    uint32_t largest_free[kMaxHeaps];   // As of the last sample.
+    HeapPeaks current;              // Peaks since the current map loaded.
+    uint32_t current_alloc_failures;
+    PairingStats pairings[kMaxPairings];
+};
+
+// Zero-initialized (rather than in .data) to keep it out of the REL file.
+Tracker g_Tracker;
+
+// Trampolines for the hooked allocators.
+void* (*g___memAlloc_trampoline)(uint32_t, uint32_t) = nullptr;
+void (*g___memFree_trampoline)(uint32_t, void*) = nullptr;
+void* (*g__mapAlloc_trampoline)(void*, uint32_t) = nullptr;
+
+char g_WarningText[96];
+int32_t g_WarningFramesLeft = 0;
+// Heaps already warned about as low since the current map loaded.
+uint32_t g_WarnedHeaps = 0;
+
+uint32_t ChunkSize(const void* ptr) {
+    return reinterpret_cast<const ChunkInfo*>(
+        reinterpret_cast<uintptr_t>(ptr) - kChunkHeaderSize)->size;
+}
+
+uint32_t GetLargestFreeBlock(int32_t heap) {
+    uint32_t largest = 0;
+    const HeapInfo& info = gc::os::OSAlloc_HeapArray[heap];
+    for (const ChunkInfo* chunk = info.firstFree; chunk; chunk = chunk->next) {
+        if (chunk->size > largest) largest = chunk->size;
+    }
+    return largest;
+}
+
+bool IsValidHeap(uint32_t heap) {
+    // Destroyed / never-created heaps have a negative size.
+    return heap < kMaxHeaps &&
+        static_cast<int32_t>(heap) < gc::os::OSAlloc_NumHeaps &&
+        static_cast<int32_t>(gc::os::OSAlloc_HeapArray[heap].capacity) >= 0;
+}
+
+void ShowWarning() {
+    g_WarningFramesLeft = kWarningFrames;
+}
+
+void OnAllocFailure(uint32_t heap, uint32_t size) {
+    ++g_Tracker.current_alloc_failures;
+    flight_recorder::RecordAllocFailure(heap, size);
+    if (heap == kMapHeapId) {
+        sprintf(
+            g_WarningText,
+            "Map heap alloc of %" PRIu32 " bytes will fail! "
+            "(%" PRIu32 " max free)",
+            size, g_Tracker.map_heap_largest_free);
+    } else if (heap == kMapAllocSlotId) {
+        sprintf(
+            g_WarningText,
+            "%" PRIu32 "-byte REL overflows pMapAlloc (%" PRIu32 " bytes)!",
+            size, g_Tracker.map_alloc_capacity);
+    } else if (heap == kRelBssId) {
+        sprintf(
+            g_WarningText, "%" PRIu32 "-byte REL bss overflows its buffer!",
+            size);
+    } else {
+        sprintf(
+            g_WarningText,
+            "Heap %" PRIu32 " alloc of %" PRIu32 " bytes will fail! "
+            "(%" PRIu32 " max free)",
+            heap, size, g_Tracker.largest_free[heap]);
+    }
+    ShowWarning();
+}
+
+void* TrackMemAlloc(uint32_t heap, uint32_t size) {
+    if (!IsValidHeap(heap)) return g___memAlloc_trampoline(heap, size);
+    // Check whether the allocation will fail up front (while a warning can
+    // still be recorded), re-checking the heap if the last sample says so.
+    if (size + kChunkHeaderSize > g_Tracker.largest_free[heap]) {
+        g_Tracker.largest_free[heap] = GetLargestFreeBlock(heap);
+        if (size + kChunkHeaderSize > g_Tracker.largest_free[heap]) {
+            OnAllocFailure(heap, size);
+        }
+    }
+    void* ptr = g___memAlloc_trampoline(heap, size);
+    if (ptr) {
+        uint32_t& live = g_Tracker.live_bytes[heap];
+        live += ChunkSize(ptr);
+        if (live > g_Tracker.current.live_high_water[heap]) {
+            g_Tracker.current.live_high_water[heap] = live;
+        }
+    }
+    return ptr;
+}
+
+void TrackMemFree(uint32_t heap, void* ptr) {
+    if (ptr && IsValidHeap(heap)) {
+        g_Tracker.live_bytes[heap] -= ChunkSize(ptr);
+    }
+    g___memFree_trampoline(heap, ptr);
+}
+
+uint32_t GetMapHeapLargestFreeBlock(const void* heap) {
+    uint32_t largest = 0;
+    const auto* entry = reinterpret_cast<const MapAllocEntry*>(heap);
+    for (int32_t i = 0; entry && i < kMaxMapHeapEntries; ++i) {
+        if (!entry->in_use && entry->size > largest) largest = entry->size;
+        entry = entry->next;
+    }
+    return largest;
+}
+
+void SampleMapHeap(const void* heap) {
+    const uint32_t largest = GetMapHeapLargestFreeBlock(heap);
+    g_Tracker.map_heap_largest_free = largest;
+    if (largest < g_Tracker.current.map_heap_largest_free_low_water) {
+        g_Tracker.current.map_heap_largest_free_low_water = largest;
+    }
+    if (largest < kLowFreeBlockBytes && !(g_WarnedHeaps & kMapHeapWarnedBit)) {
+        g_WarnedHeaps |= kMapHeapWarnedBit;
+        sprintf(
+            g_WarningText, "Map heap low: %" PRIu32 "K max free",
+            largest >> 10);
+        ShowWarning();
+    }
+}
+
+void* TrackMapAlloc(void* heap, uint32_t size) {
+    // Check whether the allocation will fail up front, as for __memAlloc.
+    if (heap && size > GetMapHeapLargestFreeBlock(heap)) {
+        OnAllocFailure(kMapHeapId, size);
+    }
+    void* ptr = g__mapAlloc_trampoline(heap, size);
+    if (ptr) g_Tracker.current.map_heap_bytes += size;
+    if (heap) SampleMapHeap(heap);
+    return ptr;
+}
+
+// Returns the size of the pMapAlloc slot, if it's a __memAlloc'd block.
+uint32_t GetMapAllocCapacity() {
+    const void* slot = ttyd::mariost::g_MarioSt->pMapAlloc;
+    if (!slot) return 0;
+    for (int32_t i = 0; i < kMaxHeaps; ++i) {
+        if (!IsValidHeap(i)) continue;
+        const HeapInfo& info = gc::os::OSAlloc_HeapArray[i];
+        for (const ChunkInfo* chunk = info.firstUsed; chunk;
+             chunk = chunk->next) {
+            if (reinterpret_cast<uintptr_t>(chunk) + kChunkHeaderSize ==
+                reinterpret_cast<uintptr_t>(slot)) {
+                return chunk->size - kChunkHeaderSize;
+            }
+        }
+    }
+    return 0;
+}
+
+void ResetCurrentPeaks() {
+    for (int32_t i = 0; i < kMaxHeaps; ++i) {
+        g_Tracker.current.live_high_water[i] = g_Tracker.live_bytes[i];
+        g_Tracker.current.largest_free_low_water[i] = ~0U;
+    }
+    g_Tracker.current.map_heap_bytes = 0;
+    g_Tracker.current.secondary_rel_size = 0;
+    g_Tracker.current.map_heap_largest_free_low_water = ~0U;
+    g_Tracker.current_alloc_failures = 0;
+    g_WarnedHeaps = 0;
+}
+
+PairingStats* GetPairingStats(uint16_t primary, uint16_t secondary) {
+    for (uint32_t i = 0; i < g_Tracker.num_pairings; ++i) {
+        PairingStats& stats = g_Tracker.pairings[i];
+        if (stats.primary_module == primary &&
+            stats.secondary_module == secondary) {
+            return &stats;
+        }
+    }
+    if (g_Tracker.num_pairings == kMaxPairings) return nullptr;
+    PairingStats& stats = g_Tracker.pairings[g_Tracker.num_pairings++];
+    stats.primary_module = primary;
+    stats.secondary_module = secondary;
+    for (int32_t i = 0; i < kMaxHeaps; ++i) {
+        stats.peaks.largest_free_low_water[i] = ~0U;
+    }
+    stats.peaks.map_heap_largest_free_low_water = ~0U;
+    return &stats;
+}
+
+// Folds the current map's peaks into its module pairing's stats, then starts
+// tracking the next map.
+void OnMapUnloading(const map_events::Event& event) {
+    if (event.type != map_events::EventType::kMapUnloading) return;
+
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    const uint16_t primary =
+        mario_st->pRelFileBase ? mario_st->pRelFileBase->id : 0;
+    const uint16_t secondary =
+        g_Tracker.current.secondary_rel_size && mario_st->pMapAlloc
+            ? mario_st->pMapAlloc->id : ModuleId::INVALID_MODULE;
+
+    const HeapPeaks& current = g_Tracker.current;
+    if (PairingStats* stats = GetPairingStats(primary, secondary); stats) {
+        HeapPeaks& peaks = stats->peaks;
+        for (int32_t i = 0; i < kMaxHeaps; ++i) {
+            if (current.live_high_water[i] > peaks.live_high_water[i]) {
+                peaks.live_high_water[i] = current.live_high_water[i];
+            }
+            if (current.largest_free_low_water[i] <
+                peaks.largest_free_low_water[i]) {
+                peaks.largest_free_low_water[i] =
+                    current.largest_free_low_water[i];
+            }
+        }
+        if (current.map_heap_bytes > peaks.map_heap_bytes) {
+            peaks.map_heap_bytes = current.map_heap_bytes;
+        }
+        if (current.secondary_rel_size > peaks.secondary_rel_size) {
+            peaks.secondary_rel_size = current.secondary_rel_size;
+        }
+        if (current.map_heap_largest_free_low_water <
+            peaks.map_heap_largest_free_low_water) {
+            peaks.map_heap_largest_free_low_water =
+                current.map_heap_largest_free_low_water;
+        }
+        ++stats->num_maps;
+        stats->num_alloc_failures += g_Tracker.current_alloc_failures;
+    }
+    flight_recorder::RecordHeapPeaks(
+        primary, secondary, current.live_high_water[0],
+        current.largest_free_low_water[0]);
+
+    ResetCurrentPeaks();
+}
+
+void DrawWarning() {
+    DrawText(
+        g_WarningText, 0, -170, 0xFF, true, 0xFF4040FFU, 0.6f,
+        /* bottom-center */ 7);
+}
+
+bool ShouldDrawWarning() {
+    return g_WarningFramesLeft > 0;
+}
+
+const Overlay kHeapWarningOverlay = {
+    DrawWarning, ShouldDrawWarning, CameraId::kDebug3d, 3.f
+};
+
+}
+
+void Init() {
+    g_Tracker.magic = 0x50484550;
+    g_Tracker.version = 2;
+    g_Tracker.num_heaps = kMaxHeaps;
+    // Count the blocks already allocated before the hooks are installed.
+    for (int32_t i = 0; i < kMaxHeaps; ++i) {
+        if (!IsValidHeap(i)) continue;
+        const HeapInfo& info = gc::os::OSAlloc_HeapArray[i];
+        for (const ChunkInfo* chunk = info.firstUsed; chunk;
+             chunk = chunk->next) {
+            g_Tracker.live_bytes[i] += chunk->size;
+        }
+        g_Tracker.largest_free[i] = GetLargestFreeBlock(i);
+    }
+    ResetCurrentPeaks();
+
+    g___memAlloc_trampoline = patch::hookFunction(
+        ttyd::memory::__memAlloc, TrackMemAlloc);
+    g___memFree_trampoline = patch::hookFunction(
+        ttyd::memory::__memFree, TrackMemFree);
+    g__mapAlloc_trampoline = patch::hookFunction(
+        ttyd::memory::_mapAlloc, TrackMapAlloc);
+
+    RegisterOverlay(&kHeapWarningOverlay);
+    map_events::Subscribe(OnMapUnloading);
+}
+
+void Update() {
+    if (g_WarningFramesLeft > 0) --g_WarningFramesLeft;
+    for (int32_t i = 0; i < kMaxHeaps; ++i) {
+        if (!IsValidHeap(i)) continue;
+        const uint32_t largest = GetLargestFreeBlock(i);
+        g_Tracker.largest_free[i] = largest;
+        if (largest < g_Tracker.current.largest_free_low_water[i]) {
+            g_Tracker.current.largest_free_low_water[i] = largest;
+        }
+        if (largest < kLowFreeBlockBytes && !(g_WarnedHeaps & (1 << i))) {
+            g_WarnedHeaps |= 1 << i;
+            sprintf(
+                g_WarningText,
+                "Heap %" PRId32 " low: %" PRIu32 "K max free, "
+                "%" PRIu32 "K live",
+                i, largest >> 10, g_Tracker.live_bytes[i] >> 10);
+            ShowWarning();
+        }
+    }
+}
+
+void OnSecondaryModuleLoad(
+    const void* rel_data, uint32_t size, uint32_t bss_capacity) {
+    g_Tracker.current.secondary_rel_size = size;
+    g_Tracker.map_alloc_capacity = GetMapAllocCapacity();
+    if (g_Tracker.map_alloc_capacity && size > g_Tracker.map_alloc_capacity) {
+        OnAllocFailure(kMapAllocSlotId, size);
+    }
+    const uint32_t bss_size =
+        reinterpret_cast<const OSModuleInfo*>(rel_data)->bss_size;
+    if (bss_size > bss_capacity) OnAllocFailure(kRelBssId, bss_size);
+}
+
+uint32_t GetLiveHighWater(int32_t heap) {
+    if (heap < 0 || heap >= kMaxHeaps) return 0;
+    return g_Tracker.current.live_high_water[heap];
+}
+
+}
@@ -0,0 +1,573 @@
+#include "input_replay.h"
+
+#include "card_file.h"
+#include "common_ui.h"
+#include "patch.h"
+#include "randomizer.h"
+#include "randomizer_state.h"
+
+#include <ttyd/dispdrv.h>
+#include <ttyd/mariost.h>
+#include <ttyd/memory.h>
+#include <ttyd/system.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace mod::input_replay {
+
+namespace {
+
+using ::mod::pit_randomizer::g_Randomizer;
+using ::mod::pit_randomizer::RandomizerState;
+using ::ttyd::dispdrv::CameraId;
+
+// Bytes allocated for the ring buffer holding the most recent encoded runs
+// (from the main heap, when first armed); a whole number of card sectors.
+constexpr const uint32_t kLogBytes = 0x10000;
+// The runs are streamed out to this memory card file a sector at a time as
+// they're recorded (and the rest when recording stops), in the background;
+// it holds the header in its first sector, then the runs. It's created big
+// enough for a full run (129 blocks, so it needs a larger card than the
+// 59-block one, e.g. a Memory Card 251).
+constexpr const char* kCardFileName = "pit_input_log";
+constexpr const uint32_t kCardSectorSize = 0x2000;
+constexpr const uint32_t kCardDataOffset = kCardSectorSize;
+constexpr const uint32_t kCardLogBytes = 0x100000;
+// Seed for the replacement irand while recording / replaying.
+constexpr const uint32_t kIrandSeed = 0x5049524e;
+// Largest possible encoded run: mask, a 32-bit varint length, all fields.
+constexpr const uint32_t kMaxRunBytes = 2 + 5 + 9 * 2;
+// Stick positions within this of the center are recorded as centered, and
+// others are rounded toward the center to a multiple of kStickStep, so noise
+// from a resting (or held) stick doesn't split runs.
+constexpr const int32_t kStickDeadzone = 8;
+constexpr const int32_t kStickStep = 4;
+// How long warnings (e.g. the log filling up) stay on screen.
+constexpr const int32_t kWarningFrames = 300;
+
+// The inputs sampled each frame, in the order their changes are encoded.
+namespace Field {
+    enum e {
+        kButton = 0,
+        kButtonTrg,
+        kButtonRep,
+        kDir,
+        kDirTrg,
+        kDirRep,
+        kStickX,        // Signed; the low 16 bits of the 32-bit values.
+        kStickY,
+        kSubStickY,
+        kNumFields,
+    };
+}
+
+namespace Mode {
+    enum e {
+        kIdle = 0,
+        kArmedRecording,
+        kRecording,
+        kArmedReplay,
+        kReplaying,
+        kLoadingReplay,     // Reading the recording's header from the card.
+    };
+}
+
+// The kind of card request in progress.
+namespace CardOp {
+    enum e {
+        kCreate = 0,
+        kWriteRuns,
+        kWriteHeader,
+        kReadHeader,
+        kReadRuns,
+    };
+}
+
+struct Sample {
+    uint16_t values[Field::kNumFields];
+};
+
+// Laid out for the host tool (inputlog.py) to find in a RAM dump, or the
+// memory card file; keep the two in sync if changing the layout. The most
+// recent data_capacity bytes of encoded runs are in the ring buffer at
+// data_address (byte n at n % data_capacity); the card file has all of them,
+// card_data_offset bytes after the header. Each run is a big-endian 16-bit
+// mask of the fields that changed from the previous run, the run's length in
+// frames (a little-endian base-128 varint), then the changed fields' new
+// values (big-endian 16-bit).
+struct LogHeader {
+    uint32_t magic;                 // 'PINP'
+    uint32_t version;
+    uint32_t mode;
+    uint32_t data_address;
+    uint32_t data_capacity;
+    uint32_t data_size;
+    uint32_t card_data_offset;
+    uint32_t num_frames;
+    uint32_t irand_seed;
+    uint32_t overflowed;
+    uint32_t options;               // The file's options when recording began.
+    int16_t  hp_multiplier;
+    int16_t  atk_multiplier;
+    char     filename[20];
+};
+
+LogHeader g_Log;
+uint8_t* g_Data = nullptr;
+uint32_t g_IrandState = 0;
+// Whether the recording is being streamed to (or replayed from) the card,
+// how much of it has been written to the card, and the end of the runs in
+// the ring buffer (recorded, or read from the card).
+bool g_CardStreaming = false;
+uint32_t g_FlushedSize = 0;
+uint32_t g_LoadedEnd = 0;
+// The card request in progress (one at a time), what it's for, and the end
+// of the runs it writes / reads.
+card_file::Request g_CardRequest;
+CardOp::e g_CardOp = CardOp::kCreate;
+uint32_t g_CardOpEnd = 0;
+// The copy of the header written to / read from the card, and whether the
+// card's is out of date.
+LogHeader g_CardHeader;
+bool g_HeaderDirty = false;
+
+char g_WarningText[96];
+int32_t g_WarningFramesLeft = 0;
+
+// The current sample (and while recording, the run it's part of; while
+// replaying, the frames left in its run).
+Sample g_Sample;
+uint32_t g_RunFrames = 0;
+// The sample last written to / read from the log.
+Sample g_LastRunSample;
+uint32_t g_ReadPos = 0;
+
+// Trampolines for the hooked input getters, in Field order.
+uint32_t (*g_Getter_trampolines[Field::kNumFields])(uint32_t) = { nullptr };
+void (*g_makeKey_trampoline)() = nullptr;
+uint32_t (*g_irand_trampoline)(uint32_t) = nullptr;
+
+bool IsActive() {
+    return g_Log.mode == Mode::kRecording || g_Log.mode == Mode::kReplaying;
+}
+
+void ShowWarning(const char* text) {
+    strncpy(g_WarningText, text, sizeof(g_WarningText) - 1);
+    g_WarningFramesLeft = kWarningFrames;
+}
+
+// While recording, the game is given the recorded (quantized) sample too,
+// so the replay sees exactly the same inputs.
+template <int32_t field>
+uint32_t GetInput(uint32_t pad) {
+    if (IsActive() && pad == 0) {
+        const uint32_t value = g_Sample.values[field];
+        return field >= Field::kStickX
+            ? static_cast<uint32_t>(static_cast<int16_t>(value)) : value;
+    }
+    return g_Getter_trampolines[field](pad);
+}
+
+uint16_t QuantizeStick(uint32_t value) {
+    const int32_t position = static_cast<int32_t>(value);
+    if (position > -kStickDeadzone && position < kStickDeadzone) return 0;
+    return static_cast<uint16_t>(position - position % kStickStep);
+}
+
+uint32_t FixedSeedIrand(uint32_t range) {
+    if (!IsActive()) return g_irand_trampoline(range);
+    g_IrandState = g_IrandState * 0x41c64e6d + 12345;
+    return range ? ((g_IrandState >> 16) & 0x7fff) % range : 0;
+}
+
+// The end of the space runs can be written to; without the card, nothing
+// can be dropped from the ring buffer to make room.
+uint32_t GetWritableEnd() {
+    if (!g_CardStreaming) return kLogBytes;
+    const uint32_t end =
+        (g_FlushedSize & ~(kCardSectorSize - 1)) + kLogBytes;
+    return end < kCardLogBytes ? end : kCardLogBytes;
+}
+
+void WriteRun() {
+    uint8_t run[kMaxRunBytes];
+    uint8_t* ptr = run;
+    uint32_t mask = 0;
+    for (int32_t i = 0; i < Field::kNumFields; ++i) {
+        if (g_Sample.values[i] != g_LastRunSample.values[i]) mask |= 1 << i;
+    }
+    *ptr++ = mask >> 8;
+    *ptr++ = mask;
+    for (uint32_t frames = g_RunFrames; ; frames >>= 7) {
+        if (frames < 0x80) {
+            *ptr++ = frames;
+            break;
+        }
+        *ptr++ = (frames & 0x7f) | 0x80;
+    }
+    for (int32_t i = 0; i < Field::kNumFields; ++i) {
+        if (!(mask & (1 << i))) continue;
+        *ptr++ = g_Sample.values[i] >> 8;
+        *ptr++ = g_Sample.values[i];
+    }
+    const uint32_t length = ptr - run;
+    if (g_Log.data_size + length > GetWritableEnd()) {
+        g_Log.overflowed = 1;
+        g_Log.mode = Mode::kIdle;
+        char text[96];
+        sprintf(
+            text, "Input log full; recording stopped after %" PRIu32
+            " frames.", g_Log.num_frames);
+        ShowWarning(text);
+        return;
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+        g_Data[(g_Log.data_size + i) % kLogBytes] = run[i];
+    }
+    g_Log.data_size += length;
+    g_LoadedEnd = g_Log.data_size;
+    g_LastRunSample = g_Sample;
+}
+
+// Reads the next run into g_Sample / g_RunFrames; returns false at the end.
+bool ReadRun() {
+    if (g_ReadPos + 3 > g_Log.data_size) return false;
+    if (g_LoadedEnd < g_Log.data_size &&
+        g_ReadPos + kMaxRunBytes > g_LoadedEnd) {
+        ShowWarning("Input log replay ran past the part loaded; stopped.");
+        return false;
+    }
+    uint8_t run[kMaxRunBytes];
+    for (uint32_t i = 0; i < kMaxRunBytes; ++i) {
+        run[i] = g_Data[(g_ReadPos + i) % kLogBytes];
+    }
+    const uint8_t* ptr = run;
+    const uint32_t mask = ptr[0] << 8 | ptr[1];
+    ptr += 2;
+    g_RunFrames = 0;
+    for (int32_t shift = 0; ; shift += 7) {
+        g_RunFrames |= (*ptr & 0x7f) << shift;
+        if (!(*ptr++ & 0x80)) break;
+    }
+    g_Sample = g_LastRunSample;
+    for (int32_t i = 0; i < Field::kNumFields; ++i) {
+        if (!(mask & (1 << i))) continue;
+        g_Sample.values[i] = ptr[0] << 8 | ptr[1];
+        ptr += 2;
+    }
+    g_ReadPos += ptr - run;
+    g_LastRunSample = g_Sample;
+    return true;
+}
+
+// Length of the part of the runs from `pos` to `end` that's contiguous in
+// the ring buffer (so can be read / written in one request).
+uint32_t GetChunkLength(uint32_t pos, uint32_t end) {
+    const uint32_t length = kLogBytes - pos % kLogBytes;
+    return length < end - pos ? length : end - pos;
+}
+
+void SubmitCardRequest(
+    CardOp::e op, void* data, uint32_t size, uint32_t offset,
+    uint32_t op_end = 0) {
+    g_CardOp = op;
+    g_CardOpEnd = op_end;
+    g_CardRequest.data = data;
+    g_CardRequest.size = size;
+    g_CardRequest.offset = offset;
+    g_CardRequest.file_size =
+        op == CardOp::kCreate ? kCardDataOffset + kCardLogBytes : 0;
+    g_CardRequest.write = op <= CardOp::kWriteHeader;
+    card_file::Submit(&g_CardRequest);
+}
+
+// Writes the header as of the runs on the card (via a copy, since the log's
+// changes every frame while recording).
+void SubmitHeaderWrite(CardOp::e op) {
+    g_CardHeader = g_Log;
+    g_CardHeader.data_size = g_FlushedSize;
+    g_HeaderDirty = false;
+    SubmitCardRequest(op, &g_CardHeader, sizeof(g_CardHeader), 0);
+}
+
+// Queues the next write of runs recorded since the last one to the card:
+// whole sectors while recording (so the ones being written don't change),
+// and the rest (the last, partial sector) once it's stopped; then the header.
+void StreamOut() {
+    const uint32_t end = g_Log.mode == Mode::kRecording
+        ? g_Log.data_size & ~(kCardSectorSize - 1) : g_Log.data_size;
+    if (g_FlushedSize < end) {
+        const uint32_t pos = g_FlushedSize & ~(kCardSectorSize - 1);
+        const uint32_t length = GetChunkLength(pos, end);
+        SubmitCardRequest(
+            CardOp::kWriteRuns, g_Data + pos % kLogBytes, length,
+            kCardDataOffset + pos, pos + length);
+    } else if (g_HeaderDirty) {
+        SubmitHeaderWrite(CardOp::kWriteHeader);
+    }
+}
+
+// Queues a read of the next runs to replay from the card into the ring
+// buffer, up to kLogBytes past the sector being replayed.
+void StreamIn() {
+    const uint32_t limit = (g_ReadPos & ~(kCardSectorSize - 1)) + kLogBytes;
+    const uint32_t end = limit < g_Log.data_size ? limit : g_Log.data_size;
+    if (g_LoadedEnd >= end) return;
+    const uint32_t length = GetChunkLength(g_LoadedEnd, end);
+    SubmitCardRequest(
+        CardOp::kReadRuns, g_Data + g_LoadedEnd % kLogBytes, length,
+        kCardDataOffset + g_LoadedEnd, g_LoadedEnd + length);
+}
+
+// Whether the last recording is still being written out to the card.
+bool IsCardBusy() {
+    return g_CardRequest.pending || (g_CardStreaming &&
+        (g_FlushedSize < g_Log.data_size || g_HeaderDirty));
+}
+
+void OnCardRequestDone(card_file::Request* /* request */, bool success) {
+    switch (g_CardOp) {
+        case CardOp::kCreate:
+            g_CardStreaming = success;
+            if (!success) {
+                ShowWarning("No room for the input log on the memory card; "
+                            "recording to RAM only.");
+            }
+            break;
+        case CardOp::kWriteRuns:
+        case CardOp::kWriteHeader:
+            if (!success) {
+                g_CardStreaming = false;
+                ShowWarning("Couldn't write the input log to the memory card!");
+                break;
+            }
+            if (g_CardOp == CardOp::kWriteRuns) {
+                g_FlushedSize = g_CardOpEnd;
+                g_HeaderDirty = true;
+            }
+            break;
+        case CardOp::kReadHeader:
+            if (g_Log.mode != Mode::kLoadingReplay) break;
+            if (!success || g_CardHeader.magic != g_Log.magic ||
+                g_CardHeader.version != g_Log.version ||
+                !g_CardHeader.num_frames) {
+                g_Log.mode = Mode::kIdle;
+                ShowWarning("No input log on the memory card to replay.");
+                break;
+            }
+            g_CardHeader.data_address = g_Log.data_address;
+            g_CardHeader.data_capacity = g_Log.data_capacity;
+            g_Log = g_CardHeader;
+            g_Log.mode = Mode::kArmedReplay;
+            // Already on the card, so there's nothing to flush; the runs are
+            // read in (starting now) from the beginning.
+            g_FlushedSize = g_Log.data_size;
+            g_LoadedEnd = 0;
+            g_ReadPos = 0;
+            g_CardStreaming = true;
+            break;
+        case CardOp::kReadRuns:
+            if (success) {
+                g_LoadedEnd = g_CardOpEnd;
+            } else if (g_Log.mode == Mode::kArmedReplay ||
+                       g_Log.mode == Mode::kReplaying) {
+                g_Log.mode = Mode::kIdle;
+                ShowWarning(
+                    "Couldn't read the input log from the memory card!");
+            }
+            break;
+    }
+}
+
+void RecordFrame() {
+    Sample sample;
+    for (int32_t i = 0; i < Field::kNumFields; ++i) {
+        const uint32_t value = g_Getter_trampolines[i](0);
+        sample.values[i] = i >= Field::kStickX ? QuantizeStick(value) : value;
+    }
+    if (g_RunFrames && memcmp(&sample, &g_Sample, sizeof(Sample))) {
+        WriteRun();
+        g_RunFrames = 0;
+    }
+    g_Sample = sample;
+    ++g_RunFrames;
+    ++g_Log.num_frames;
+}
+
+void ReplayFrame() {
+    if (!g_RunFrames && !ReadRun()) {
+        // Out of inputs; hand control back to the controller.
+        g_Log.mode = Mode::kIdle;
+        return;
+    }
+    --g_RunFrames;
+}
+
+void OnMakeKey() {
+    g_makeKey_trampoline();
+    if (g_WarningFramesLeft > 0) --g_WarningFramesLeft;
+    if (g_Log.mode == Mode::kRecording) {
+        RecordFrame();
+    } else if (g_Log.mode == Mode::kReplaying) {
+        ReplayFrame();
+    }
+}
+
+void StopRecording() {
+    if (g_RunFrames) WriteRun();
+    g_RunFrames = 0;
+    if (g_Log.mode == Mode::kRecording) g_Log.mode = Mode::kIdle;
+}
+
+void DrawWarning() {
+    DrawText(
+        g_WarningText, 0, -145, 0xFF, true, 0xFF4040FFU, 0.6f,
+        /* bottom-center */ 7);
+}
+
+bool ShouldDrawWarning() {
+    return g_WarningFramesLeft > 0;
+}
+
+const Overlay kWarningOverlay = {
+    DrawWarning, ShouldDrawWarning, CameraId::kDebug3d, 3.f
+};
+
+// Hooks the input getters, makeKey and irand, and allocates the log; only
+// done the first time recording or replay is armed, so nothing is hooked
+// otherwise.
+bool InstallHooks() {
+    if (g_Data) return true;
+    g_Data = reinterpret_cast<uint8_t*>(
+        ttyd::memory::__memAlloc(0, kLogBytes));
+    if (!g_Data) return false;
+    g_Log.data_address = reinterpret_cast<uint32_t>(g_Data);
+    g_Log.data_capacity = kLogBytes;
+
+    g_Getter_trampolines[Field::kButton] = patch::hookFunction(
+        ttyd::system::keyGetButton, GetInput<Field::kButton>);
+    g_Getter_trampolines[Field::kButtonTrg] = patch::hookFunction(
+        ttyd::system::keyGetButtonTrg, GetInput<Field::kButtonTrg>);
+    g_Getter_trampolines[Field::kButtonRep] = patch::hookFunction(
+        ttyd::system::keyGetButtonRep, GetInput<Field::kButtonRep>);
+    g_Getter_trampolines[Field::kDir] = patch::hookFunction(
+        ttyd::system::keyGetDir, GetInput<Field::kDir>);
+    g_Getter_trampolines[Field::kDirTrg] = patch::hookFunction(
+        ttyd::system::keyGetDirTrg, GetInput<Field::kDirTrg>);
+    g_Getter_trampolines[Field::kDirRep] = patch::hookFunction(
+        ttyd::system::keyGetDirRep, GetInput<Field::kDirRep>);
+    g_Getter_trampolines[Field::kStickX] = patch::hookFunction(
+        ttyd::system::keyGetStickX, GetInput<Field::kStickX>);
+    g_Getter_trampolines[Field::kStickY] = patch::hookFunction(
+        ttyd::system::keyGetStickY, GetInput<Field::kStickY>);
+    g_Getter_trampolines[Field::kSubStickY] = patch::hookFunction(
+        ttyd::system::keyGetSubStickY, GetInput<Field::kSubStickY>);
+    g_makeKey_trampoline = patch::hookFunction(
+        ttyd::system::makeKey, OnMakeKey);
+    g_irand_trampoline = patch::hookFunction(
+        ttyd::system::irand, FixedSeedIrand);
+    return true;
+}
+
+}
+
+void Init() {
+    g_Log.magic = 0x50494e50;
+    g_Log.version = 2;
+    g_Log.card_data_offset = kCardDataOffset;
+    g_Log.irand_seed = kIrandSeed;
+    g_CardRequest.name = kCardFileName;
+    g_CardRequest.on_done = OnCardRequestDone;
+    RegisterOverlay(&kWarningOverlay);
+}
+
+void Update() {
+    if (!g_Data || !g_CardStreaming || g_CardRequest.pending) return;
+    if (g_Log.mode == Mode::kArmedReplay || g_Log.mode == Mode::kReplaying) {
+        StreamIn();
+    } else {
+        // Including what's left after recording stopped (e.g. on overflow).
+        StreamOut();
+    }
+}
+
+bool ToggleRecording() {
+    switch (g_Log.mode) {
+        case Mode::kRecording:
+            StopRecording();
+            return false;
+        case Mode::kIdle:
+            // Not while the last recording is still being written out.
+            if (IsCardBusy() || !InstallHooks()) return false;
+            g_Log.mode = Mode::kArmedRecording;
+            return true;
+        default:
+            g_Log.mode = Mode::kIdle;
+            return false;
+    }
+}
+
+bool ArmReplay() {
+    if (g_Log.mode == Mode::kRecording || IsCardBusy() || !InstallHooks()) {
+        return false;
+    }
+    // Replay from RAM if the whole recording is still there; otherwise from
+    // the copy on the memory card (e.g. after a restart), once its header
+    // has been read (and the runs are read in the background from then on).
+    const bool in_ram = g_Log.num_frames &&
+        g_Log.data_size <= kLogBytes && g_LoadedEnd == g_Log.data_size;
+    if (in_ram) {
+        g_Log.mode = Mode::kArmedReplay;
+        return true;
+    }
+    g_Log.mode = Mode::kLoadingReplay;
+    SubmitCardRequest(
+        CardOp::kReadHeader, &g_CardHeader, sizeof(g_CardHeader), 0);
+    return true;
+}
+
+void OnNewFile() {
+    RandomizerState& state = g_Randomizer->state_;
+    auto* mario_st = ttyd::mariost::g_MarioSt;
+    if (g_Log.mode == Mode::kArmedRecording) {
+        g_Log.data_size = 0;
+        g_Log.num_frames = 0;
+        g_Log.overflowed = 0;
+        g_Log.options = state.options_;
+        g_Log.hp_multiplier = state.hp_multiplier_;
+        g_Log.atk_multiplier = state.atk_multiplier_;
+        strncpy(g_Log.filename, mario_st->saveFileName, sizeof(g_Log.filename));
+        g_Log.mode = Mode::kRecording;
+        // Create the card file (with room for a whole run) in the
+        // background, so the recording can be streamed out to it; until
+        // then, it's kept to what fits in RAM.
+        g_FlushedSize = 0;
+        g_LoadedEnd = 0;
+        g_CardStreaming = false;
+        SubmitHeaderWrite(CardOp::kCreate);
+    } else if (g_Log.mode == Mode::kArmedReplay) {
+        // Start from the same file name (and so seed) and options.
+        strncpy(
+            const_cast<char*>(mario_st->saveFileName), g_Log.filename,
+            sizeof(g_Log.filename));
+        state.options_ = g_Log.options;
+        state.hp_multiplier_ = g_Log.hp_multiplier;
+        state.atk_multiplier_ = g_Log.atk_multiplier;
+        state.UpdateOptionsSnapshot();
+        state.SeedRng(g_Log.filename);
+        state.Save();
+        g_ReadPos = 0;
+        g_Log.mode = Mode::kReplaying;
+    } else {
+        return;
+    }
+    memset(&g_Sample, 0, sizeof(Sample));
+    memset(&g_LastRunSample, 0, sizeof(Sample));
+    g_RunFrames = 0;
+    g_IrandState = kIrandSeed;
+}
+
+}
@@ -1,11 +1,17 @@
 #include "keyboard.h"
 
+#include <gc/OSTime.h>
 #include <gc/si.h>
 
 #include <cstring>
 
 namespace mod {
 
+Keyboard *Keyboard::sPollingKeyboard = nullptr;
+
+// Keeps the compiler from reordering queue accesses around index updates
+#define KEYBOARD_QUEUE_BARRIER() __asm__ volatile("" ::: "memory")
+
 Keyboard::Keyboard(int channel)
 {
 	setChannel(channel);
@@ -33,50 +39,96 @@ bool Keyboard::connect()
 		// No keyboard in that slot
 		return false;
 	}
-	
+
 	// Enable polling from device
+	gc::si::SISetCommand(mChannel, 0x00540000);
+	gc::si::SITransferCommands();
 	gc::si::SIEnablePolling(1 << (31 - mChannel));
-	
+
+	// Read keys on every controller poll if possible, rather than once a
+	// frame; only one keyboard can use the polling handler at a time
+	mDisconnectPending = false;
 	mConnected = true;
+	if (!sPollingKeyboard)
+	{
+		sPollingKeyboard = this;
+		mPollingHandlerRegistered = gc::si::SIRegisterPollingHandler(
+			reinterpret_cast<void *>(pollingHandler));
+		if (!mPollingHandlerRegistered)
+		{
+			sPollingKeyboard = nullptr;
+		}
+	}
 	return true;
 }
 
 void Keyboard::disconnect()
 {
+	// Stop the polling handler first, so it no longer touches the queue
+	if (mPollingHandlerRegistered)
+	{
+		gc::si::SIUnregisterPollingHandler(
+			reinterpret_cast<void *>(pollingHandler));
+		sPollingKeyboard = nullptr;
+		mPollingHandlerRegistered = false;
+	}
+
 	// Flush response
 	uint64_t message;
 	gc::si::SIGetResponse(mChannel, &message);
-	
+
 	// Disable polling
 	gc::si::SIDisablePolling(1 << (31 - mChannel));
 	mConnected = false;
+	mDisconnectPending = false;
+
+	// Forget any held keys and queued events
+	mPolledKeysCount = 0;
+	mKeysDownCount = 0;
+	mEventRead = mEventWrite;
 }
 
-void Keyboard::update()
+void Keyboard::pollingHandler(int16_t interrupt, void *context)
 {
-	if (!mConnected && !connect())
+	Keyboard *keyboard = sPollingKeyboard;
+	if (keyboard && keyboard->mConnected && !keyboard->mDisconnectPending)
 	{
+		keyboard->poll();
+	}
+}
+
+void Keyboard::pushEvent(uint64_t time, KeyCode code, bool down)
+{
+	const uint32_t write = mEventWrite;
+	if (write - mEventRead >= cEventQueueSize)
+	{
+		++mDroppedEventCount;
 		return;
 	}
-	
-	// Poll next state
-	gc::si::SISetCommand(mChannel, 0x00540000);
-	gc::si::SITransferCommands();
-	
+	KeyEvent &event = mEventQueue[write & (cEventQueueSize - 1)];
+	event.time = time;
+	event.code = code;
+	event.down = down;
+	KEYBOARD_QUEUE_BARRIER();
+	mEventWrite = write + 1;
+}
+
+void Keyboard::poll()
+{
 	// Read data
 	uint64_t message;
 	if (!gc::si::SIGetResponse(mChannel, &message) || message & (1LL << 63))
 	{
-		// Failed to receive response or ERRSTAT is set
-		disconnect();
+		// Failed to receive response or ERRSTAT is set; disconnect from the
+		// frame update, rather than the interrupt
+		mDisconnectPending = true;
+		return;
 	}
-	
-	// Save last key state
-	mKeysPrevCount = mKeysDownCount;
-	memcpy(mKeysPrev, mKeysDown, sizeof(mKeysPrev));
-	
+	const uint64_t time = gc::OSTime::OSGetTime();
+
 	// Read new keys
-	mKeysDownCount = 0;
+	int keysCount = 0;
+	KeyCode keys[cMaxKeysPressed];
 	for (int i = 0; i < cMaxKeysPressed; ++i)
 	{
 		KeyCode code = static_cast<KeyCode>((message >> (i * 8 + 8)) & 0xFF);
@@ -86,44 +138,103 @@ void Keyboard::update()
 			continue;
 		}
 
-		mKeysDown[mKeysDownCount++] = code;
+		keys[keysCount++] = code;
 	}
-	
-	// Check released keys
-	mKeysReleasedCount = 0;
-	for (int i = 0; i < mKeysPrevCount; ++i)
+
+	// Queue released keys
+	for (int i = 0; i < mPolledKeysCount; ++i)
 	{
 		bool released = true;
-		for (int j = 0; j < mKeysDownCount; ++j)
+		for (int j = 0; j < keysCount; ++j)
 		{
-			if (mKeysPrev[i] == mKeysDown[j])
+			if (mPolledKeys[i] == keys[j])
 			{
 				released = false;
 			}
 		}
 		if (released)
 		{
-			mKeysReleased[mKeysReleasedCount++] = mKeysPrev[i];
+			pushEvent(time, mPolledKeys[i], false);
 		}
 	}
-	
-	// Check pressed keys
-	mKeysPressedCount = 0;
-	for (int i = 0; i < mKeysDownCount; ++i)
+
+	// Queue pressed keys
+	for (int i = 0; i < keysCount; ++i)
 	{
 		bool pressed = true;
-		for (int j = 0; j < mKeysPrevCount; ++j)
+		for (int j = 0; j < mPolledKeysCount; ++j)
 		{
-			if (mKeysDown[i] == mKeysPrev[j])
+			if (keys[i] == mPolledKeys[j])
 			{
 				pressed = false;
 			}
 		}
 		if (pressed)
 		{
-			mKeysPressed[mKeysPressedCount++] = mKeysDown[i];
+			pushEvent(time, keys[i], true);
+		}
+	}
+
+	mPolledKeysCount = keysCount;
+	memcpy(mPolledKeys, keys, sizeof(mPolledKeys));
+}
+
+void Keyboard::update()
+{
+	if (mDisconnectPending)
+	{
+		disconnect();
+	}
+	if (!mConnected && !connect())
+	{
+		return;
+	}
+
+	if (!mPollingHandlerRegistered)
+	{
+		// Poll next state
+		gc::si::SISetCommand(mChannel, 0x00540000);
+		gc::si::SITransferCommands();
+		poll();
+	}
+
+	// Drain the event queue, updating the key state snapshot as we go
+	mEventCount = 0;
+	mKeysPressedCount = 0;
+	mKeysReleasedCount = 0;
+	while (mEventRead != mEventWrite)
+	{
+		const uint32_t read = mEventRead;
+		const KeyEvent &event = mEventQueue[read & (cEventQueueSize - 1)];
+		mEvents[mEventCount++] = event;
+		if (event.down)
+		{
+			mKeysPressed[mKeysPressedCount++] = event.code;
+			if (mKeysDownCount < cMaxKeysPressed)
+			{
+				mKeysDown[mKeysDownCount++] = event.code;
+			}
 		}
+		else
+		{
+			mKeysReleased[mKeysReleasedCount++] = event.code;
+			for (int i = 0; i < mKeysDownCount; ++i)
+			{
+				if (mKeysDown[i] == event.code)
+				{
+					mKeysDown[i] = mKeysDown[--mKeysDownCount];
+					break;
+				}
+			}
+		}
+		KEYBOARD_QUEUE_BARRIER();
+		mEventRead = read + 1;
+	}
+
+	if (mDisconnectPending)
+	{
+		disconnect();
 	}
 }
 
-}
\ No newline at end of file
+}
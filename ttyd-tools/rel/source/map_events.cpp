@@ -0,0 +1,124 @@
+#include "map_events.h"
+
+#include "common_functions.h"
+#include "common_types.h"
+
+#include <ttyd/mariost.h>
+#include <ttyd/seqdrv.h>
+#include <ttyd/seq_mapchange.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::map_events {
+
+namespace {
+
+using ::ttyd::seqdrv::SeqIndex;
+
+// Maximum number of subscribers.
+constexpr const int32_t kMaxSubscribers = 8;
+
+void (*g_Subscribers[kMaxSubscribers])(const Event&);
+int32_t g_NumSubscribers = 0;
+
+MapId g_CurrentMap = kUnknownMap;
+MapId g_NextMap = kUnknownMap;
+ModuleId::e g_CurrentArea = ModuleId::INVALID_MODULE;
+ModuleId::e g_NextArea = ModuleId::INVALID_MODULE;
+bool g_InBattle = false;
+
+// Returns the area whose name is the first `length` characters of `name`.
+ModuleId::e InternAreaPrefix(const char* name, size_t length) {
+    for (int32_t id = 1; id < ModuleId::MAX_MODULE_ID; ++id) {
+        const char* area = ModuleNameFromId(static_cast<ModuleId::e>(id));
+        if (!strncmp(area, name, length) && area[length] == 0) {
+            return static_cast<ModuleId::e>(id);
+        }
+    }
+    return ModuleId::INVALID_MODULE;
+}
+
+void Publish(EventType::e type, MapId map) {
+    const Event event = {
+        type, ttyd::seqdrv::seqGetNextSeq(), map, g_CurrentArea
+    };
+    for (int32_t i = 0; i < g_NumSubscribers; ++i) {
+        g_Subscribers[i](event);
+    }
+}
+
+}
+
+void Subscribe(void (*callback)(const Event& event)) {
+    if (g_NumSubscribers >= kMaxSubscribers) return;
+    g_Subscribers[g_NumSubscribers++] = callback;
+}
+
+ModuleId::e InternArea(const char* name) {
+    return InternAreaPrefix(name, strlen(name));
+}
+
+MapId InternMap(const char* name) {
+    if (!strcmp(name, "title")) return kTitleMap;
+    // Map names are the area's name, an underscore and a 2-digit number.
+    const char* separator = strchr(name, '_');
+    if (!separator) return kUnknownMap;
+    const ModuleId::e area = InternAreaPrefix(name, separator - name);
+    const char* digits = separator + 1;
+    if (area == ModuleId::INVALID_MODULE ||
+        digits[0] < '0' || digits[0] > '9' ||
+        digits[1] < '0' || digits[1] > '9' || digits[2] != 0) {
+        return kUnknownMap;
+    }
+    return MakeMapId(area, (digits[0] - '0') * 10 + digits[1] - '0');
+}
+
+void OnSeqChanged(SeqIndex seq, const char* map_name) {
+    // Only these sequences take a map name (others use it as a parameter).
+    if (seq == SeqIndex::kGame || seq == SeqIndex::kMapChange) {
+        g_NextMap = map_name ? InternMap(map_name) : kUnknownMap;
+    }
+    Publish(EventType::kSeqChanged, g_NextMap);
+    if (seq == SeqIndex::kBattle && !g_InBattle) {
+        g_InBattle = true;
+        Publish(EventType::kBattleStart, g_CurrentMap);
+    } else if (seq != SeqIndex::kBattle && g_InBattle) {
+        g_InBattle = false;
+        Publish(EventType::kBattleEnd, g_CurrentMap);
+    }
+}
+
+void OnMapLoading() {
+    g_NextMap = InternMap(ttyd::seq_mapchange::NextMap);
+    g_NextArea = InternArea(ttyd::seq_mapchange::NextArea);
+}
+
+void OnMapLoaded() {
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    g_CurrentMap = InternMap(mario_st->currentMapName);
+    g_CurrentArea = InternArea(mario_st->currentAreaName);
+    Publish(EventType::kMapLoaded, g_CurrentMap);
+}
+
+void OnMapUnloading() {
+    Publish(EventType::kMapUnloading, g_CurrentMap);
+}
+
+MapId GetCurrentMapId() {
+    return g_CurrentMap;
+}
+
+ModuleId::e GetCurrentAreaId() {
+    return g_CurrentArea;
+}
+
+MapId GetNextMapId() {
+    return g_NextMap;
+}
+
+ModuleId::e GetNextAreaId() {
+    return g_NextArea;
+}
+
+}
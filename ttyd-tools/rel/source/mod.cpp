@@ -1,6 +1,14 @@
 #include "mod.h"
 
+#include "card_file.h"
+#include "common_ui.h"
+#include "evt_profiler.h"
+#include "flight_recorder.h"
+#include "heap_tracker.h"
+#include "input_replay.h"
 #include "patch.h"
+#include "perf_hud.h"
+#include "run_telemetry.h"
 
 #include <ttyd/system.h>
 #include <ttyd/mariost.h>
@@ -11,6 +19,7 @@
 #include <ttyd/mario.h>
 
 #include <gc/os.h>
+#include <gc/OSTime.h>
 
 #include <cstdio>
 #include <cstring>
@@ -50,16 +59,49 @@ void Mod::init()
 
 	// Run mod-specific initialization logic.
 	randomizer_mod_.Init();
+	
+	// Instrument the evt interpreter (only in profiling builds).
+	evt_profiler::Init();
+	
+	// Start recording recent events, to inspect after a crash.
+	flight_recorder::Init();
+	
+	// Track heap usage per map, warning on screen if running low.
+	heap_tracker::Init();
+	
+	// Record per-floor stats (load / battle times, damage, etc.).
+	run_telemetry::Init();
+	
+	// Set up input recording / replay (off until armed by a secret code).
+	input_replay::Init();
+	
+	// Register the performance HUD (hidden until toggled on).
+	perf_hud::Init();
 }
 
 void Mod::updateEarly()
 {
-    // Run mod-specific game logic and drawing code.
+    // Run mod-specific game logic, then queue up any visible overlays.
 	randomizer_mod_.Update();
-    randomizer_mod_.Draw();
+	evt_profiler::Update();
+	heap_tracker::Update();
+	// Stream the input log to / from the memory card, and advance any queued
+	// memory card reads / writes.
+	input_replay::Update();
+	card_file::Update();
+	DrawOverlays();
 
-	// Call original function.
+	// Call original function, timing it for the flight recorder (and the
+	// performance HUD, if shown).
+	const uint64_t start_time = gc::OSTime::OSGetTime();
 	marioStMain_trampoline_();
+	const uint32_t ticks =
+		static_cast<uint32_t>(gc::OSTime::OSGetTime() - start_time);
+	flight_recorder::RecordFrame(ticks);
+	if (perf_hud::IsEnabled())
+	{
+		perf_hud::RecordFrame(ticks);
+	}
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "perf_hud.h"
+
+#include "common_functions.h"
+#include "common_types.h"
+#include "common_ui.h"
+#include "patch.h"
+
+#include <gc/OSLink.h>
+#include <gc/os.h>
+#include <ttyd/dispdrv.h>
+#include <ttyd/evtmgr.h>
+#include <ttyd/mariost.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+namespace mod::perf_hud {
+
+namespace {
+
+using ::gc::OSLink::OSModuleInfo;
+using ::gc::os::ChunkInfo;
+using ::gc::os::HeapInfo;
+using ::ttyd::dispdrv::CameraId;
+using ::ttyd::dispdrv::PFN_dispCallback;
+using ::ttyd::evtmgr::EvtWork;
+
+// Number of frames to compute frame-time percentiles over (~3 seconds).
+constexpr const int32_t kHistoryFrames = 180;
+// Number of frames between refreshes of the displayed text.
+constexpr const int32_t kRefreshFrames = 15;
+// Maximum number of OS heaps shown.
+constexpr const int32_t kMaxHeaps = 8;
+// OSTime ticks run at 40.5 MHz.
+constexpr const uint32_t kTicksPer2Usec = 81;
+
+// Trampoline for dispEntry, hooked to count display entries per frame.
+void (*g_dispEntry_trampoline)(
+    CameraId, uint8_t, float, PFN_dispCallback, void*) = nullptr;
+
+uint32_t g_FrameTicks[kHistoryFrames];
+int32_t g_NumFrames = 0;
+int32_t g_NextFrame = 0;
+int32_t g_FramesUntilRefresh = 0;
+uint32_t g_DispEntries = 0;
+uint32_t g_LastFrameDispEntries = 0;
+char g_HudText[640];
+bool g_Enabled = false;
+
+void CountDispEntry(
+    CameraId camera_id, uint8_t render_mode, float order,
+    PFN_dispCallback callback, void* user) {
+    ++g_DispEntries;
+    g_dispEntry_trampoline(camera_id, render_mode, order, callback, user);
+}
+
+// Prints a duration in OSTime ticks as milliseconds, to two decimal places.
+int32_t TicksToMsString(uint32_t ticks, char* out_buf) {
+    const uint32_t usec = ticks * 2 / kTicksPer2Usec;
+    return sprintf(
+        out_buf, "%" PRIu32 ".%02" PRIu32, usec / 1000, usec % 1000 / 10);
+}
+
+// Sums the free chunks in an OS heap, and finds the largest one.
+void GetHeapStats(const HeapInfo& heap, uint32_t* free, uint32_t* largest) {
+    *free = 0;
+    *largest = 0;
+    for (const ChunkInfo* chunk = heap.firstFree; chunk; chunk = chunk->next) {
+        *free += chunk->size;
+        if (chunk->size > *largest) *largest = chunk->size;
+    }
+}
+
+int32_t CountLiveEvts() {
+    const EvtWork* work = ttyd::evtmgr::evtGetWork();
+    int32_t count = 0;
+    for (int32_t i = 0; i < work->entryCount; ++i) {
+        if (work->entries[i].flags & 1) ++count;
+    }
+    return count;
+}
+
+int32_t ModuleToString(const OSModuleInfo* module, char* out_buf) {
+    if (!module) return sprintf(out_buf, "-");
+    const char* name = module->id < ModuleId::MAX_MODULE_ID
+        ? ModuleNameFromId(static_cast<ModuleId::e>(module->id)) : nullptr;
+    if (name) {
+        return sprintf(
+            out_buf, "%s @ %08" PRIx32,
+            name, reinterpret_cast<uint32_t>(module));
+    }
+    return sprintf(
+        out_buf, "#%" PRIu32 " @ %08" PRIx32,
+        module->id, reinterpret_cast<uint32_t>(module));
+}
+
+void BuildHudText() {
+    // Sort the frame time history to find its percentiles.
+    uint32_t sorted[kHistoryFrames];
+    const int32_t num_frames = g_NumFrames;
+    for (int32_t i = 0; i < num_frames; ++i) {
+        int32_t pos = i;
+        for (; pos > 0 && sorted[pos - 1] > g_FrameTicks[i]; --pos) {
+            sorted[pos] = sorted[pos - 1];
+        }
+        sorted[pos] = g_FrameTicks[i];
+    }
+    const int32_t last_frame =
+        (g_NextFrame + kHistoryFrames - 1) % kHistoryFrames;
+
+    char* ptr = g_HudText;
+    ptr += sprintf(ptr, "cpu ");
+    ptr += TicksToMsString(g_FrameTicks[last_frame], ptr);
+    ptr += sprintf(ptr, " ms\n50%% ");
+    ptr += TicksToMsString(sorted[(num_frames - 1) * 50 / 100], ptr);
+    ptr += sprintf(ptr, " 90%% ");
+    ptr += TicksToMsString(sorted[(num_frames - 1) * 90 / 100], ptr);
+    ptr += sprintf(ptr, " 99%% ");
+    ptr += TicksToMsString(sorted[(num_frames - 1) * 99 / 100], ptr);
+    ptr += sprintf(ptr, " max ");
+    ptr += TicksToMsString(sorted[num_frames - 1], ptr);
+    ptr += sprintf(ptr, "\n");
+
+    // Heap 0 is the main heap (used for operator new, among others).
+    for (int32_t i = 0; i < gc::os::OSAlloc_NumHeaps && i < kMaxHeaps; ++i) {
+        const HeapInfo& heap = gc::os::OSAlloc_HeapArray[i];
+        // Destroyed / never-created heaps have a negative size.
+        if (static_cast<int32_t>(heap.capacity) < 0) continue;
+        uint32_t free, largest;
+        GetHeapStats(heap, &free, &largest);
+        ptr += sprintf(
+            ptr, "heap %" PRId32 ": %" PRIu32 "K free, %" PRIu32 "K max\n",
+            i, free >> 10, largest >> 10);
+    }
+
+    ptr += sprintf(
+        ptr, "evt %" PRId32 "  disp %" PRIu32 "\nrel ",
+        CountLiveEvts(), g_LastFrameDispEntries);
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    ptr += ModuleToString(mario_st->pRelFileBase, ptr);
+    ptr += sprintf(ptr, "\nmap ");
+    ptr += ModuleToString(mario_st->pMapAlloc, ptr);
+}
+
+void DrawHud() {
+    DrawText(g_HudText, 260, 170, 0xFF, true, ~0U, 0.55f, /* top-right */ 2);
+}
+
+bool ShouldDrawHud() {
+    return g_Enabled && g_NumFrames > 0;
+}
+
+const Overlay kPerfHudOverlay = {
+    DrawHud, ShouldDrawHud, CameraId::kDebug3d, 2.f
+};
+
+}
+
+void Init() {
+    RegisterOverlay(&kPerfHudOverlay);
+}
+
+void ToggleDisplay() {
+    g_Enabled = !g_Enabled;
+    if (!g_Enabled) return;
+    if (!g_dispEntry_trampoline) {
+        g_dispEntry_trampoline = patch::hookFunction(
+            ttyd::dispdrv::dispEntry, CountDispEntry);
+    }
+    // Start a new frame time history.
+    g_NumFrames = 0;
+    g_NextFrame = 0;
+    g_FramesUntilRefresh = 0;
+    g_DispEntries = 0;
+}
+
+bool IsEnabled() {
+    return g_Enabled;
+}
+
+void RecordFrame(uint32_t ticks) {
+    g_FrameTicks[g_NextFrame] = ticks;
+    g_NextFrame = (g_NextFrame + 1) % kHistoryFrames;
+    if (g_NumFrames < kHistoryFrames) ++g_NumFrames;
+
+    g_LastFrameDispEntries = g_DispEntries;
+    g_DispEntries = 0;
+
+    if (--g_FramesUntilRefresh <= 0) {
+        g_FramesUntilRefresh = kRefreshFrames;
+        BuildHudText();
+    }
+}
+
+}
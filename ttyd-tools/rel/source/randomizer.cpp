@@ -3,9 +3,15 @@
 #include "common_functions.h"
 #include "common_types.h"
 #include "common_ui.h"
+#include "evt_profiler.h"
+#include "flight_recorder.h"
+#include "input_replay.h"
+#include "map_events.h"
 #include "patch.h"
+#include "perf_hud.h"
 #include "randomizer_data.h"
 #include "randomizer_patches.h"
+#include "randomizer_practice.h"
 #include "randomizer_state.h"
 
 #include <gc/OSLink.h>
@@ -50,6 +56,7 @@ using ::ttyd::seqdrv::SeqIndex;
 void (*g_stg0_00_init_trampoline)(void) = nullptr;
 void (*g_cardCopy2Main_trampoline)(int32_t) = nullptr;
 bool (*g_OSLink_trampoline)(OSModuleInfo*, void*) = nullptr;
+bool (*g_OSUnlink_trampoline)(OSModuleInfo*) = nullptr;
 const char* (*g_msgSearch_trampoline)(const char*) = nullptr;
 void (*g_seq_battleInit_trampoline)(void) = nullptr;
 void (*g_fbatBattleMode_trampoline)(void) = nullptr;
@@ -70,6 +77,15 @@ void DrawOptionsMenu() {
     g_Randomizer->menu_.Draw();
 }
 
+bool ShouldDrawTitleScreenInfo() {
+    if (!CheckSeq(ttyd::seqdrv::SeqIndex::kTitle)) return false;
+    const uint32_t curtain_state = *reinterpret_cast<uint32_t*>(
+        reinterpret_cast<uintptr_t>(ttyd::seq_title::seqTitleWorkPointer2)
+        + 0x8);
+    // Only draw if the curtain is not fully down.
+    return curtain_state >= 2 && curtain_state < 12;
+}
+
 void DrawTitleScreenInfo() {
     const char* kTitleInfo = 
         "PM:TTYD Infinite Pit v1.22 r38 by jdaster64\n"
@@ -80,14 +96,39 @@ void DrawTitleScreenInfo() {
 }
 
 uint32_t secretCode_RtaTimer = 0b0001'0001'1010'1111;
+uint32_t secretCode_EvtProfiler = 0b0001'0001'1011'1010;
+uint32_t secretCode_PracticeRestore = 0b0001'0001'0101'1111;
+uint32_t secretCode_PerfHud = 0b0001'0001'1111'1010;
+uint32_t secretCode_FlightRecorder = 0b0001'0001'1010'0101;
+uint32_t secretCode_InputRecord = 0b0001'0001'1001'0110;
+uint32_t secretCode_InputReplay = 0b0001'0001'1001'1001;
 bool g_DrawRtaTimer = false;
 void DrawRtaTimer() {
     // Print the current RTA timer and its position to the screen at all times.
     char buf[32];
     sprintf(buf, "%s", g_Randomizer->state_.GetCurrentTimeString());
     DrawText(buf, -260, -195, 0xFF, true, ~0U, 0.75f, /* center-left */ 3);
+    // Print the latest 10-floor split below it (cached between splits).
+    const char* split = g_Randomizer->state_.GetLastSplitString();
+    if (split[0]) {
+        DrawText(split, -260, -215, 0xFF, true, ~0U, 0.6f, /* center-left */ 3);
+    }
+}
+
+bool ShouldDrawRtaTimer() {
+    return InMainGameModes() && g_DrawRtaTimer;
 }
 
+const Overlay kTitleScreenInfoOverlay = {
+    DrawTitleScreenInfo, ShouldDrawTitleScreenInfo, CameraId::k2d, 0.f
+};
+const Overlay kOptionsMenuOverlay = {
+    DrawOptionsMenu, nullptr, CameraId::k2d, 1.f
+};
+const Overlay kRtaTimerOverlay = {
+    DrawRtaTimer, ShouldDrawRtaTimer, CameraId::kDebug3d, 0.f
+};
+
 }
     
 Randomizer::Randomizer() {}
@@ -101,6 +142,7 @@ void Randomizer::Init() {
         ttyd::event::stg0_00_init, []() {
             // Replaces existing logic, includes loading the randomizer state.
             OnFileLoad(/* new_file = */ true);
+            input_replay::OnNewFile();
         });
         
     g_cardCopy2Main_trampoline = patch::hookFunction(
@@ -117,10 +159,19 @@ void Randomizer::Init() {
         gc::OSLink::OSLink, [](OSModuleInfo* new_module, void* bss) {
             bool result = g_OSLink_trampoline(new_module, bss);
             if (new_module != nullptr && result) {
+                flight_recorder::RecordModuleLink(new_module, true);
                 OnModuleLoaded(new_module);
             }
             return result;
         });
+    
+    g_OSUnlink_trampoline = patch::hookFunction(
+        gc::OSLink::OSUnlink, [](OSModuleInfo* module) {
+            if (module != nullptr) {
+                flight_recorder::RecordModuleLink(module, false);
+            }
+            return g_OSUnlink_trampoline(module);
+        });
 
     g_seq_battleInit_trampoline = patch::hookFunction(
         ttyd::seq_battle::seq_battleInit, []() {
@@ -140,7 +191,6 @@ void Randomizer::Init() {
     g_seqSetSeq_trampoline = patch::hookFunction(
         ttyd::seqdrv::seqSetSeq, 
         [](SeqIndex seq, const char* mapName, const char* beroName) {
-            OnEnterExitBattle(/* is_start = */ seq == SeqIndex::kBattle);
             // Check for failed file load.
             if (g_CueGameOver) {
                 seq = SeqIndex::kGameOver;
@@ -148,14 +198,24 @@ void Randomizer::Init() {
                 beroName = 0;
                 g_CueGameOver = false;
             } else if (
-                seq == SeqIndex::kMapChange && !strcmp(mapName, "aaa_00") && 
+                seq == SeqIndex::kMapChange &&
+                map_events::InternMap(mapName) == map_events::kAaa00 &&
                 !strcmp(beroName, "prologue")) {
                 // If loading a new file, load the player into the pre-Pit room.
                 mapName = "tik_06";
                 beroName = "e_bero";
             }
             g_seqSetSeq_trampoline(seq, mapName, beroName);
+            map_events::OnSeqChanged(seq, mapName);
         });
+    
+    map_events::Subscribe([](const map_events::Event& event) {
+        if (event.type == map_events::EventType::kBattleStart) {
+            OnEnterExitBattle(/* is_start = */ true);
+        } else if (event.type == map_events::EventType::kBattleEnd) {
+            OnEnterExitBattle(/* is_start = */ false);
+        }
+    });
         
     g_msgSearch_trampoline = patch::hookFunction(
         ttyd::msgdrv::msgSearch, [](const char* msg_key) {
@@ -235,6 +295,12 @@ void Randomizer::Init() {
     
     // Initialize the menu.
     menu_.Init();
+    
+    // Register overlays for drawing the title screen info, options menu,
+    // and RTA timer (if enabled).
+    RegisterOverlay(&kTitleScreenInfoOverlay);
+    RegisterOverlay(&kOptionsMenuOverlay);
+    RegisterOverlay(&kRtaTimerOverlay);
 }
 
 void Randomizer::Update() {
@@ -255,27 +321,45 @@ void Randomizer::Update() {
         g_DrawRtaTimer = true;
         ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
     }
-}
-
-void Randomizer::Draw() {
-    // Draw title screen info.
-    if (CheckSeq(ttyd::seqdrv::SeqIndex::kTitle)) {
-        const uint32_t curtain_state = *reinterpret_cast<uint32_t*>(
-            reinterpret_cast<uintptr_t>(ttyd::seq_title::seqTitleWorkPointer2)
-            + 0x8);
-        if (curtain_state >= 2 && curtain_state < 12) {
-            // Curtain is not fully down.
-            RegisterDrawCallback(DrawTitleScreenInfo, CameraId::k2d);
+    if ((code_history & 0xFFFF) == secretCode_PracticeRestore) {
+        code_history = ~0U;
+        // Retry the current floor from the snapshot taken on entering it.
+        if (RestorePracticeSnapshot()) {
+            ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
         }
     }
-    
-    // Draw options menu.
-    RegisterDrawCallback(DrawOptionsMenu, CameraId::k2d);
-    
-    // Draw RTA timer overlay, if enabled.
-    if (InMainGameModes() && g_DrawRtaTimer) {
-        RegisterDrawCallback(DrawRtaTimer, CameraId::kDebug3d);
+    if ((code_history & 0xFFFF) == secretCode_PerfHud) {
+        code_history = ~0U;
+        perf_hud::ToggleDisplay();
+        ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
+    }
+    if ((code_history & 0xFFFF) == secretCode_FlightRecorder) {
+        code_history = ~0U;
+        // Freezes (or resumes) the flight recorder, to take a RAM dump.
+        flight_recorder::ToggleSnapshot();
+        ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
+    }
+    if ((code_history & 0xFFFF) == secretCode_InputRecord) {
+        code_history = ~0U;
+        // Record inputs from the next new file (or stop recording / replay).
+        if (input_replay::ToggleRecording()) {
+            ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
+        }
+    }
+    if ((code_history & 0xFFFF) == secretCode_InputReplay) {
+        code_history = ~0U;
+        // Replay the last recording from the next new file.
+        if (input_replay::ArmReplay()) {
+            ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
+        }
+    }
+#ifdef PIT_PROFILING
+    if ((code_history & 0xFFFF) == secretCode_EvtProfiler) {
+        code_history = ~0U;
+        evt_profiler::ToggleDisplay();
+        ttyd::sound::SoundEfxPlayEx(0x265, 0, 0x64, 0x40);
     }
+#endif
 }
 
 }
\ No newline at end of file
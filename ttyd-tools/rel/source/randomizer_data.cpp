@@ -2,22 +2,19 @@
 
 #include "common_functions.h"
 #include "common_types.h"
+#include "platform.h"
 #include "randomizer.h"
 #include "randomizer_state.h"
 
 #include <ttyd/battle.h>
 #include <ttyd/battle_actrecord.h>
 #include <ttyd/battle_database_common.h>
-#include <ttyd/battle_monosiri.h>
 #include <ttyd/battle_unit.h>
 #include <ttyd/item_data.h>
 #include <ttyd/mario_pouch.h>
-#include <ttyd/mariost.h>
-#include <ttyd/msgdrv.h>
 #include <ttyd/npcdrv.h>
 #include <ttyd/npc_data.h>
 #include <ttyd/npc_event.h>
-#include <ttyd/system.h>
 
 #include <cinttypes>
 #include <cstdio>
@@ -70,6 +67,25 @@ struct EnemyTypeInfo {
     PointDropData*  fp_drop_table;
 };
 
+// Special handling for particular enemies in kEnemyModuleInfo.
+namespace EnemySpawn_Flags {
+    enum e {
+        // Never chosen randomly (bosses, Amazy Dayzee).
+        kSpecial = 1,
+        // Only chosen randomly if the player has a damaging Star Power.
+        kNeedsDamagingSp = 2,
+        // Never placed directly after another Yux.
+        kYux = 4,
+        // Never hangs from the ceiling.
+        kNoCeiling = 8,
+        // Randomly flies, if not the front enemy.
+        kMayFly = 0x10,
+        // Has an overworld behavior, so can lead the party (only set in
+        // kSpawnSampling; derived from npc_ent_type_info_idx).
+        kCanLead = 0x20,
+    };
+}
+
 // All data required to construct a particular enemy NPC in a particular module.
 // In particular, contains the offset in the given module for an existing
 // BattleUnitSetup* to use as a reference for the constructed battle.
@@ -79,332 +95,113 @@ struct EnemyModuleInfo {
     int32_t             battle_unit_setup_offset;
     int16_t             npc_ent_type_info_idx;
     int16_t             enemy_type_stats_idx;
+    // If nonzero, the address of the BattleUnitKind to link the unit to.
+    uint32_t            unit_kind_address;
+    uint16_t            flags;
 };
 
-PointDropData* kHpTables[] = {
-    &battle_heart_drop_param_default, &battle_heart_drop_param_default2,
-    &battle_heart_drop_param_default3, &battle_heart_drop_param_default4,
-    &battle_heart_drop_param_default5
-};
-PointDropData* kFpTables[] = {
-    &battle_flower_drop_param_default, &battle_flower_drop_param_default2,
-    &battle_flower_drop_param_default3, &battle_flower_drop_param_default4,
-    &battle_flower_drop_param_default5
+// A fixed group of enemies (indices of kEnemyModuleInfo, -1 = none).
+struct PresetLoadout {
+    int16_t spawns[5];
+    // The loadout to use instead if the player has no damaging Star Power.
+    int16_t fallback_idx;
 };
+
 const float kEnemyPartyCenterX = 90.0f;
 const float kEnemyPartySepX = 40.0f;
 const float kEnemyPartySepZ = 10.0f;
 
-const NpcEntTypeInfo kNpcInfo[] = {
-    { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr },
-    { &kuriboo_init_event, &kuriboo_move_event, &enemy_common_dead_event, &kuriboo_find_event, &kuriboo_lost_event, &kuriboo_return_event, &enemy_common_blow_event },
-    { &patakuri_init_event, &patakuri_move_event, &enemy_common_dead_event, &patakuri_find_event, &patakuri_lost_event, &patakuri_return_event, &enemy_common_blow_event },
-    { &nokonoko_init_event, &nokonoko_move_event, &enemy_common_dead_event, &nokonoko_find_event, &nokonoko_lost_event, &nokonoko_return_event, &enemy_common_blow_event },
-    { &togenoko_init_event, &togenoko_move_event, &enemy_common_dead_event, &togenoko_find_event, &togenoko_lost_event, &togenoko_return_event, &enemy_common_blow_event },
-    { &patapata_init_event, &patapata_move_event, &enemy_common_dead_event, &patapata_find_event, &patapata_lost_event, &patapata_return_event, &enemy_common_blow_event },
-    { &met_init_event, &met_move_event, &enemy_common_dead_event, &met_find_event, &met_lost_event, &met_return_event, &enemy_common_blow_event },
-    { &patamet_init_event, &patamet_move_event, &enemy_common_dead_event, &patamet_find_event, &patamet_lost_event, &patamet_return_event, &enemy_common_blow_event },
-    { &chorobon_init_event, &chorobon_move_event, &enemy_common_dead_event, &chorobon_find_event, &chorobon_lost_event, &chorobon_return_event, &enemy_common_blow_event },
-    { &pansy_init_event, &pansy_move_event, &enemy_common_dead_event, &pansy_find_event, &pansy_lost_event, &pansy_return_event, &enemy_common_blow_event },
-    { &twinkling_pansy_init_event, &twinkling_pansy_move_event, &enemy_common_dead_event, &twinkling_pansy_find_event, &twinkling_pansy_lost_event, &twinkling_pansy_return_event, &enemy_common_blow_event },
-    { &karon_init_event, &karon_move_event, &enemy_common_dead_event, &karon_find_event, &karon_lost_event, &karon_return_event, &karon_blow_event },
-    { &honenoko2_init_event, &honenoko2_move_event, &enemy_common_dead_event, &honenoko2_find_event, &honenoko2_lost_event, &honenoko2_return_event, &enemy_common_blow_event },
-    { &killer_init_event, &killer_move_event, &killer_dead_event, nullptr, nullptr, nullptr, &enemy_common_blow_event },
-    { &killer_cannon_init_event, &killer_cannon_move_event, &enemy_common_dead_event, nullptr, nullptr, nullptr, &enemy_common_blow_event },
-    { &sambo_init_event, &sambo_move_event, &enemy_common_dead_event, &sambo_find_event, &sambo_lost_event, &sambo_return_event, &enemy_common_blow_event },
-    { &sinnosuke_init_event, &sinnosuke_move_event, &enemy_common_dead_event, &sinnosuke_find_event, &sinnosuke_lost_event, &sinnosuke_return_event, &enemy_common_blow_event },
-    { &sinemon_init_event, &sinemon_move_event, &enemy_common_dead_event, &sinemon_find_event, &sinemon_lost_event, &sinemon_return_event, &enemy_common_blow_event },
-    { &togedaruma_init_event, &togedaruma_move_event, &enemy_common_dead_event, &togedaruma_find_event, &togedaruma_lost_event, &togedaruma_return_event, &enemy_common_blow_event },
-    { &barriern_init_event, &barriern_move_event, &barriern_dead_event, &barriern_find_event, &barriern_lost_event, &barriern_return_event, &barriern_blow_event },
-    { &piders_init_event, &piders_move_event, &enemy_common_dead_event, &piders_find_event, nullptr, nullptr, &piders_blow_event },
-    { &pakkun_init_event, &pakkun_move_event, &enemy_common_dead_event, &pakkun_find_event, nullptr, &pakkun_return_event, &enemy_common_blow_event },
-    { &dokugassun_init_event, &dokugassun_move_event, &enemy_common_dead_event, &dokugassun_find_event, &dokugassun_lost_event, &dokugassun_return_event, &enemy_common_blow_event },
-    { &basabasa2_init_event, &basabasa2_move_event, &basabasa2_dead_event, &basabasa2_find_event, &basabasa2_lost_event, &basabasa2_return_event, &enemy_common_blow_event },
-    { &teresa_init_event, &teresa_move_event, &enemy_common_dead_event, &teresa_find_event, &teresa_lost_event, &teresa_return_event, &enemy_common_blow_event },
-    { &bubble_init_event, &bubble_move_event, &enemy_common_dead_event, &bubble_find_event, &bubble_lost_event, &bubble_return_event, &enemy_common_blow_event },
-    { &hbom_init_event, &hbom_move_event, &enemy_common_dead_event, &hbom_find_event, &hbom_lost_event, &hbom_return_event, &enemy_common_blow_event },
-    { &zakowiz_init_event, &zakowiz_move_event, &zakowiz_dead_event, &zakowiz_find_event, &zakowiz_lost_event, &zakowiz_return_event, &zakowiz_blow_event },
-    { &hannya_init_event, &hannya_move_event, &enemy_common_dead_event, &hannya_find_event, &hannya_lost_event, &hannya_return_event, &enemy_common_blow_event },
-    { &mahoon_init_event, &mahoon_move_event, &mahoon_dead_event, &mahoon_find_event, &mahoon_lost_event, &mahoon_return_event, &enemy_common_blow_event },
-    { &kamec_init_event, &kamec_move_event, &kamec_dead_event, &kamec_find_event, &kamec_lost_event, &kamec_return_event, &kamec_blow_event },
-    { &kamec2_init_event, &kamec2_move_event, &kamec2_dead_event, &kamec2_find_event, &kamec2_lost_event, &kamec2_return_event, &kamec2_blow_event },
-    { &hbross_init_event, &hbross_move_event, &hbross_dead_event, &hbross_find_event, &hbross_lost_event, &hbross_return_event, &hbross_blow_event },
-    { &wanwan_init_event, &wanwan_move_event, &enemy_common_dead_event, &wanwan_find_event, nullptr, nullptr, &enemy_common_blow_event },
-    { nullptr, nullptr, &enemy_common_dead_event, nullptr, nullptr, nullptr, nullptr },
-};
+#include "randomizer_enemy_tables.inc"
 
-const EnemyTypeInfo kEnemyInfo[] = {
-    { BattleUnitType::BONETAIL, 325, 200, 8, 2, 8, 0, 100, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::ATOMIC_BOO, 148, 100, 4, 0, 2, 2, 60, 2, kHpTables[2], kFpTables[2] },
-    { BattleUnitType::BANDIT, 274, 12, 6, 0, 2, 0, 4, 5, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::BIG_BANDIT, 129, 15, 6, 0, 2, 1, 5, 5, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::BADGE_BANDIT, 275, 18, 6, 0, 3, 2, 6, 5, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::BILL_BLASTER, 254, 10, 0, 3, 0, 0, 6, 9, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::BOMBSHELL_BILL_BLASTER, 256, 15, 0, 5, 0, 0, 10, 9, kHpTables[2], kFpTables[0] },
-    { BattleUnitType::BULLET_BILL, 255, 4, 7, 1, 4, 0, 0, 9, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::BOMBSHELL_BILL, 257, 6, 9, 2, 6, 0, 0, 9, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::BOB_OMB, 283, 10, 7, 2, 2, 0, 5, 9, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::BULKY_BOB_OMB, 304, 12, 4, 2, 2, 0, 5, 9, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::BOB_ULK, 305, 15, 5, 2, 4, 0, 7, 9, kHpTables[3], kFpTables[0] },
-    { BattleUnitType::DULL_BONES, 39, 7, 5, 1, 1, 1, 2, 4, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::RED_BONES, 36, 10, 7, 2, 3, 0, 5, 4, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::DRY_BONES, 196, 12, 7, 3, 5, 0, 7, 4, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::DARK_BONES, 197, 20, 7, 3, 4, 1, 10, 4, kHpTables[1], kFpTables[2] },
-    { BattleUnitType::BOO, 146, 13, 6, 0, 2, 1, 5, 2, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::DARK_BOO, 147, 17, 8, 0, 4, 1, 7, 2, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::BRISTLE, 258, 6, 6, 4, 1, 0, 4, -1, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::DARK_BRISTLE, 259, 9, 9, 4, 8, 0, 8, -1, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::HAMMER_BRO, 206, 16, 6, 2, 3, 1, 9, 3, kHpTables[2], kFpTables[1] },
-    { BattleUnitType::BOOMERANG_BRO, 294, 16, 4, 2, 2, 0, 9, 3, kHpTables[2], kFpTables[1] },
-    { BattleUnitType::FIRE_BRO, 293, 16, 4, 2, 1, 2, 9, 3, kHpTables[2], kFpTables[1] },
-    { BattleUnitType::LAVA_BUBBLE, 302, 10, 6, 0, 3, 1, 6, 2, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::EMBER, 159, 13, 6, 0, 3, 0, 6, 2, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::PHANTOM_EMBER, 303, 16, 6, 0, 3, 2, 8, 2, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::BUZZY_BEETLE, 225, 8, 6, 5, 3, 0, 4, 7, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::SPIKE_TOP, 226, 8, 6, 5, 3, 0, 6, 7, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::PARABUZZY, 228, 8, 6, 5, 3, 0, 5, 7, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::SPIKY_PARABUZZY, 227, 8, 6, 5, 3, 0, 7, 7, kHpTables[2], kFpTables[0] },
-    { BattleUnitType::RED_SPIKY_BUZZY, 230, 8, 6, 5, 3, 0, 6, 7, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::CHAIN_CHOMP, 301, 10, 8, 4, 6, 0, 6, -1, kHpTables[3], kFpTables[0] },
-    { BattleUnitType::RED_CHOMP, 306, 12, 10, 5, 5, 0, 8, -1, kHpTables[2], kFpTables[0] },
-    { BattleUnitType::CLEFT, 237, 8, 6, 5, 2, 0, 2, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::HYPER_CLEFT, 236, 10, 6, 5, 3, 0, 6, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::MOON_CLEFT, 235, 12, 8, 5, 5, 0, 6, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::HYPER_BALD_CLEFT, 288, 10, 6, 5, 3, 0, 5, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::DARK_CRAW, 308, 20, 9, 0, 6, 0, 8, -1, kHpTables[3], kFpTables[0] },
-    { BattleUnitType::CRAZEE_DAYZEE, 252, 14, 5, 0, 2, 0, 6, 6, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::AMAZY_DAYZEE, 253, 20, 20, 1, 20, 0, 80, 6, kHpTables[2], kFpTables[4] },
-    { BattleUnitType::FUZZY, 248, 11, 5, 0, 1, 0, 2, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::GREEN_FUZZY, 249, 13, 6, 0, 2, 1, 4, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::FLOWER_FUZZY, 250, 13, 6, 0, 2, 1, 6, -1, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::GOOMBA, 214, 10, 6, 0, 1, 0, 2, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SPIKY_GOOMBA, 215, 10, 6, 0, 1, 1, 3, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::PARAGOOMBA, 216, 10, 6, 0, 1, 0, 3, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::HYPER_GOOMBA, 217, 15, 6, 0, 3, -1, 5, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::HYPER_SPIKY_GOOMBA, 218, 15, 6, 0, 3, 0, 6, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::HYPER_PARAGOOMBA, 219, 15, 6, 0, 3, -1, 6, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::GLOOMBA, 220, 20, 6, 0, 2, 1, 5, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SPIKY_GLOOMBA, 221, 20, 6, 0, 2, 2, 6, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::PARAGLOOMBA, 222, 20, 6, 0, 2, 1, 6, 10, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::KOOPA_TROOPA, 242, 15, 7, 2, 2, 0, 4, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::PARATROOPA, 243, 15, 7, 2, 2, 0, 5, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::KP_KOOPA, 246, 15, 7, 2, 2, 0, 4, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::KP_PARATROOPA, 247, 15, 7, 2, 2, 0, 5, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SHADY_KOOPA, 282, 18, 7, 2, 3, 0, 6, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SHADY_PARATROOPA, 291, 18, 7, 2, 3, 0, 7, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::DARK_KOOPA, 244, 20, 8, 3, 3, 1, 6, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::DARK_PARATROOPA, 245, 20, 8, 3, 3, 1, 7, 8, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::KOOPATROL, 205, 15, 8, 3, 4, 0, 6, 8, kHpTables[3], kFpTables[0] },
-    { BattleUnitType::DARK_KOOPATROL, 307, 25, 10, 3, 5, 0, 10, 8, kHpTables[3], kFpTables[1] },
-    { BattleUnitType::LAKITU, 280, 13, 7, 0, 2, 0, 4, -1, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::DARK_LAKITU, 281, 19, 9, 0, 5, 0, 8, -1, kHpTables[2], kFpTables[0] },
-    { BattleUnitType::SPINY, 287, 8, 7, 4, 2, 1, 1, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SKY_BLUE_SPINY, -1, 10, 9, 4, 5, 1, 1, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::RED_MAGIKOOPA, 318, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::WHITE_MAGIKOOPA, 319, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::GREEN_MAGIKOOPA, 320, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::MAGIKOOPA, 321, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::X_NAUT, 271, 12, 7, 0, 3, 0, 4, 1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::X_NAUT_PHD, 273, 14, 8, 0, 4, 0, 8, 1, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::ELITE_X_NAUT, 272, 16, 9, 2, 5, 0, 8, 1, kHpTables[2], kFpTables[0] },
-    { BattleUnitType::PIDER, 266, 14, 6, 0, 2, 0, 5, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::ARANTULA, 267, 18, 6, 0, 5, 2, 8, -1, kHpTables[2], kFpTables[2] },
-    { BattleUnitType::PALE_PIRANHA, 261, 14, 7, 0, 2, 0, 5, 11, kHpTables[0], kFpTables[1] },
-    { BattleUnitType::PUTRID_PIRANHA, 262, 14, 6, 0, 2, 1, 5, 11, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::FROST_PIRANHA, 263, 16, 7, 0, 4, 1, 7, 11, kHpTables[0], kFpTables[2] },
-    { BattleUnitType::PIRANHA_PLANT, 260, 18, 8, 0, 7, 2, 9, 11, kHpTables[0], kFpTables[4] },
-    { BattleUnitType::POKEY, 233, 12, 7, 0, 3, 0, 4, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::POISON_POKEY, 234, 15, 7, 0, 3, 1, 6, -1, kHpTables[1], kFpTables[0] },
-    { BattleUnitType::DARK_PUFF, 286, 12, 7, 0, 2, 0, 3, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::RUFF_PUFF, 284, 14, 8, 0, 4, 0, 4, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::ICE_PUFF, 285, 16, 8, 0, 4, 0, 6, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::POISON_PUFF, 265, 18, 8, 0, 8, 0, 8, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SPINIA, 310, 13, 6, 0, 1, 0, 2, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SPANIA, 309, 13, 6, 0, 1, 0, 3, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SPUNIA, 311, 16, 7, 2, 6, 1, 6, -1, kHpTables[3], kFpTables[0] },
-    { BattleUnitType::SWOOPER, 239, 14, 7, 0, 3, 0, 5, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SWOOPULA, 240, 14, 6, 0, 4, 0, 5, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::SWAMPIRE, 241, 20, 8, 0, 6, 0, 8, -1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::WIZZERD, 295, 10, 8, 3, 7, -1, 7, -1, kHpTables[1], kFpTables[1] },
-    { BattleUnitType::DARK_WIZZERD, 296, 12, 8, 4, 5, 0, 8, -1, kHpTables[2], kFpTables[2] },
-    { BattleUnitType::ELITE_WIZZERD, 297, 14, 8, 5, 7, 1, 10, -1, kHpTables[3], kFpTables[3] },
-    { BattleUnitType::YUX, 268, 7, 5, 0, 2, 0, 6, 1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::Z_YUX, 269, 9, 6, 0, 4, 0, 8, 1, kHpTables[1], kFpTables[1] },
-    { BattleUnitType::X_YUX, 270, 11, 5, 2, 3, 0, 10, 1, kHpTables[2], kFpTables[2] },
-    { BattleUnitType::MINI_YUX, -1, 1, 0, 0, 0, 0, 0, 1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::MINI_Z_YUX, -1, 2, 0, 0, 0, 0, 0, 1, kHpTables[0], kFpTables[0] },
-    { BattleUnitType::MINI_X_YUX, -1, 1, 0, 0, 0, 0, 0, 1, kHpTables[0], kFpTables[0] },
-    // Copied stats for slight variants of enemies.
-    { BattleUnitType::RED_MAGIKOOPA_CLONE, 318, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::WHITE_MAGIKOOPA_CLONE, 319, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::GREEN_MAGIKOOPA_CLONE, 320, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::MAGIKOOPA_CLONE, 321, 15, 7, 0, 4, 0, 7, 3, kHpTables[0], kFpTables[3] },
-    { BattleUnitType::DARK_WIZZERD_CLONE, 296, 12, 8, 4, 5, 0, 8, -1, kHpTables[2], kFpTables[2] },
-    { BattleUnitType::ELITE_WIZZERD_CLONE, 297, 14, 8, 5, 7, 1, 10, -1, kHpTables[3], kFpTables[3] },
-    { BattleUnitType::GOOMBA_GLITZVILLE, 214, 10, 6, 0, 1, 0, 2, 10, kHpTables[0], kFpTables[0] },
-    { /* invalid enemy */ },
+// The fields of kEnemyModuleInfo (and its kEnemyInfo entries) read when
+// sampling enemies, packed into parallel arrays so the weight loops only
+// touch a few contiguous cache lines, rather than two records per candidate.
+struct SpawnSamplingInfo {
+    uint8_t module[kNumEnemySpawns];
+    int8_t  level_offset[kNumEnemySpawns];
+    uint8_t flags[kNumEnemySpawns];
 };
 
-const EnemyModuleInfo kEnemyModuleInfo[] = {
-    // Bosses / special enemies.
-    { BattleUnitType::BONETAIL, ModuleId::JON, 0x159d0, 34, 0 },
-    { BattleUnitType::ATOMIC_BOO, ModuleId::JIN, 0x1a6a8, 24, 1 },
-    { BattleUnitType::AMAZY_DAYZEE, ModuleId::JON, 0x1c7a0, -1, 39 },
-    // Pit-native enemies.
-    { BattleUnitType::GLOOMBA, ModuleId::JON, 0x15a20, 1, 49 },
-    { BattleUnitType::SPINIA, ModuleId::JON, 0x15b70, 28, 85 },
-    { BattleUnitType::SPANIA, ModuleId::JON, 0x15e10, 28, 86 },
-    { BattleUnitType::DULL_BONES, ModuleId::JON, 0x16050, 12, 12 },
-    { BattleUnitType::FUZZY, ModuleId::JON, 0x16260, 8, 40 },
-    { BattleUnitType::PARAGLOOMBA, ModuleId::JON, 0x16500, 2, 51 },
-    { BattleUnitType::CLEFT, ModuleId::JON, 0x166e0, 17, 33 },
-    { BattleUnitType::POKEY, ModuleId::JON, 0x16920, 15, 79 },
-    { BattleUnitType::DARK_PUFF, ModuleId::JON, 0x16b60, 22, 81 },
-    { BattleUnitType::PIDER, ModuleId::JON, 0x16d40, 20, 73 },
-    { BattleUnitType::SPIKY_GLOOMBA, ModuleId::JON, 0x16f80, 1, 50 },
-    { BattleUnitType::BANDIT, ModuleId::JON, 0x171f0, 1, 2 },
-    { BattleUnitType::LAKITU, ModuleId::JON, 0x17490, 25, 62 },
-    { BattleUnitType::BOB_OMB, ModuleId::JON, 0x176d0, 1, 9 },
-    { BattleUnitType::BOO, ModuleId::JON, 0x17940, 24, 16 },
-    { BattleUnitType::DARK_KOOPA, ModuleId::JON, 0x17bb0, 3, 58 },
-    { BattleUnitType::HYPER_CLEFT, ModuleId::JON, 0x17d90, 17, 34 },
-    { BattleUnitType::PARABUZZY, ModuleId::JON, 0x17fa0, 7, 28 },
-    { BattleUnitType::SHADY_KOOPA, ModuleId::JON, 0x181e0, 3, 56 },
-    { BattleUnitType::FLOWER_FUZZY, ModuleId::JON, 0x18420, 8, 42 },
-    { BattleUnitType::DARK_PARATROOPA, ModuleId::JON, 0x18660, 5, 59 },
-    { BattleUnitType::BULKY_BOB_OMB, ModuleId::JON, 0x188a0, 26, 10 },
-    { BattleUnitType::LAVA_BUBBLE, ModuleId::JON, 0x18ab0, 25, 23 },
-    { BattleUnitType::POISON_POKEY, ModuleId::JON, 0x18cf0, 15, 80 },
-    { BattleUnitType::SPIKY_PARABUZZY, ModuleId::JON, 0x18f30, 7, 29 },
-    { BattleUnitType::BADGE_BANDIT, ModuleId::JON, 0x19170, 1, 4 },
-    { BattleUnitType::ICE_PUFF, ModuleId::JON, 0x19380, 22, 83 },
-    { BattleUnitType::DARK_BOO, ModuleId::JON, 0x19590, 24, 17 },
-    { BattleUnitType::RED_CHOMP, ModuleId::JON, 0x197d0, 33, 32 },
-    { BattleUnitType::MOON_CLEFT, ModuleId::JON, 0x199e0, 17, 35 },
-    { BattleUnitType::DARK_LAKITU, ModuleId::JON, 0x19c20, 25, 63 },
-    { BattleUnitType::DRY_BONES, ModuleId::JON, 0x19e00, 11, 14 },
-    { BattleUnitType::DARK_WIZZERD, ModuleId::JON, 0x1a010, 29, 92 },
-    { BattleUnitType::FROST_PIRANHA, ModuleId::JON, 0x1a220, 21, 77 },
-    { BattleUnitType::DARK_CRAW, ModuleId::JON, 0x1a430, 1, 37 },
-    { BattleUnitType::WIZZERD, ModuleId::JON, 0x1a5e0, 29, 91 },
-    { BattleUnitType::DARK_KOOPATROL, ModuleId::JON, 0x1a7f0, 4, 61 },
-    { BattleUnitType::PHANTOM_EMBER, ModuleId::JON, 0x1aa00, 25, 25 },
-    { BattleUnitType::SWOOPULA, ModuleId::JON, 0x1acd0, 23, 89 },
-    { BattleUnitType::CHAIN_CHOMP, ModuleId::JON, 0x1af70, 33, 31 },
-    { BattleUnitType::SPUNIA, ModuleId::JON, 0x1b1b0, 28, 87 },
-    { BattleUnitType::DARK_BRISTLE, ModuleId::JON, 0x1b420, 18, 19 },
-    { BattleUnitType::ARANTULA, ModuleId::JON, 0x1b630, 20, 74 },
-    { BattleUnitType::PIRANHA_PLANT, ModuleId::JON, 0x1b870, 21, 78 },
-    { BattleUnitType::ELITE_WIZZERD, ModuleId::JON, 0x1bd80, 29, 93 },
-    { BattleUnitType::POISON_PUFF, ModuleId::JON, 0x1bff0, 22, 84 },
-    { BattleUnitType::BOB_ULK, ModuleId::JON, 0x1c290, 26, 11 },
-    { BattleUnitType::SWAMPIRE, ModuleId::JON, 0x1c500, 23, 90 },
-    // Non-Pit-native enemies.
-    { BattleUnitType::GOOMBA, ModuleId::GON, 0x16efc, 1, 43 },
-    { BattleUnitType::SPIKY_GOOMBA, ModuleId::GON, 0x16efc, 1, 44 },
-    { BattleUnitType::PARAGOOMBA, ModuleId::GON, 0x169dc, 2, 45 },
-    { BattleUnitType::KOOPA_TROOPA, ModuleId::GON, 0x16cbc, 3, 52 },
-    { BattleUnitType::PARATROOPA, ModuleId::GON, 0x1660c, 5, 53 },
-    { BattleUnitType::RED_BONES, ModuleId::GON, 0x166bc, 12, 13 },
-    { BattleUnitType::GOOMBA, ModuleId::GRA, 0x8690, 1, 43 },
-    { BattleUnitType::HYPER_GOOMBA, ModuleId::GRA, 0x8690, 1, 46 },
-    { BattleUnitType::HYPER_PARAGOOMBA, ModuleId::GRA, 0x8950, 2, 48 },
-    { BattleUnitType::HYPER_SPIKY_GOOMBA, ModuleId::GRA, 0x8c70, 1, 47 },
-    { BattleUnitType::CRAZEE_DAYZEE, ModuleId::GRA, 0x9090, 9, 38 },
-    { BattleUnitType::GOOMBA, ModuleId::TIK, 0x27030, 1, 43 },
-    { BattleUnitType::PARAGOOMBA, ModuleId::TIK, 0x27080, 2, 45 },
-    { BattleUnitType::SPIKY_GOOMBA, ModuleId::TIK, 0x270d0, 1, 44 },
-    { BattleUnitType::KOOPA_TROOPA, ModuleId::TIK, 0x26d60, 3, 52 },
-    { BattleUnitType::HAMMER_BRO, ModuleId::TIK, 0x27120, 32, 20 },
-    { BattleUnitType::MAGIKOOPA, ModuleId::TIK, 0x267d0, 31, 69 },
-    { BattleUnitType::KOOPATROL, ModuleId::TIK, 0x26d30, 4, 60 },
-    { BattleUnitType::GOOMBA, ModuleId::TOU2, 0x1eb40, 1, 43 },
-    { BattleUnitType::KP_KOOPA, ModuleId::TOU2, 0x1ec50, 3, 54 },
-    { BattleUnitType::KP_PARATROOPA, ModuleId::TOU2, 0x1ecb0, 5, 55 },
-    { BattleUnitType::SHADY_PARATROOPA, ModuleId::TOU2, 0x1f3e0, 5, 57 },
-    { BattleUnitType::HAMMER_BRO, ModuleId::TOU2, 0x1f610, 32, 20 },
-    { BattleUnitType::BOOMERANG_BRO, ModuleId::TOU2, 0x1f670, 1, 21 },
-    { BattleUnitType::FIRE_BRO, ModuleId::TOU2, 0x1f640, 1, 22 },
-    { BattleUnitType::RED_MAGIKOOPA, ModuleId::TOU2, 0x1f510, -1, 66 },
-    { BattleUnitType::WHITE_MAGIKOOPA, ModuleId::TOU2, 0x1f540, -1, 67 },
-    { BattleUnitType::GREEN_MAGIKOOPA, ModuleId::TOU2, 0x1f570, -1, 68 },
-    { BattleUnitType::GREEN_FUZZY, ModuleId::TOU2, 0x1f490, 8, 41 },
-    { BattleUnitType::PALE_PIRANHA, ModuleId::TOU2, 0x1ef10, 21, 75 },
-    { BattleUnitType::BIG_BANDIT, ModuleId::TOU2, 0x1f1b0, 1, 3 },
-    { BattleUnitType::SWOOPER, ModuleId::TOU2, 0x1f790, 23, 88 },
-    { BattleUnitType::BRISTLE, ModuleId::TOU2, 0x1f330, 18, 18 },
-    { BattleUnitType::X_NAUT, ModuleId::AJI, 0x44914, 1, 70 },
-    { BattleUnitType::ELITE_X_NAUT, ModuleId::AJI, 0x44894, 1, 72 },
-    { BattleUnitType::X_NAUT_PHD, ModuleId::AJI, 0x44aa4, 27, 71 },
-    { BattleUnitType::YUX, ModuleId::AJI, 0x44f44, 19, 94 },
-    { BattleUnitType::Z_YUX, ModuleId::AJI, 0x44b24, 19, 95 },
-    { BattleUnitType::X_YUX, ModuleId::AJI, 0x450d4, 19, 96 },
-    // Non-Pit-native enemies (only used for specific loadouts).
-    { BattleUnitType::GOOMBA, ModuleId::DOU, 0x163d8, 1, 43 },
-    { BattleUnitType::EMBER, ModuleId::DOU, 0x16488, 25, 24 },
-    { BattleUnitType::RED_BONES, ModuleId::LAS, 0x3c100, 12, 13 },
-    { BattleUnitType::DARK_BONES, ModuleId::LAS, 0x3c1a0, 11, 15 },
-    { BattleUnitType::BUZZY_BEETLE, ModuleId::JIN, 0x1b078, 6, 26 },
-    { BattleUnitType::SPIKE_TOP, ModuleId::JIN, 0x1b148, -1, 27 },
-    { BattleUnitType::SWOOPER, ModuleId::JIN, 0x1ab38, 23, 88 },
-    { BattleUnitType::GREEN_FUZZY, ModuleId::MUJ, 0x358b8, 8, 41 },
-    { BattleUnitType::PUTRID_PIRANHA, ModuleId::MUJ, 0x35ac8, 21, 76 },
-    { BattleUnitType::EMBER, ModuleId::MUJ, 0x35218, 25, 24 },
-    { BattleUnitType::GOOMBA, ModuleId::EKI, 0xff48, 1, 43 },
-    { BattleUnitType::RUFF_PUFF, ModuleId::EKI, 0xfff8, 22, 82 },
-};
+constexpr SpawnSamplingInfo BuildSpawnSamplingInfo() {
+    SpawnSamplingInfo info = {};
+    for (int32_t i = 0; i < kNumEnemySpawns; ++i) {
+        const EnemyModuleInfo& emi = kEnemyModuleInfo[i];
+        info.module[i] = emi.module;
+        info.level_offset[i] =
+            kEnemyInfo[emi.enemy_type_stats_idx].level_offset;
+        info.flags[i] = emi.flags;
+        if (emi.npc_ent_type_info_idx >= 0) {
+            info.flags[i] |= EnemySpawn_Flags::kCanLead;
+        }
+    }
+    return info;
+}
+
+constexpr const SpawnSamplingInfo kSpawnSampling = BuildSpawnSamplingInfo();
+static_assert(ModuleId::MAX_MODULE_ID <= 0x100);
 
-const int32_t kPresetLoadouts[][5] = {
-    { 6, 92, 34, 93, -1 },      // Bones
-    { 88, 85, 87, 86, 89 },     // Yuxes + X-Nauts
-    { 57, 58, 3, -1, -1 },      // Goomba, Hyper Goomba, Gloomba
-    { 70, 21, 18, -1, -1 },     // Koopas
-    { 58, 59, 60, -1, -1 },     // Hyper Goomba family
-    { 3, 8, 13, -1, -1 },       // Gloomba family
-    { 14, 81, 28, -1, -1 },     // Bandits
-    { 5, 4, 43, -1, -1 },       // Spanias
-    { 7, 79, 22, -1, -1 },      // Fuzzies
-    { 9, 19, 32, -1, -1 },      // Clefts
-    { 11, 101, 29, 48, -1 },    // Puffs
-    { 71, 72, 23, -1, -1 },     // Paratroopas
-    { 94, 95, 20, 27, -1 },     // Buzzy family
-    { 25, 91, 40, -1, -1 },     // Embers
-    { 38, 35, 47, -1, -1 },     // Wizzerds
-    { 98, 36, 46, -1, -1 },     // Piranhas
-    { 82, 41, 50, -1, -1 },     // Swoopers
-    { 73, 74, 75, -1, -1 },     // Hammer Bros.
-    { 10, 26, 10, 26, -1 },     // Pokeys
-    { 83, 44, 83, 44, -1 },     // Bristles
-    { 24, 49, 24, 49, -1 },     // Bob-ulks
-    { 17, 30, 17, 30, -1 },     // Boos
-    { 15, 33, 15, 33, -1 },     // Lakitus
-    { 12, 45, 12, 45, -1 },     // Arantulas
-    { 68, 39, 68, 39, -1 },     // Koopatrols
-    { 42, 31, 42, 31, -1 },     // Chain Chomps
-    { 68, 67, 66, -1, -1 },     // Koopatrol, Magikoopa, Hammer Bro
-    { 84, 85, 86, -1, -1 },     // X-Nauts
-    { 61, 2, 61, 2, 61 },       // Dayzees
+// Bitfields of whether each item is included in PickRandomItem's pools;
+// item X is enabled if kItemPool[X / 16 - offset / 16] & (1 << (X % 16)) != 0.
+constexpr const uint16_t kNormalItems[] = {
+    0xffff, 0xffff, 0x000f, 0x0006
+};
+constexpr const uint16_t kRecipeItems[] = {
+    0x2020, 0xffb8, 0x3edf, 0x97ef, 0x0bff
+};
+constexpr const uint16_t kStackableBadges[] = {
+    0x3fff, 0xffff, 0x0fff, 0xfff7, 0x018f, 0x0030, 0x0006
+};
+constexpr const uint16_t kStackableBadgesNoP[] = {
+    0x3fff, 0x5555, 0x0b55, 0xaad7, 0x0186, 0x0030, 0x0002
 };
+constexpr const int32_t kMaxItemPoolSize = sizeof(kStackableBadges) * 8;
 
-// Base weights per floor group (00s, 10s, ...) and level_offset (2, 3, ... 10).
-const int8_t kBaseWeights[11][9] = {
-    { 10, 10, 5, 3, 2, 0, 0, 0, 0 },
-    { 5, 10, 5, 5, 3, 0, 0, 0, 0 },
-    { 3, 5, 10, 7, 5, 1, 0, 0, 0 },
-    { 1, 1, 7, 10, 10, 3, 2, 0, 0 },
-    { 1, 1, 5, 10, 10, 5, 3, 0, 0 },
-    { 1, 1, 2, 5, 10, 10, 5, 1, 1 },
-    { 0, 0, 2, 3, 10, 10, 6, 4, 2 },
-    { 0, 0, 2, 3, 7, 10, 10, 5, 4 },
-    { 0, 0, 1, 3, 6, 8, 10, 10, 8 },
-    { 0, 0, 1, 2, 5, 7, 10, 10, 10 },
-    { 0, 0, 1, 2, 5, 7, 10, 10, 10 },
+// The items in each pool, expanded from the bitfields in ascending order,
+// so picking the n-th item is an index rather than a scan over the bits.
+struct ItemPoolList {
+    int16_t items[kMaxItemPoolSize];
+    int32_t size;
 };
-// The target sum of enemy level_offsets for each floor group.
-const int8_t kTargetLevelSums[11] = {
-    12, 15, 18, 22, 25, 28, 31, 34, 37, 40, 50
+
+template <int32_t N>
+constexpr ItemPoolList BuildItemPoolList(
+    const uint16_t (&bitfield)[N], int32_t offset) {
+    ItemPoolList list = {};
+    for (int32_t i = 0; i < N; ++i) {
+        for (int32_t bit = 0; bit < 16; ++bit) {
+            if (bitfield[i] & (1U << bit)) {
+                list.items[list.size++] = offset + i * 16 + bit;
+            }
+        }
+    }
+    return list;
+}
+
+// Indexed by ItemPool, followed by the stackable badges minus 'P' badges.
+constexpr const int32_t kBadgesNoPartnerPool = ItemPool::BADGE + 1;
+constexpr const ItemPoolList kItemPoolLists[] = {
+    BuildItemPoolList(kNormalItems, 0x80),
+    BuildItemPoolList(kRecipeItems, 0xa0),
+    BuildItemPoolList(kStackableBadges, 0xf0),
+    BuildItemPoolList(kStackableBadgesNoP, 0xf0),
 };
 
+const ItemPoolList& GetItemPoolList(ItemPool::e pool, bool force_no_partner) {
+    if (pool == ItemPool::BADGE) {
+        // Count available partners.
+        const PouchData& pouch = *platform::GetPouch();
+        int32_t num_partners = 0;
+        for (int32_t i = 0; i < 8; ++i) {
+            num_partners += pouch.party_data[i].flags & 1;
+        }
+        // Exclude 'P' badges if no partners unlocked yet.
+        if (!num_partners || force_no_partner) {
+            return kItemPoolLists[kBadgesNoPartnerPool];
+        }
+    }
+    return kItemPoolLists[pool];
+}
+
 // Global structures for holding constructed battle information.
 int32_t g_NumEnemies = 0;
 int32_t g_Enemies[5] = { -1, -1, -1, -1, -1 };
@@ -433,36 +230,48 @@ ModuleId::e SelectEnemies(int32_t floor) {
     // Special cases: Floor X00 (Bonetail), X49 (Atomic Boo).
     if (floor % 100 == 99) {
         g_NumEnemies = 1;
-        g_Enemies[0] = 0;
+        g_Enemies[0] = EnemySpawn::BONETAIL_JON;
         for (int32_t i = 1; i < 4; ++i) g_Enemies[i] = -1;
         return ModuleId::INVALID_MODULE;
     }
     if (floor % 100 == 48) {
         g_NumEnemies = 1;
-        g_Enemies[0] = 1;
+        g_Enemies[0] = EnemySpawn::ATOMIC_BOO_JIN;
         for (int32_t i = 1; i < 4; ++i) g_Enemies[i] = -1;
         return ModuleId::JIN;
     }
     // If a reward floor, no enemies to spawn.
-    if (floor % 10 == 9) return ModuleId::INVALID_MODULE;
+    if (floor % 10 == 9) {
+        g_NumEnemies = 0;
+        return ModuleId::INVALID_MODULE;
+    }
     
-    const auto& pouch = *ttyd::mario_pouch::pouchGetPtr();
+    const auto& pouch = *platform::GetPouch();
     auto& state = g_Randomizer->state_;
+    const bool has_damaging_sp = pouch.star_powers_obtained & 0x92;
+    // With keyed streams, picks the same enemies however often it's called.
+    state.RestartStream(RandomizerState::RNG_SELECT_ENEMIES);
     
     // If floor > 50, determine whether to use one of the preset loadouts.
-    if (floor >= 50 && state.Rand(100) < 15) {
-        int32_t idx = state.Rand(sizeof(kPresetLoadouts) / (sizeof(int32_t)*5));
-        // If the Bones or Yux variants loadout selected and player doesn't have
-        // a damaging Star Power, use the Goomba / Koopa variants loadout.
-        if (idx < 2 && !(pouch.star_powers_obtained & 0x92)) idx += 2;
+    if (floor >= 50 &&
+        state.Rand(100, RandomizerState::RNG_SELECT_ENEMIES) < 15) {
+        int32_t idx = state.Rand(
+            sizeof(kPresetLoadouts) / sizeof(PresetLoadout),
+            RandomizerState::RNG_SELECT_ENEMIES);
+        // If the loadout has Bones or Yux variants and the player doesn't have
+        // a damaging Star Power, use its fallback (e.g. Goomba variants).
+        if (kPresetLoadouts[idx].fallback_idx >= 0 && !has_damaging_sp) {
+            idx = kPresetLoadouts[idx].fallback_idx;
+        }
         
         for (int32_t enemy = 0; enemy < 5; ++enemy) {
-            g_Enemies[enemy] = kPresetLoadouts[idx][enemy];
+            g_Enemies[enemy] = kPresetLoadouts[idx].spawns[enemy];
         }
         // If only 3 enemies, occasionally mirror it across the center.
         if (g_Enemies[3] == -1) {
             // The higher the floor number, the more likely the 5-enemy version.
-            if (static_cast<int32_t>(state.Rand(200)) < floor) {
+            if (static_cast<int32_t>(state.Rand(
+                    200, RandomizerState::RNG_SELECT_ENEMIES)) < floor) {
                 g_Enemies[3] = g_Enemies[1];
                 g_Enemies[4] = g_Enemies[0];
             }
@@ -473,7 +282,8 @@ ModuleId::e SelectEnemies(int32_t floor) {
         if (floor < 30) {
             secondary_area = ModuleId::GON;
         } else {
-            int32_t rn = state.Rand(floor < 50 ? 90 : 120);
+            int32_t rn = state.Rand(
+                floor < 50 ? 90 : 120, RandomizerState::RNG_SELECT_ENEMIES);
             if (rn < 40) {
                 secondary_area = ModuleId::TOU2;
             } else if (rn < 70) {
@@ -487,61 +297,57 @@ ModuleId::e SelectEnemies(int32_t floor) {
         
         // Put together an array of weights, scaled by the floor number and
         // enemy's level offset (such that harder enemies appear more later on).
-        constexpr const int32_t kNumEnemyTypes = 
-            sizeof(kEnemyModuleInfo) / sizeof(EnemyModuleInfo);
-        int16_t weights[6][kNumEnemyTypes];
-        for (int32_t i = 0; i < kNumEnemyTypes; ++i) {
+        const int32_t floor_group =
+            floor < 110 ? floor / 10 : kNumFloorGroups - 1;
+        // Disable Yuxes and Dry Bones variants (other than Dull Bones)
+        // if the player doesn't have a damaging Star Power, to reduce
+        // the chance of a seed becoming essentially unwinnable.
+        const uint32_t excluded_flags =
+            has_damaging_sp ? 0 : EnemySpawn_Flags::kNeedsDamagingSp;
+        const int8_t* base_weights = kSpawnBaseWeights[floor_group];
+        int16_t weights[6][kNumEnemySpawns];
+        for (int32_t i = 0; i < kNumEnemySpawns; ++i) {
             int32_t base_wt = 0;
-            const EnemyModuleInfo& emi = kEnemyModuleInfo[i];
-            const EnemyTypeInfo& ei = kEnemyInfo[emi.enemy_type_stats_idx];
+            const uint32_t module = kSpawnSampling.module[i];
+            const uint32_t flags = kSpawnSampling.flags[i];
             
-            // If enemy is not in a loaded area, or is a special enemy, ignore.
-            if (i >= 3 && ei.level_offset >= 2 && ei.level_offset <= 10 &&
-                (emi.module == ModuleId::JON || emi.module == secondary_area)) {
-                int32_t floor_group = floor < 110 ? floor / 10 : 10;
-                base_wt = kBaseWeights[floor_group][ei.level_offset - 2];
+            // If enemy is not in a loaded area, ignore.
+            if (module == ModuleId::JON || module == secondary_area) {
+                base_wt = base_weights[i];
                 // Double the base weight if the enemy is from secondary area.
-                if (emi.module == secondary_area && floor >= 30) base_wt <<= 1;
-            }
-            
-            // Disable Yuxes and Dry Bones variants (other than Dull Bones)
-            // if the player doesn't have a damaging Star Power, to reduce
-            // the chance of a seed becoming essentially unwinnable.
-            if (!(pouch.star_powers_obtained & 0x92)) {
-                if (i == 34 || i == 56 || i == 92 || i == 93 ||
-                    i == 87 || i == 88 || i == 89) {
-                    base_wt = 0;
-                }
+                if (module == secondary_area && floor >= 30) base_wt <<= 1;
             }
+            if (flags & excluded_flags) base_wt = 0;
             
             // The 6th slot is used for reference as an unchanging base weight.
             for (int32_t slot = 0; slot < 6; ++slot) weights[slot][i] = base_wt;
             // Disable selecting enemies with no overworld behavior for slot 0.
-            if (emi.npc_ent_type_info_idx == -1) weights[0][i] = 0;
+            if (!(flags & EnemySpawn_Flags::kCanLead)) weights[0][i] = 0;
         }
         
         // Pick enemies in weighted fashion, with preference towards repeats.
         int32_t level_sum = 0;
-        const int32_t target_sum =
-            floor < 100 ? kTargetLevelSums[floor / 10] : kTargetLevelSums[10];
+        const int32_t target_sum = kTargetLevelSums[floor_group];
         for (int32_t slot = 0; slot < 5; ++slot) {
             int32_t sum_weights = 0;
-            for (int32_t i = 0; i < kNumEnemyTypes; ++i) 
+            for (int32_t i = 0; i < kNumEnemySpawns; ++i) 
                 sum_weights += weights[slot][i];
             
-            int32_t weight = state.Rand(sum_weights);
+            int32_t weight = state.Rand(
+                sum_weights, RandomizerState::RNG_SELECT_ENEMIES);
             int32_t idx = 0;
             for (; (weight -= weights[slot][idx]) >= 0; ++idx);
             
             g_Enemies[slot] = idx;
-            const EnemyModuleInfo& emi = kEnemyModuleInfo[idx];
-            level_sum += kEnemyInfo[emi.enemy_type_stats_idx].level_offset;
+            level_sum += kSpawnSampling.level_offset[idx];
             
             // If level_sum is sufficiently high for the floor and not on the
             // fifth enemy, decide whether to add any further enemies.
             if (level_sum >= target_sum / 2 && slot < 4) {
                 const int32_t end_chance = level_sum * 100 / target_sum;
-                if (static_cast<int32_t>(state.Rand(100)) < end_chance) {
+                if (static_cast<int32_t>(state.Rand(
+                        100, RandomizerState::RNG_SELECT_ENEMIES)) <
+                    end_chance) {
                     for (++slot; slot < 5; ++slot) g_Enemies[slot] = -1;
                     break;
                 }
@@ -554,21 +360,27 @@ ModuleId::e SelectEnemies(int32_t floor) {
             }
             // If the enemy is any Yux, set the next weight for all Yuxes to 0,
             // since they appear too crowded if placed 40 units apart.
-            if (idx >= 87 && idx <= 89 && slot != 4) {
-                weights[slot + 1][87] = 0;
-                weights[slot + 1][88] = 0;
-                weights[slot + 1][89] = 0;
+            if ((kSpawnSampling.flags[idx] & EnemySpawn_Flags::kYux) &&
+                slot != 4) {
+                for (int32_t i = 0; i < kNumEnemySpawns; ++i) {
+                    if (kSpawnSampling.flags[i] & EnemySpawn_Flags::kYux) {
+                        weights[slot + 1][i] = 0;
+                    }
+                }
             }
         }
         
         // If floor > 80, rarely insert an Amazy Dayzee in the loadout.
-        if (floor >= 80 && state.Rand(100) < 5) {
+        if (floor >= 80 &&
+            state.Rand(100, RandomizerState::RNG_SELECT_ENEMIES) < 5) {
             int32_t idx = 1;
             for (; idx < 5; ++idx) {
                 if (g_Enemies[idx] == -1) break;
             }
             if (idx > 1) {
-                g_Enemies[state.Rand(idx - 1) + 1] = 2;
+                g_Enemies[state.Rand(
+                    idx - 1, RandomizerState::RNG_SELECT_ENEMIES) + 1] =
+                        EnemySpawn::AMAZY_DAYZEE_JON;
             }
         }
     }
@@ -579,14 +391,19 @@ ModuleId::e SelectEnemies(int32_t floor) {
     }
     // Find out which secondary module needs to be loaded, if any.
     for (int32_t i = 0; i < g_NumEnemies; ++i) {
-        const EnemyModuleInfo* emi = kEnemyModuleInfo + g_Enemies[i];
-        if (emi->module != ModuleId::JON) {
-            return emi->module;
+        const uint32_t module = kSpawnSampling.module[g_Enemies[i]];
+        if (module != ModuleId::JON) {
+            return static_cast<ModuleId::e>(module);
         }
     }
     return ModuleId::INVALID_MODULE;
 }
 
+const int32_t* GetSelectedEnemies(int32_t* out_count) {
+    *out_count = g_NumEnemies;
+    return g_Enemies;
+}
+
 void BuildBattle(
     uintptr_t pit_module_ptr, int32_t floor,
     NpcTribeDescription** out_npc_tribe_description,
@@ -603,7 +420,7 @@ void BuildBattle(
         enemy_info[i] = kEnemyInfo + enemy_module_info[i]->enemy_type_stats_idx;
         if (enemy_module_info[i]->module != ModuleId::JON) {
             module_ptr = reinterpret_cast<uintptr_t>(
-                ttyd::mariost::g_MarioSt->pMapAlloc);
+                platform::GetMarioSt()->pMapAlloc);
         }
         if (i == 0) {
             npc_info = kNpcInfo + enemy_module_info[i]->npc_ent_type_info_idx;
@@ -646,6 +463,7 @@ void BuildBattle(
     if (floor % 100 == 99) return;
     
     auto& state = g_Randomizer->state_;
+    state.RestartStream(RandomizerState::RNG_BUILD_BATTLE);
     
     for (int32_t i = 0; i < 12; ++i) g_CustomAudienceWeights[i] = 2;
     // Make Toads slightly likelier since they're never boosted.
@@ -654,23 +472,22 @@ void BuildBattle(
         BattleUnitSetup& custom_unit = g_CustomUnits[i];
         memcpy(&custom_unit, unit_info[i], sizeof(BattleUnitSetup));
         
-        // Special case: Goombas in modules GON and GRA need to be linked to
-        // their correct unit_kind, since they weren't actually used in battles.
-        int32_t etype = g_Enemies[i];
-        if (etype == 51) {
+        // Special case: some enemies (e.g. Goombas in modules GON and GRA)
+        // need to be linked to their correct unit_kind, since they weren't
+        // actually used in battles.
+        const EnemyModuleInfo& emi = *enemy_module_info[i];
+        if (emi.unit_kind_address) {
             custom_unit.unit_kind_params =
-                reinterpret_cast<BattleUnitKind*>(0x805ba9a0 + 0x1dcd8);
-        } else if (etype == 57) {
-            custom_unit.unit_kind_params =
-                reinterpret_cast<BattleUnitKind*>(0x805ba9a0 + 0xa0e8);
+                reinterpret_cast<BattleUnitKind*>(emi.unit_kind_address);
         }
         
         // Make Swoopers never hang from ceiling, and Magikoopas sometimes fly,
         // but only if they're not the front enemy in the lineup.
-        if (etype == 82 || etype == 96 || etype == 41 || etype == 50) {
+        if (emi.flags & EnemySpawn_Flags::kNoCeiling) {
             custom_unit.unit_work[0] = 1;
-        } else if (etype == 76 || etype == 77 || etype == 78 || etype == 67) {
-            custom_unit.unit_work[0] = state.Rand(i > 0 ? 2 : 1);
+        } else if (emi.flags & EnemySpawn_Flags::kMayFly) {
+            custom_unit.unit_work[0] = state.Rand(
+                i > 0 ? 2 : 1, RandomizerState::RNG_BUILD_BATTLE);
         }
         
         // Position the enemies in standard spacing.
@@ -692,7 +509,8 @@ void BuildBattle(
     g_CustomBattleParty.fp_drop_table       = enemy_info[0]->fp_drop_table;
     
     // Actually used as the index of the enemy whose item should be dropped.
-    g_CustomBattleParty.held_item_weight = state.Rand(g_NumEnemies);
+    g_CustomBattleParty.held_item_weight =
+        state.Rand(g_NumEnemies, RandomizerState::RNG_BUILD_BATTLE);
     
     // Make the current floor's battle point to the constructed party setup.
     int8_t* enemy_100 =
@@ -733,12 +551,12 @@ bool GetEnemyStats(
     const EnemyTypeInfo* ei = LookupEnemyTypeInfo(unit_type);
     if (!ei) return false;
     
-    int32_t floor_group = g_Randomizer->state_.floor_ / 10;
+    const RandomizerState& state = g_Randomizer->state_;
+    const OptionsSnapshot& options = state.options_snapshot_;
+    int32_t floor_group = state.floor_ / 10;
     
-    int32_t hp_scale = g_Randomizer->state_.GetOptionValue(
-        RandomizerState::POST_100_HP_SCALING) ? 10 : 5;
-    int32_t atk_scale = g_Randomizer->state_.GetOptionValue(
-        RandomizerState::POST_100_ATK_SCALING) ? 10 : 5;
+    int32_t hp_scale = options.post_100_hp_scaling ? 10 : 5;
+    int32_t atk_scale = options.post_100_atk_scaling ? 10 : 5;
         
     int32_t base_hp_pct = 
         floor_group > 9 ?
@@ -752,13 +570,13 @@ bool GetEnemyStats(
             
     if (out_hp) {
         int32_t hp = Min(ei->hp_scale * base_hp_pct, 1000000);
-        hp *= g_Randomizer->state_.hp_multiplier_;
+        hp *= options.hp_multiplier;
         *out_hp = Clamp((hp + 5000) / 10000, 1, 9999);
     }
     if (out_atk) {
         int32_t atk = Min(ei->atk_scale * base_atk_pct, 1000000);
         atk += (base_attack_power - ei->atk_base) * 100;
-        atk *= g_Randomizer->state_.atk_multiplier_;
+        atk *= options.atk_multiplier;
         *out_atk = Clamp((atk + 5000) / 10000, 1, 99);
     }
     if (out_def) {
@@ -772,7 +590,7 @@ bool GetEnemyStats(
         }
     }
     if (out_level) {
-        if (ttyd::mario_pouch::pouchGetPtr()->level >= 99) {
+        if (platform::GetPouch()->level >= 99) {
             *out_level = 0;
         } else if (ei->level_offset == 0) {
             // Enemies like Mini-Yuxes should never grant EXP.
@@ -785,7 +603,7 @@ bool GetEnemyStats(
                 int32_t level_offset = 
                     ei->level_offset + (g_Randomizer->state_.floor_ < 100 ? 5 : 2);
                 *out_level =
-                    ttyd::mario_pouch::pouchGetPtr()->level + level_offset;
+                    platform::GetPouch()->level + level_offset;
             } else {
                 // Bosses / special enemies get fixed bonus Star Points instead.
                 *out_level = -ei->level_offset / 2;
@@ -816,7 +634,7 @@ const char* SetCustomTattle(
     }
     // Take the first paragraph from the original tattle 
     // (ignore the first few characters in case there's a <p> there).
-    const char* original_tattle = ttyd::msgdrv::msgSearch(original_tattle_msg);
+    const char* original_tattle = platform::MsgSearch(original_tattle_msg);
     const char* p1_end_ptr = strstr(original_tattle + 4, "<p>");
     int32_t p1_len =
         p1_end_ptr ? p1_end_ptr - original_tattle : strlen(original_tattle);
@@ -824,7 +642,7 @@ const char* SetCustomTattle(
     
     // Append a paragraph with the enemy's base stats.
     char* p2_ptr = g_TattleTextBuf + p1_len;
-    char atk_offset_buf[8];
+    char atk_offset_buf[12];
     sprintf(atk_offset_buf, " (%+" PRId16 ")", ei->atk_offset);
     sprintf(p2_ptr,
             "<p>Its base stats are:\n"
@@ -852,7 +670,7 @@ const char* SetCustomTattle(
 
 const char* SetCustomMenuTattle(const char* original_tattle_msg) {
     const auto* kTattleInfo = 
-        ttyd::battle_monosiri::battleGetUnitMonosiriPtr(0);
+        platform::GetUnitMonosiriPtr(0);
         
     // Look for the enemy type with a matching message name.
     bool found_match = false;
@@ -869,7 +687,7 @@ const char* SetCustomMenuTattle(const char* original_tattle_msg) {
     // Print a simple base stat string to g_TattleTextBuf.
     const EnemyTypeInfo* ei = LookupEnemyTypeInfo(unit_type);
     if (ei) {
-        char atk_offset_buf[8];
+        char atk_offset_buf[12];
         sprintf(atk_offset_buf, " (%+" PRId16 ")", ei->atk_offset);
         sprintf(g_TattleTextBuf,
                 "Base HP: %" PRId16 ", Base ATK: %" PRId16 "%s,\n"
@@ -936,7 +754,8 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
     // If using held items + bonus conditions, only pick one every ~4 floors.
     const int32_t reward_mode =
         state.GetOptionValue(RandomizerState::BATTLE_REWARD_MODE);
-    if (reward_mode == 0 && state.Rand(4)) return;
+    if (reward_mode == 0 &&
+        state.Rand(4, RandomizerState::RNG_BATTLE_CONDITION)) return;
         
     const int32_t shine_rate =
         reward_mode == RandomizerState::NO_HELD_ITEMS ? 8 : 30;
@@ -954,7 +773,7 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
     BattleCondition conditions[kNumConditions];
     memcpy(conditions, kBattleConditions, sizeof(kBattleConditions));
     
-    const PouchData& pouch = *ttyd::mario_pouch::pouchGetPtr();
+    const PouchData& pouch = *platform::GetPouch();
     int32_t num_partners = 0;
     for (int32_t i = 0; i < 8; ++i) {
         num_partners += pouch.party_data[i].flags & 1;
@@ -993,7 +812,8 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
     for (int32_t i = 0; i < kNumConditions; ++i) 
         sum_weights += conditions[i].weight;
     
-    int32_t weight = state.Rand(sum_weights);
+    int32_t weight =
+        state.Rand(sum_weights, RandomizerState::RNG_BATTLE_CONDITION);
     int32_t idx = 0;
     for (; (weight -= conditions[idx].weight) >= 0; ++idx);
     
@@ -1002,7 +822,7 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
     if (conditions[idx].type == FP_MORE && state.floor_ < 30) {
         // v1.2: Special case; "Use FP" shouldn't appear too early in the Pit.
         // Replace it with something random that doesn't have any parameters.
-        switch (state.Rand(4)) {
+        switch (state.Rand(4, RandomizerState::RNG_BATTLE_CONDITION)) {
             case 0: idx = 0;    break;  // No jump
             case 1: idx = 2;    break;  // No hammer
             case 2: idx = 6;    break;  // No damage w/Mario
@@ -1011,7 +831,8 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
         param = conditions[idx].param_min;
     } else if (conditions[idx].param_max > 0) {
         param += state.Rand(conditions[idx].param_max - 
-                            conditions[idx].param_min + 1);
+                            conditions[idx].param_min + 1,
+                            RandomizerState::RNG_BATTLE_CONDITION);
     }
     switch (conditions[idx].type) {
         case TOTAL_DAMAGE_LESS:
@@ -1021,21 +842,21 @@ void SetBattleCondition(ttyd::npcdrv::NpcBattleInfo* npc_info, bool enable) {
             break;
         case MARIO_FINAL_HP_MORE:
             // Make it based on percentage of max HP.
-            param = state.Rand(4);
+            param = state.Rand(4, RandomizerState::RNG_BATTLE_CONDITION);
             switch (param) {
                 case 0:
                     // Half, rounded up.
-                    param = (ttyd::mario_pouch::pouchGetMaxHP() + 1) * 50 / 100;
+                    param = (platform::PouchGetMaxHp() + 1) * 50 / 100;
                     break;
                 case 1:
-                    param = ttyd::mario_pouch::pouchGetMaxHP() * 60 / 100;
+                    param = platform::PouchGetMaxHp() * 60 / 100;
                     break;
                 case 2:
-                    param = ttyd::mario_pouch::pouchGetMaxHP() * 80 / 100;
+                    param = platform::PouchGetMaxHp() * 80 / 100;
                     break;
                 case 3:
                 default:
-                    param = ttyd::mario_pouch::pouchGetMaxHP();
+                    param = platform::PouchGetMaxHp();
                     break;
             }
             break;
@@ -1070,7 +891,7 @@ void GetBattleConditionString(char* out_buf) {
     auto* fbat_info = ttyd::battle::g_BattleWork->fbat_info;
     const int32_t item_reward =
         fbat_info->wBattleInfo->pConfiguration->random_item_weight;
-    const char* item_name = ttyd::msgdrv::msgSearch(
+    const char* item_name = platform::MsgSearch(
         ttyd::item_data::itemDataTable[item_reward].name);
     
     // If held item drop is contingent on condition, don't say which will drop.
@@ -1085,87 +906,60 @@ void GetBattleConditionString(char* out_buf) {
 int32_t PickRandomItem(
     bool seeded, int32_t normal_item_weight, int32_t recipe_item_weight,
     int32_t badge_weight, int32_t no_item_weight, bool force_no_partner) {
-    // Bitfields of whether each item is included in the pool or not;
-    // item X is enabled if kItemPool[X / 16 - offset] & (1 << (X % 16)) != 0.
-    static constexpr const uint16_t kNormalItems[] = {
-        0xffff, 0xffff, 0x000f, 0x0006
-    };
-    static constexpr const uint16_t kRecipeItems[] = {
-        0x2020, 0xffb8, 0x3edf, 0x97ef, 0x0bff
-    };
-    static constexpr const uint16_t kStackableBadges[] = {
-        0x3fff, 0xffff, 0x0fff, 0xfff7, 0x018f, 0x0030, 0x0006
-    };
-    static constexpr const uint16_t kStackableBadgesNoP[] = {
-        0x3fff, 0x5555, 0x0b55, 0xaad7, 0x0186, 0x0030, 0x0002
-    };
-    
     int32_t total_weight =
         normal_item_weight + recipe_item_weight + badge_weight + no_item_weight;
     int32_t result; 
     if (seeded) {
-        result = g_Randomizer->state_.Rand(total_weight);
+        result = g_Randomizer->state_.Rand(
+            total_weight, RandomizerState::RNG_PICK_RANDOM_ITEM);
     } else {
-        result = ttyd::system::irand(total_weight);
+        result = platform::Rand(total_weight);
     }
-    const uint16_t* bitfield;
-    int32_t len_bitfield;
-    int32_t offset;
     
+    ItemPool::e pool;
     int32_t current_weight = normal_item_weight;
     if (result < current_weight) {
-        bitfield = kNormalItems;
-        len_bitfield = sizeof(kNormalItems) / sizeof(uint16_t);
-        offset = 0x80;
+        pool = ItemPool::NORMAL;
     } else {
         current_weight += recipe_item_weight;
         if (result < current_weight) {
-            bitfield = kRecipeItems;
-            len_bitfield = sizeof(kRecipeItems) / sizeof(uint16_t);
-            offset = 0xa0;
+            pool = ItemPool::RECIPE;
         } else {
             current_weight += badge_weight;
             if (result < current_weight) {
-                // Count available partners.
-                const PouchData& pouch = *ttyd::mario_pouch::pouchGetPtr();
-                int32_t num_partners = 0;
-                for (int32_t i = 0; i < 8; ++i) {
-                    num_partners += pouch.party_data[i].flags & 1;
-                }
-                // Exclude 'P' badges if no partners unlocked yet.
-                bitfield = (num_partners && !force_no_partner)
-                    ? kStackableBadges : kStackableBadgesNoP;
-                len_bitfield = sizeof(kStackableBadges) / sizeof(uint16_t);
-                offset = 0xf0;
+                pool = ItemPool::BADGE;
             } else {
                 return 0;
             }
         }
     }
     
-    int32_t num_items_seen = 0;
-    for (int32_t i = 0; i < len_bitfield; ++i) {
-        for (int32_t bit = 0; bit < 16; ++bit) {
-            if (bitfield[i] & (1U << bit)) ++num_items_seen;
-        }
-    }
+    const ItemPoolList& list = GetItemPoolList(pool, force_no_partner);
     if (seeded) {
-        result = g_Randomizer->state_.Rand(num_items_seen);
+        result = g_Randomizer->state_.Rand(
+            list.size, RandomizerState::RNG_PICK_RANDOM_ITEM);
     } else {
-        result = ttyd::system::irand(num_items_seen);
+        result = platform::Rand(list.size);
     }
-    num_items_seen = 0;
-    for (int32_t i = 0; i < len_bitfield; ++i) {
-        for (int32_t bit = 0; bit < 16; ++bit) {
-            if (bitfield[i] & (1U << bit)) {
-                if (result == num_items_seen) return offset + i * 16 + bit;
-                ++num_items_seen;
-            }
-        }
+    return list.items[result];
+}
+
+void PickUniqueRandomItems(
+    ItemPool::e pool, int32_t count, int32_t* out_items,
+    bool force_no_partner, RandomizerState::RngSource source) {
+    const ItemPoolList& list = GetItemPoolList(pool, force_no_partner);
+    if (count > list.size) count = list.size;
+    // Partial Fisher-Yates shuffle; after step i, items[0..i] are the picks.
+    int16_t items[kMaxItemPoolSize];
+    memcpy(items, list.items, sizeof(items));
+    for (int32_t i = 0; i < count; ++i) {
+        const int32_t j =
+            i + g_Randomizer->state_.Rand(list.size - i, source);
+        const int16_t item = items[j];
+        items[j] = items[i];
+        items[i] = item;
+        out_items[i] = item;
     }
-    // Should not be reached, as that would mean the random function returned
-    // a larger index than there are bits in the bitfield.
-    return -1;
 }
 
 int16_t PickChestReward() {
@@ -1191,7 +985,7 @@ int16_t PickChestReward() {
     for (int32_t i = 0; i < 32; ++i) weights[i] = 10;
     
     RandomizerState& state = g_Randomizer->state_;
-    const PouchData& pouch = *ttyd::mario_pouch::pouchGetPtr();
+    const PouchData& pouch = *platform::GetPouch();
     // Modify the chance of getting a partner based on the current floor
     // and the number of partners currently obtained.
     int32_t num_partners = 0;
@@ -1316,7 +1110,7 @@ int16_t PickChestReward() {
     int32_t sum_weights = 0;
     for (int32_t i = 0; i < 34; ++i) sum_weights += weights[i];
     
-    int32_t weight = state.Rand(sum_weights);
+    int32_t weight = state.Rand(sum_weights, RandomizerState::RNG_CHEST_REWARD);
     int32_t reward_idx = 0;
     for (; (weight -= weights[reward_idx]) >= 0; ++reward_idx);
     
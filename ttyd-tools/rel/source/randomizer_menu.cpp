@@ -3,6 +3,7 @@
 #include "common_functions.h"
 #include "common_types.h"
 #include "common_ui.h"
+#include "map_events.h"
 #include "randomizer.h"
 #include "randomizer_state.h"
 
@@ -17,8 +18,8 @@ namespace mod::pit_randomizer {
 
 namespace {
 
-// Pre-Pit room name.
-const char kStartRoomName[] = "tik_06";
+// Pre-Pit room.
+const map_events::MapId kStartRoom = map_events::kTik06;
 
 // Menu constants.
 const int32_t kMenuX                = -260;
@@ -50,13 +51,39 @@ int32_t menu_selection_ = 1;
 int32_t menu_page_ = 1;
 int32_t menu_state_ = 0;
 
+// Whether the current / next map is the Pre-Pit room; only re-checked when
+// the sequence or map changes.
+bool in_start_room_ = false;
+bool next_map_start_room_ = false;
+
+// Retained menu contents; only rebuilt when menu_dirty_ is set (by changing
+// the page, selection or an option's value, or by leaving the room).
+struct MenuRow {
+    char name[48];
+    char value[24];             // Longest is "+10% HP, +5% ATK" (16 chars).
+    uint32_t color;             // Text color, excluding alpha.
+    uint32_t special_color;     // Value's color, if not the default (or 0).
+};
+MenuRow menu_rows_[kOptionsPerPage];
+bool menu_dirty_ = true;
+
+void UpdateRoomChecks(const map_events::Event& event) {
+    if (event.type != map_events::EventType::kSeqChanged &&
+        event.type != map_events::EventType::kMapLoaded) {
+        return;
+    }
+    in_start_room_ =
+        InMainGameModes() && map_events::GetCurrentMapId() == kStartRoom;
+    next_map_start_room_ = map_events::GetNextMapId() == kStartRoom;
+}
+
 bool ShouldDisplayMenu() {
-    return InMainGameModes() && !strcmp(GetCurrentMap(), kStartRoomName) &&
+    return in_start_room_ &&
            !((ttyd::mariost::marioStGetSystemLevel() & 0xf) == 0xf);  // !paused
 }
 
 bool ShouldControlMenu() {
-    return ShouldDisplayMenu() && !strcmp(GetNextMap(), kStartRoomName);
+    return ShouldDisplayMenu() && next_map_start_room_;
 }
 
 bool ShouldTickOrAutotick(int32_t time_held) {
@@ -103,15 +130,40 @@ void DrawMenuString(
     DrawText(str, x, y, 0xffu, true, color, 0.75f, alignment);
 }
 
+void RebuildMenuRows() {
+    const RandomizerState& state = g_Randomizer->state_;
+    for (int32_t selection = 1; selection < kOptionsPerPage; ++selection) {
+        // Get text strings & color for options on the current page.
+        MenuRow& row = menu_rows_[selection - 1];
+        row.color = GetActiveColor(selection, 0);
+        int32_t menu_state = GetMenuState(menu_page_, selection);
+        state.GetOptionStrings(
+            menu_state, row.name, row.value, &row.special_color);
+    }
+    // Current page information for the bottom row.
+    MenuRow& row = menu_rows_[kOptionsPerPage - 1];
+    row.color = GetActiveColor(kOptionsPerPage, 0);
+    sprintf(
+        row.name, "Change Page (%" PRId32 "/%" PRId32 ")", 
+        menu_page_, kNumOptionPages);
+    row.value[0] = '\0';
+    row.special_color = 0;
+    menu_dirty_ = false;
+}
+
 }
 
 RandomizerMenu::RandomizerMenu() {}
 
-void RandomizerMenu::Init() {}
+void RandomizerMenu::Init() {
+    map_events::Subscribe(UpdateRoomChecks);
+}
 
 void RandomizerMenu::Update() {
     // Not in / leaving Pre-Pit room; prevent input and fade menu / text out.
     if (!ShouldControlMenu()) {
+        // Rebuild the menu next time it's shown, in case the file changed.
+        if (!ShouldDisplayMenu()) menu_dirty_ = true;
         last_command_ = 0;
         if (time_button_held_ < kFadeoutStartTime) {
             time_button_held_ = kFadeoutStartTime;
@@ -170,6 +222,7 @@ void RandomizerMenu::Update() {
                 } else {
                     --menu_selection_;
                 }
+                menu_dirty_ = true;
             }
             break;
         }
@@ -180,6 +233,7 @@ void RandomizerMenu::Update() {
                 } else {
                     ++menu_selection_;
                 }
+                menu_dirty_ = true;
             }
             break;
         }
@@ -195,6 +249,7 @@ void RandomizerMenu::Update() {
                 case RandomizerState::ATK_MODIFIER: {
                     if (ShouldTickOrAutotick(time_button_held_)) {
                         state.ChangeOption(menu_state_, direction);
+                        menu_dirty_ = true;
                     }
                     break;
                 }
@@ -203,12 +258,14 @@ void RandomizerMenu::Update() {
                         menu_page_ += direction ? direction : 1;
                         if (menu_page_ < 1) menu_page_ = kNumOptionPages;
                         if (menu_page_ > kNumOptionPages) menu_page_ = 1;
+                        menu_dirty_ = true;
                     }
                     break;
                 }
                 default: {
                     if (time_button_held_ == 0) {
                         state.ChangeOption(menu_state_, direction);
+                        menu_dirty_ = true;
                     }
                     break;
                 }
@@ -255,36 +312,27 @@ void RandomizerMenu::Draw() {
     const int32_t kValueX = kMenuX + kMenuWidth - kMenuPadding;
     int32_t kRowY = kMenuY - kMenuPadding - 8;
     
-    char name_buf[128];
-    char value_buf[16];
-    uint32_t color, special_color;
-    
-    const RandomizerState& state = g_Randomizer->state_;
+    if (menu_dirty_) RebuildMenuRows();
     
-    for (int32_t selection = 1; selection < kOptionsPerPage; ++selection) {
-        // Get text strings & color for options on the current page.
-        color = GetActiveColor(selection, alpha);
-        int32_t menu_state = GetMenuState(menu_page_, selection);
-        state.GetOptionStrings(menu_state, name_buf, value_buf, &special_color);
+    for (int32_t i = 0; i < kOptionsPerPage; ++i) {
         // Draw the row's description and current value.
-        DrawMenuString(name_buf, kTextX, kRowY, color, /* left-center */ 3);
-        if (special_color) color = special_color;
-        DrawMenuString(value_buf, kValueX, kRowY, color, /* right-center */ 5);
+        const MenuRow& row = menu_rows_[i];
+        const uint32_t color = row.color | alpha;
+        DrawMenuString(row.name, kTextX, kRowY, color, /* left-center */ 3);
+        if (row.value[0]) {
+            DrawMenuString(
+                row.value, kValueX, kRowY,
+                row.special_color ? row.special_color : color,
+                /* right-center */ 5);
+        }
         // Advance to the next row's Y position.
-        kRowY -= 19;
+        if (i < kOptionsPerPage - 1) kRowY -= 19;
     }
     
-    // Print the current page information in the bottom row.
-    color = GetActiveColor(kOptionsPerPage, alpha);
-    sprintf(
-        name_buf, "Change Page (%" PRId32 "/%" PRId32 ")", 
-        menu_page_, kNumOptionPages);
-    DrawMenuString(name_buf, kTextX, kRowY, color, /* left-center */ 3);
     // Print a warning over selections that change seeding.
     if (menu_page_ == 1 && menu_selection_ != kOptionsPerPage) {
-        sprintf(name_buf, "*Affects seeding");
         DrawText(
-            name_buf, kValueX, kRowY + 1, 0xffu, true, 
+            "*Affects seeding", kValueX, kRowY + 1, 0xffu, true, 
             /* color = red */ 0xff0000ffU, 0.575f, /* right-top */ 2);
     }
 }
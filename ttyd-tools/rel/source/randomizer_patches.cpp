@@ -4,10 +4,16 @@
 #include "common_types.h"
 #include "common_ui.h"
 #include "evt_cmd.h"
+#include "evt_profiler.h"
+#include "flight_recorder.h"
+#include "heap_tracker.h"
+#include "map_events.h"
 #include "patch.h"
 #include "randomizer.h"
 #include "randomizer_data.h"
+#include "randomizer_practice.h"
 #include "randomizer_strings.h"
+#include "run_telemetry.h"
 
 #include <gc/OSLink.h>
 #include <gc/mtx.h>
@@ -98,6 +104,8 @@ extern "C" {
     // crash_handler_patches.s
     void StartCrashHandlerScale();
     void BranchBackCrashHandlerScale();
+    void StartCrashHandlerLoop();
+    void BranchBackCrashHandlerLoop();
     // eff_updown_disp_patches.s
     void StartDispUpdownNumberIcons();
     void BranchBackDispUpdownNumberIcons();
@@ -155,13 +163,18 @@ extern "C" {
         return ttyd::memory::__memAlloc(heap, size);
     }
     
-    int32_t mapLoad() { return mod::pit_randomizer::LoadMap(); }
+    int32_t mapLoad() {
+        const int32_t result = mod::pit_randomizer::LoadMap();
+        mod::run_telemetry::OnMapLoadStep(/* done = */ result == 2);
+        return result;
+    }
     void onMapUnload() { mod::pit_randomizer::OnMapUnloaded(); }
     
     void scaleCrashHandlerText(gc::mtx34* mtx) {
         // Sufficiently small to fit on one screen.
         gc::mtx::PSMTXScale(mtx, 0.6, 0.72, 1.0);
     }
+    void onCrashHandlerLoop() { mod::flight_recorder::OnCrash(); }
     
     void getPartyMemberMenuOrder(ttyd::win_party::WinPartyData** party_data) {
         mod::pit_randomizer::GetPartyMemberMenuOrder(party_data);
@@ -185,21 +198,19 @@ extern "C" {
             number, tex_obj, icon_mtx, view_mtx, unk0);
     }
     bool checkOutsidePit() {
-        return strcmp("jon", mod::GetCurrentArea()) != 0;
+        return mod::map_events::GetCurrentAreaId() != mod::ModuleId::JON;
     }
     bool checkStarPowersEnabled() {
         return mod::pit_randomizer::g_Randomizer->state_.StarPowerEnabled();
     }
     int32_t getDangerStrength(int32_t num_badges) {
-        bool weaker_rush_badges =
-            mod::pit_randomizer::g_Randomizer->state_.GetOptionValue(
-                mod::pit_randomizer::RandomizerState::WEAKER_RUSH_BADGES);
+        bool weaker_rush_badges = mod::pit_randomizer::g_Randomizer->
+            state_.options_snapshot_.weaker_rush_badges;
         return num_badges * (weaker_rush_badges ? 1 : 2);
     }
     int32_t getPerilStrength(int32_t num_badges) {
-        bool weaker_rush_badges =
-            mod::pit_randomizer::g_Randomizer->state_.GetOptionValue(
-                mod::pit_randomizer::RandomizerState::WEAKER_RUSH_BADGES);
+        bool weaker_rush_badges = mod::pit_randomizer::g_Randomizer->
+            state_.options_snapshot_.weaker_rush_badges;
         return num_badges * (weaker_rush_badges ? 2 : 5);
     }
 }
@@ -285,6 +296,26 @@ const char*         kMoveBadgeAbbreviations[18] = {
 };
 constexpr const int32_t kNumCharlietonItemsPerType = 5;
 
+// Copies of enemies' stats, scaled for the current floor; built as enemy units
+// enter battle and cleared at the start of each battle.
+constexpr const int32_t kMaxShadowDefenses = 48;
+constexpr const int32_t kMaxShadowAttacks = 16;
+constexpr const int32_t kMaxShadowBaseAtk = 15;
+constexpr const int32_t kNumDefenseElements = 5;
+struct ShadowDefense {
+    const int8_t*   source;     // Vanilla defense table this is a copy of.
+    int32_t         kind;
+    int8_t          defense[8];
+};
+struct ShadowAttack {
+    int32_t         kind;
+    int8_t          atk[kMaxShadowBaseAtk + 1];     // Indexed by base ATK.
+};
+ShadowDefense       g_ShadowDefenses[kMaxShadowDefenses];
+int32_t             g_NumShadowDefenses = 0;
+ShadowAttack        g_ShadowAttacks[kMaxShadowAttacks];
+int32_t             g_NumShadowAttacks = 0;
+
 const char kPitNpcName[] = "\x93\x47";  // "enemy"
 const char kPiderName[] = "\x83\x70\x83\x43\x83\x5f\x81\x5b\x83\x58";
 const char kArantulaName[] = 
@@ -604,9 +635,106 @@ int32_t GetBonusCakeRestoration() {
     return ttyd::system::irand(6) * 5;
 }
 
+// Returns an enemy's attack power for an attack with the given vanilla power.
+int32_t GetScaledEnemyAtk(int32_t kind, int32_t base_atk) {
+    if (base_atk <= kMaxShadowBaseAtk) {
+        for (int32_t i = 0; i < g_NumShadowAttacks; ++i) {
+            if (g_ShadowAttacks[i].kind == kind) {
+                return g_ShadowAttacks[i].atk[base_atk];
+            }
+        }
+    }
+    int32_t altered_atk = base_atk;
+    GetEnemyStats(
+        kind, nullptr, &altered_atk, nullptr, nullptr, nullptr, base_atk);
+    if (altered_atk < 1) altered_atk = 1;
+    if (altered_atk > 99) altered_atk = 99;
+    return altered_atk;
+}
+
+// Caches the scaled attack power of every vanilla power up to the maximum.
+void BuildShadowAttack(int32_t kind) {
+    for (int32_t i = 0; i < g_NumShadowAttacks; ++i) {
+        if (g_ShadowAttacks[i].kind == kind) return;
+    }
+    if (g_NumShadowAttacks >= kMaxShadowAttacks) return;
+    ShadowAttack& shadow = g_ShadowAttacks[g_NumShadowAttacks];
+    shadow.atk[0] = 0;
+    for (int32_t base_atk = 1; base_atk <= kMaxShadowBaseAtk; ++base_atk) {
+        shadow.atk[base_atk] = GetScaledEnemyAtk(kind, base_atk);
+    }
+    // Only add the entry once filled in, so the lookups above skip it.
+    shadow.kind = kind;
+    ++g_NumShadowAttacks;
+}
+
+// Returns an enemy's DEF, scaled for the current floor.
+int32_t GetScaledEnemyDef(int32_t kind) {
+    int32_t altered_def = 0;
+    GetEnemyStats(kind, nullptr, nullptr, &altered_def, nullptr, nullptr);
+    return altered_def > 99 ? 99 : altered_def;
+}
+
+// Returns a copy of a defense table with an enemy's scaled DEF, or nullptr
+// if there is no room for any more copies this battle.
+int8_t* GetShadowDefense(const int8_t* source, int32_t kind) {
+    for (int32_t i = 0; i < g_NumShadowDefenses; ++i) {
+        if (g_ShadowDefenses[i].source == source &&
+            g_ShadowDefenses[i].kind == kind) {
+            return g_ShadowDefenses[i].defense;
+        }
+    }
+    if (g_NumShadowDefenses >= kMaxShadowDefenses) return nullptr;
+    const int32_t altered_def = GetScaledEnemyDef(kind);
+    
+    ShadowDefense& shadow = g_ShadowDefenses[g_NumShadowDefenses++];
+    shadow.source = source;
+    shadow.kind = kind;
+    for (int32_t i = 0; i < kNumDefenseElements; ++i) {
+        // Only nonzero DEF is replaced; negative and 99+ DEF are left alone.
+        int32_t def = source[i];
+        if (def > 0 && def < 99) def = altered_def;
+        shadow.defense[i] = def;
+    }
+    return shadow.defense;
+}
+
+// Returns the shadow table a defense table pointer points into, if any.
+ShadowDefense* FindShadowDefense(const int8_t* defense) {
+    const int32_t offset = reinterpret_cast<uintptr_t>(defense) -
+        reinterpret_cast<uintptr_t>(g_ShadowDefenses);
+    if (offset < 0 ||
+        offset >= g_NumShadowDefenses *
+            static_cast<int32_t>(sizeof(ShadowDefense))) {
+        return nullptr;
+    }
+    return &g_ShadowDefenses[offset / sizeof(ShadowDefense)];
+}
+
+// Points an enemy part at the shadow copy of its current defense table for
+// the unit's current kind (which may have changed since it was last set).
+// Returns false if the part was left on an unscaled table, for lack of room.
+bool UpdateShadowDefense(BattleWorkUnit* unit, BattleWorkUnitPart* part) {
+    const int8_t* source = part->defense;
+    if (!source) return true;
+    const ShadowDefense* current = FindShadowDefense(source);
+    if (current) {
+        if (current->kind == unit->current_kind) return true;
+        source = current->source;
+    }
+    int8_t* shadow = GetShadowDefense(source, unit->current_kind);
+    if (!shadow) return false;
+    part->defense = shadow;
+    return true;
+}
+
 }
 
 void OnFileLoad(bool new_file) {
+    flight_recorder::RecordHook(flight_recorder::HookId::kFileLoad, new_file);
+    run_telemetry::OnFileLoad(new_file);
+    // Practice snapshots only apply to the file they were taken on.
+    ClearPracticeSnapshot();
     if (new_file) {
         ttyd::mario_pouch::pouchInit();
         PouchData& pouch = *ttyd::mario_pouch::pouchGetPtr();
@@ -667,7 +795,8 @@ void OnFileLoad(bool new_file) {
         pouch.unallocated_bp = 3;
         ttyd::mario_pouch::pouchReviseMarioParam();
         // Assign Yoshi a random color.
-        ttyd::mario_pouch::pouchSetPartyColor(4, g_Randomizer->state_.Rand(7));
+        ttyd::mario_pouch::pouchSetPartyColor(
+            4, g_Randomizer->state_.Rand(7, RandomizerState::RNG_YOSHI_COLOR));
     }
     g_PromptSave = false;
 }
@@ -678,6 +807,9 @@ void OnModuleLoaded(OSModuleInfo* module) {
     uintptr_t module_ptr = reinterpret_cast<uintptr_t>(module);
     
     if (module_id == ModuleId::JON) {
+        // Snapshot the state on entering the floor, for practice retries.
+        SavePracticeSnapshot();
+        
         // Apply custom logic to box opening event to allow spawning partners.
         mod::patch::writePatch(
             reinterpret_cast<void*>(module_ptr + kPitEvtOpenBoxOffset),
@@ -918,6 +1050,10 @@ int32_t LoadMap() {
             auto* file = ttyd::filemgr::fileAllocf(
                 nullptr, "%s/rel/%s.rel", getMarioStDvdRoot(), area);
             if (file) {
+                heap_tracker::OnSecondaryModuleLoad(
+                    *file->mpFileData,
+                    reinterpret_cast<uint32_t>(file->mpFileData[1]),
+                    sizeof(g_AdditionalRelBss));
                 memcpy(
                     mario_st->pMapAlloc, *file->mpFileData,
                     reinterpret_cast<int32_t>(file->mpFileData[1]));
@@ -933,19 +1069,21 @@ int32_t LoadMap() {
         }
         return 1;
     }
-    if (!strcmp(ttyd::seq_mapchange::NextMap, "title")) {
+    map_events::OnMapLoading();
+    if (map_events::GetNextMapId() == map_events::kTitleMap) {
         strcpy(mario_st->unk_14c, mario_st->currentMapName);
         strcpy(mario_st->currentAreaName, "");
         strcpy(mario_st->currentMapName, "");
+        map_events::OnMapLoaded();
         ttyd::seqdrv::seqSetSeq(
             ttyd::seqdrv::SeqIndex::kTitle, nullptr, nullptr);
         return 1;
     }
     const char* area = ttyd::seq_mapchange::NextArea;
-    if (!strcmp(area, "tou")) {
+    if (map_events::GetNextAreaId() == ModuleId::TOU) {
         if (ttyd::seqdrv::seqGetSeq() == ttyd::seqdrv::SeqIndex::kTitle) {
             area = "tou2";
-        } else if (!strcmp(ttyd::seq_mapchange::NextMap, "tou_03")) {
+        } else if (map_events::GetNextMapId() == map_events::kTou03) {
             area = "tou2";
         }
     }
@@ -954,7 +1092,8 @@ int32_t LoadMap() {
         auto* file = ttyd::filemgr::fileAllocf(
             nullptr, "%s/rel/%s.rel", getMarioStDvdRoot(), area);
         if (file) {
-            if (!strncmp(area, "tst", 3) || !strncmp(area, "jon", 3)) {
+            if (map_events::GetNextAreaId() == ModuleId::JON ||
+                !strncmp(area, "tst", 3)) {
                 auto* module_info = reinterpret_cast<OSModuleInfo*>(
                     ttyd::memory::_mapAlloc(
                         reinterpret_cast<void*>(0x8041e808),
@@ -976,12 +1115,19 @@ int32_t LoadMap() {
         ttyd::seq_mapchange::_load(
             mario_st->currentMapName, ttyd::seq_mapchange::NextMap,
             ttyd::seq_mapchange::NextBero);
+        map_events::OnMapLoaded();
 
         // Determine the enemies to spawn on this floor, and load a second
         // relocatable module for support enemies if necessary.
         if (g_PitModulePtr) {
-            const char* area = 
-                ModuleNameFromId(SelectEnemies(g_Randomizer->state_.floor_));
+            const ModuleId::e module =
+                SelectEnemies(g_Randomizer->state_.floor_);
+            flight_recorder::RecordHook(
+                flight_recorder::HookId::kSelectEnemies, module);
+            int32_t num_enemies;
+            const int32_t* enemies = GetSelectedEnemies(&num_enemies);
+            run_telemetry::RecordEnemies(enemies, num_enemies);
+            const char* area = ModuleNameFromId(module);
             if (area) {
                 g_AdditionalModuleToLoad = area;
                 return 1;
@@ -996,6 +1142,7 @@ int32_t LoadMap() {
 }
 
 void OnMapUnloaded() {
+    map_events::OnMapUnloading();
     if (g_PitModulePtr) {
         UnlinkCustomEvt(
             ModuleId::JON, reinterpret_cast<void*>(g_PitModulePtr),
@@ -1034,6 +1181,10 @@ void CopyChildBattleInfo(bool to_child) {
 
 void OnEnterExitBattle(bool is_start) {
     if (is_start) {
+        // Scaled enemy stats from the last battle no longer apply.
+        g_NumShadowDefenses = 0;
+        g_NumShadowAttacks = 0;
+        
         int8_t badge_count;
         for (int32_t i = 0; i < 14; ++i) {
             badge_count = ttyd::mario_pouch::pouchEquipCheckBadge(
@@ -1054,6 +1205,8 @@ void OnEnterExitBattle(bool is_start) {
         g_InBattle = true;
     } else {
         g_InBattle = false;
+        // Commit the stats batched up over the battle.
+        g_Randomizer->state_.FlushPlayStats();
     }
 }
 
@@ -1473,50 +1626,57 @@ void AlterUnitKindParams(BattleUnitKind* unit) {
     unit->run_rate |= 1;
 }
 
+void ShadowEnemyUnitStats(BattleWorkUnit* unit) {
+    // If not an enemy, nothing to change.
+    if (unit->current_kind > BattleUnitType::BONETAIL) return;
+    BuildShadowAttack(unit->current_kind);
+    for (auto* part = unit->parts; part; part = part->next_part) {
+        UpdateShadowDefense(unit, part);
+    }
+}
+
 int32_t AlterDamageCalculation(
     BattleWorkUnit* attacker, BattleWorkUnit* target,
     BattleWorkUnitPart* target_part, BattleWeapon* weapon,
     uint32_t* unk0, uint32_t unk1) {
-    int32_t base_atk = weapon->damage_function_params[0];
-    int8_t* def_ptr  = target_part->defense;
-    int32_t base_def = def_ptr[weapon->element];
+    // Enemy parts already use scaled defense tables from when they entered
+    // battle; this only catches tables swapped in by scripts since then, or
+    // units that have changed kind.
+    int8_t* unscaled_def = nullptr;
+    int32_t base_def = 0;
+    if (target->current_kind <= BattleUnitType::BONETAIL &&
+        !UpdateShadowDefense(target, target_part)) {
+        // Out of shadow tables this battle; scale the shared table's DEF for
+        // just this calculation instead, and change it back afterward.
+        unscaled_def = target_part->defense + weapon->element;
+        base_def = *unscaled_def;
+        if (base_def > 0 && base_def < 99) {
+            *unscaled_def = GetScaledEnemyDef(target->current_kind);
+        }
+    }
     
-    int32_t altered_atk = base_atk, altered_def = base_def;
-    // Alter ATK power for enemy attacks.
+    // Alter ATK power for enemy attacks; this is done on a copy of the weapon,
+    // since weapons are referenced directly by enemies' scripts.
+    BattleWeapon scaled_weapon;
+    const int32_t base_atk = weapon->damage_function_params[0];
     if (attacker->current_kind <= BattleUnitType::BONETAIL
         && !(weapon->target_property_flags & 0x100000)  // not a recoil attack
         && !weapon->item_id && base_atk > 0) {
-        GetEnemyStats(
-            attacker->current_kind, nullptr, &altered_atk, nullptr, 
-            nullptr, nullptr, base_atk);
-        if (altered_atk < 1) altered_atk = 1;
-        if (altered_atk > 99) altered_atk = 99;
-        weapon->damage_function_params[0] = altered_atk;
-    }
-    // Alter DEF power for enemies on defense.
-    if (target->current_kind <= BattleUnitType::BONETAIL
-        && base_def >= 0 && base_def < 99) {
-        if (base_def > 0) {
-            GetEnemyStats(
-                target->current_kind, nullptr, nullptr, &altered_def, 
-                nullptr, nullptr);
-        }
-        if (altered_def > 99) altered_def = 99;
-        def_ptr[weapon->element] = altered_def;
+        memcpy(&scaled_weapon, weapon, sizeof(BattleWeapon));
+        scaled_weapon.damage_function_params[0] =
+            GetScaledEnemyAtk(attacker->current_kind, base_atk);
+        weapon = &scaled_weapon;
     }
     
     // Run vanilla damage calculation.
     int32_t damage = g_BattleCalculateDamage_trampoline(
         attacker, target, target_part, weapon, unk0, unk1);
+    if (unscaled_def) *unscaled_def = base_def;
         
     // Set Shell Shield max damage to 1 (essentially making its HP hit-based).
     if (damage > 0 && target->current_kind == BattleUnitType::SHELL_SHIELD) {
         damage = 1;
     }
-        
-    // Change ATK and DEF back, and return calculated damage.
-    weapon->damage_function_params[0] = base_atk;
-    def_ptr[weapon->element] = base_def;
     return damage;
 }
 
@@ -1524,26 +1684,20 @@ int32_t AlterFpDamageCalculation(
     BattleWorkUnit* attacker, BattleWorkUnit* target,
     BattleWorkUnitPart* target_part, BattleWeapon* weapon,
     uint32_t* unk0, uint32_t unk1) {
-    int32_t base_atk = weapon->fp_damage_function_params[0];
-    
-    int32_t altered_atk = base_atk;
-    // Alter FP damage for enemy attacks.
+    // Alter FP damage for enemy attacks (on a copy of the weapon, as above).
+    BattleWeapon scaled_weapon;
+    const int32_t base_atk = weapon->fp_damage_function_params[0];
     if (attacker->current_kind <= BattleUnitType::BONETAIL
         && !weapon->item_id && base_atk > 0) {
-        GetEnemyStats(
-            attacker->current_kind, nullptr, &altered_atk, nullptr,
-            nullptr, nullptr, base_atk);
-        if (altered_atk < 1) altered_atk = 1;
-        if (altered_atk > 99) altered_atk = 99;
-        weapon->fp_damage_function_params[0] = altered_atk;
+        memcpy(&scaled_weapon, weapon, sizeof(BattleWeapon));
+        scaled_weapon.fp_damage_function_params[0] =
+            GetScaledEnemyAtk(attacker->current_kind, base_atk);
+        weapon = &scaled_weapon;
     }
     
     // Run vanilla damage calculation.
-    int32_t damage = g_BattleCalculateFpDamage_trampoline(
+    return g_BattleCalculateFpDamage_trampoline(
         attacker, target, target_part, weapon, unk0, unk1);
-    // Change FP damage value back, and return calculated FP loss.
-    weapon->fp_damage_function_params[0] = base_atk;
-    return damage;
 }
 
 void GetDropMaterials(FbatBattleInformation* fbat_info) {
@@ -1767,36 +1921,64 @@ void DisplayStarPowerOrbs(double x, double y, int32_t star_power) {
 }
 
 void ReplaceCharlietonStock() {
+    RandomizerState& state = g_Randomizer->state_;
+    int32_t* inventory = ttyd::evt_badgeshop::badge_bottakuru100_table;
+    if (state.UsesKeyedStreams()) {
+        // The stock only depends on the seed and floor, so restarting its
+        // stream gives the same stock every time the floor is loaded.
+        state.RestartStream(RandomizerState::RNG_CHARLIETON_STOCK);
+        for (int32_t type = 0; type < 3; ++type) {
+            PickUniqueRandomItems(
+                static_cast<ItemPool::e>(type), kNumCharlietonItemsPerType,
+                inventory + type * kNumCharlietonItemsPerType,
+                /* force_no_partner = */
+                state.disable_partner_badges_in_shop_,
+                RandomizerState::RNG_CHARLIETON_STOCK);
+        }
+        return;
+    }
+    
     // Before setting stock, check if reloading an existing save file;
     // if so, set the RNG state to what it was at the start of the floor
     // so Charlieton's stock is the same as it was before.
-    RandomizerState& state = g_Randomizer->state_;
     const int32_t current_rng_state = state.rng_state_;
     if (g_Randomizer->state_.load_from_save_) {
         g_Randomizer->state_.rng_state_ = state.saved_rng_state_;
     }
     
     // Fill in Charlieton's expanded inventory.
-    int32_t* inventory = ttyd::evt_badgeshop::badge_bottakuru100_table;
-    for (int32_t i = 0; i < kNumCharlietonItemsPerType * 3; ++i) {
-        bool found = true;
-        while (found) {
-            found = false;
-            int32_t item = PickRandomItem(
-                /* seeded = */ true,
-                i / kNumCharlietonItemsPerType == 0,
-                i / kNumCharlietonItemsPerType == 1, 
-                i / kNumCharlietonItemsPerType == 2, 
-                0,
-                /* force_no_partner = */ state.disable_partner_badges_in_shop_);
-            // Make sure no duplicate items exist.
-            for (int32_t j = 0; j < i; ++j) {
-                if (inventory[j] == item) {
-                    found = true;
-                    break;
+    if (state.rng_generation_ >= RandomizerState::RNG_GEN_UNIQUE_DRAWS) {
+        for (int32_t type = 0; type < 3; ++type) {
+            PickUniqueRandomItems(
+                static_cast<ItemPool::e>(type), kNumCharlietonItemsPerType,
+                inventory + type * kNumCharlietonItemsPerType,
+                /* force_no_partner = */
+                state.disable_partner_badges_in_shop_);
+        }
+    } else {
+        // Files from before RNG_GEN_UNIQUE_DRAWS re-roll duplicates instead,
+        // to keep the same stock as when they were created.
+        for (int32_t i = 0; i < kNumCharlietonItemsPerType * 3; ++i) {
+            bool found = true;
+            while (found) {
+                found = false;
+                int32_t item = PickRandomItem(
+                    /* seeded = */ true,
+                    i / kNumCharlietonItemsPerType == 0,
+                    i / kNumCharlietonItemsPerType == 1, 
+                    i / kNumCharlietonItemsPerType == 2, 
+                    0,
+                    /* force_no_partner = */
+                    state.disable_partner_badges_in_shop_);
+                // Make sure no duplicate items exist.
+                for (int32_t j = 0; j < i; ++j) {
+                    if (inventory[j] == item) {
+                        found = true;
+                        break;
+                    }
                 }
+                inventory[i] = item;
             }
-            inventory[i] = item;
         }
     }
     
@@ -1820,7 +2002,9 @@ void ApplyEnemyStatChangePatches() {
     g_BtlUnit_Entry_trampoline = patch::hookFunction(
         ttyd::battle_unit::BtlUnit_Entry, [](BattleUnitSetup* unit_setup) {
             AlterUnitKindParams(unit_setup->unit_kind_params);
-            return g_BtlUnit_Entry_trampoline(unit_setup);
+            BattleWorkUnit* unit = g_BtlUnit_Entry_trampoline(unit_setup);
+            if (unit) ShadowEnemyUnitStats(unit);
+            return unit;
         });
         
     g_BattleCalculateDamage_trampoline = patch::hookFunction(
@@ -1907,8 +2091,7 @@ void ApplyWeaponLevelSelectionPatches() {
         ttyd::battle_ac::BattleActionCommandCheckDefence,
         [](BattleWorkUnit* unit, BattleWeapon* weapon) {
             // Run normal logic if option turned off.
-            if (!(g_Randomizer->state_.options_ 
-                    & RandomizerState::SUPERGUARDS_COST_FP)) {
+            if (!g_Randomizer->state_.options_snapshot_.superguards_cost_fp) {
                 return g_BattleActionCommandCheckDefence_trampoline(unit, weapon);
             }
             
@@ -2811,17 +2994,16 @@ void ApplyMiscPatches() {
         reinterpret_cast<void*>(kCrashHandlerFontScaleAddr),
         &kCrashHandlerNewFontScale, sizeof(float));
 
-    // Make the crash handler text loop.
-    const uint32_t kCrashHandlerLoopHookAddr1 = 0x8025e4a4;
-    const uint32_t kCrashHandlerLoopHookAddr2 = 0x8025e4a8;
-    const uint32_t kCrashHandlerLoopOpcode1 = 0x3b400000;   // li r26, 0
-    const uint32_t kCrashHandlerLoopOpcode2 = 0x4bfffdd4;   // b -0x22c
-    mod::patch::writePatch(
-        reinterpret_cast<void*>(kCrashHandlerLoopHookAddr1),
-        &kCrashHandlerLoopOpcode1, sizeof(uint32_t));
-    mod::patch::writePatch(
-        reinterpret_cast<void*>(kCrashHandlerLoopHookAddr2),
-        &kCrashHandlerLoopOpcode2, sizeof(uint32_t));
+    // Make the crash handler text loop, freezing the flight recorder (with
+    // the crashed context) the first time through.
+    const uint32_t kCrashHandlerLoopHookAddr = 0x8025e4a4;
+    const uint32_t kCrashHandlerLoopStartAddr = 0x8025e27c;
+    mod::patch::writeBranch(
+        reinterpret_cast<void*>(kCrashHandlerLoopHookAddr),
+        reinterpret_cast<void*>(StartCrashHandlerLoop));
+    mod::patch::writeBranch(
+        reinterpret_cast<void*>(BranchBackCrashHandlerLoop),
+        reinterpret_cast<void*>(kCrashHandlerLoopStartAddr));
         
     // Fix msgWindow off-by-one allocation error.
     const uint32_t kMsgWindowGetSizeToAllocAddr = 0x800816f4;
@@ -2950,6 +3132,18 @@ void ApplyMiscPatches() {
             if (!result) result = CheckIfPlayerDefeated();
             return result;
         });
+        
+    // Label custom scripts in the evt profiler (only in profiling builds).
+    EVT_PROFILER_REGISTER(PartnerFanfareEvt);
+    EVT_PROFILER_REGISTER(ChestOpenEvt);
+    EVT_PROFILER_REGISTER(BossSetupEvt);
+    EVT_PROFILER_REGISTER(DisabledBeroEvt);
+    EVT_PROFILER_REGISTER(FloorIncrementEvt);
+    EVT_PROFILER_REGISTER(PitStartPipeEvt);
+    EVT_PROFILER_REGISTER(PrePitRoomLoopEvt);
+    EVT_PROFILER_REGISTER(EnemyNpcSetupEvt);
+    EVT_PROFILER_REGISTER(CharlietonInvFullEvt);
+    EVT_PROFILER_REGISTER(DodgyFogFlurrieEvt);
 }
 
 EVT_DEFINE_USER_FUNC(InitOptionsOnPitEntry) {
@@ -3147,7 +3341,8 @@ EVT_DEFINE_USER_FUNC(GetNumChestRewards) {
         if (g_Randomizer->state_.floor_ % 50 == 49) ++num_rewards;
     } else {
         // Pick a number of rewards randomly from 1 ~ 5.
-        num_rewards = g_Randomizer->state_.Rand(5) + 1;
+        num_rewards = g_Randomizer->state_.Rand(
+            5, RandomizerState::RNG_NUM_CHEST_REWARDS) + 1;
     }
     evtSetValue(evt, evt->evtArguments[0], num_rewards);
     return 2;
@@ -3172,13 +3367,17 @@ EVT_DEFINE_USER_FUNC(CheckPromptSave) {
     if (g_PromptSave) {
         g_Randomizer->state_.SaveCurrentTime();
         g_Randomizer->state_.Save();
+        run_telemetry::Flush();
         g_PromptSave = false;
     }
     return 2;
 }
 
 EVT_DEFINE_USER_FUNC(IncrementInfinitePitFloor) {
+    run_telemetry::EndFloor(g_Randomizer->state_.floor_);
     int32_t actual_floor = ++g_Randomizer->state_.floor_;
+    flight_recorder::RecordFloor(
+        actual_floor, g_Randomizer->state_.rng_state_);
     // Update the floor number used by the game.
     // Floors 101+ are treated as looping 81-90 nine times + 91-100.
     int32_t gsw_floor = actual_floor;
@@ -3187,11 +3386,14 @@ EVT_DEFINE_USER_FUNC(IncrementInfinitePitFloor) {
         gsw_floor += ((actual_floor / 10) % 10 == 9) ? 90 : 80;
     }
     ttyd::swdrv::swByteSet(1321, gsw_floor);
+    // Log the time taken for each set of 10 floors.
+    if (actual_floor % 10 == 0) g_Randomizer->state_.RecordFloorSplit();
     return 2;
 }
 
 EVT_DEFINE_USER_FUNC(IncrementYoshiColor) {
     g_Randomizer->state_.options_ |= RandomizerState::YOSHI_COLOR_SELECT;
+    g_Randomizer->state_.UpdateOptionsSnapshot();
     int32_t color = ttyd::mario_pouch::pouchGetPartyColor(4);
     ttyd::mario_pouch::pouchSetPartyColor(4, (color + 1) % 7);
     return 2;
@@ -0,0 +1,82 @@
+#include "randomizer_practice.h"
+
+#include "common_functions.h"
+#include "randomizer.h"
+#include "randomizer_state.h"
+
+#include <ttyd/mario_pouch.h>
+#include <ttyd/mariost.h>
+#include <ttyd/seq_mapchange.h>
+#include <ttyd/seqdrv.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::pit_randomizer {
+
+namespace {
+
+using ::ttyd::mario_pouch::PouchData;
+using ::ttyd::mariost::MarioSt_Globals;
+using ::ttyd::seqdrv::SeqIndex;
+
+struct PracticeSnapshot {
+    PouchData           pouch;
+    RandomizerState     state;
+    int32_t             gsw0;
+    uint8_t             gswf[sizeof(MarioSt_Globals::gswf)];
+    uint8_t             gsw[sizeof(MarioSt_Globals::gsw)];
+    // The map and entrance to re-enter the floor from.
+    char                map[16];
+    char                bero[16];
+};
+
+PracticeSnapshot g_Snapshot;
+bool g_SnapshotValid = false;
+
+}
+
+void SavePracticeSnapshot() {
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    g_Randomizer->state_.FlushPlayStats();
+    memcpy(&g_Snapshot.pouch, ttyd::mario_pouch::pouchGetPtr(),
+           sizeof(PouchData));
+    memcpy(&g_Snapshot.state, &g_Randomizer->state_, sizeof(RandomizerState));
+    g_Snapshot.gsw0 = mario_st->gsw0;
+    memcpy(g_Snapshot.gswf, mario_st->gswf, sizeof(g_Snapshot.gswf));
+    memcpy(g_Snapshot.gsw, mario_st->gsw, sizeof(g_Snapshot.gsw));
+    strncpy(g_Snapshot.map, ttyd::seq_mapchange::NextMap,
+            sizeof(g_Snapshot.map) - 1);
+    strncpy(g_Snapshot.bero, ttyd::seq_mapchange::NextBero,
+            sizeof(g_Snapshot.bero) - 1);
+    g_SnapshotValid = true;
+}
+
+void ClearPracticeSnapshot() {
+    g_SnapshotValid = false;
+}
+
+bool RestorePracticeSnapshot() {
+    // Only restore from normal field gameplay (not mid-battle / map change).
+    if (!g_SnapshotValid || !InMainGameModes() || 
+        !CheckSeq(SeqIndex::kGame)) {
+        return false;
+    }
+    
+    // The RNG state is restored along with the rest of the randomizer state,
+    // so the floor's enemies and Charlieton's stock are picked identically.
+    auto* mario_st = ttyd::mariost::g_MarioSt;
+    memcpy(ttyd::mario_pouch::pouchGetPtr(), &g_Snapshot.pouch,
+           sizeof(PouchData));
+    memcpy(&g_Randomizer->state_, &g_Snapshot.state, sizeof(RandomizerState));
+    g_Randomizer->state_.ClearPendingPlayStats();
+    mario_st->gsw0 = g_Snapshot.gsw0;
+    memcpy(mario_st->gswf, g_Snapshot.gswf, sizeof(g_Snapshot.gswf));
+    memcpy(mario_st->gsw, g_Snapshot.gsw, sizeof(g_Snapshot.gsw));
+    
+    ttyd::seqdrv::seqSetSeq(
+        SeqIndex::kMapChange, g_Snapshot.map, g_Snapshot.bero);
+    return true;
+}
+
+}
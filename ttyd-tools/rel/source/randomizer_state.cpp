@@ -2,13 +2,13 @@
 
 #include "common_functions.h"
 #include "common_types.h"
-#include "patch.h"
+#include "flight_recorder.h"
+#include "platform.h"
 #include "randomizer.h"
+#include "rng_trace.h"
 
-#include <gc/OSTime.h>
 #include <ttyd/item_data.h>
 #include <ttyd/mario_pouch.h>
-#include <ttyd/mariost.h>
 
 #include <cinttypes>
 #include <cstdio>
@@ -22,14 +22,145 @@ using ::ttyd::mario_pouch::PouchData;
 namespace ItemType = ::ttyd::item_data::ItemType;
 
 const char* GetSavefileName() {
-    return ttyd::mariost::g_MarioSt->saveFileName;
+    return platform::GetMarioSt()->saveFileName;
 }
 
 void* GetSavedStateLocation() {
     // Store randomizer state in stored items space, since this won't be used,
     // and the first byte of any possible stored item produces a "version" of 0.
     // Starts at index 1 to align to 4-byte boundary.
-    return &ttyd::mario_pouch::pouchGetPtr()->stored_items[1];
+    return &platform::GetPouch()->stored_items[1];
+}
+
+// Size of the portion of RandomizerState stored in the save file.
+constexpr const uint32_t kSavedStateSize =
+    offsetof(RandomizerState, options_snapshot_);
+
+// Splits are stored in tenths of a second (OSTicks are 40.5M / sec).
+constexpr const int64_t kTicksPerSplitUnit = 4'050'000;
+// Every split takes at least two bytes, so no more than this many can fit.
+constexpr const int32_t kMaxSplits = sizeof(PouchData::email_ids) / 2;
+// Maximum number of splits shown on the play stats kanban.
+constexpr const int32_t kMaxSplitsShown = 8;
+
+// RTA and in-battle time, in tenths of a second.
+struct SplitTimes {
+    uint32_t rta;
+    uint32_t battle;
+};
+
+// Location of each stored play stat in play_stats_ (as a big-endian integer),
+// and the maximum value it can hold; indexed by PlayStats.
+struct PlayStatLayout {
+    int32_t offset;
+    int32_t length;
+    int32_t max;
+};
+constexpr const PlayStatLayout kPlayStatLayouts[] = {
+    { 0, 3, 9'999'999 },    // TURNS_SPENT
+    { 3, 2, 9'999 },        // TIMES_RAN_AWAY
+    { 5, 3, 9'999'999 },    // ENEMY_DAMAGE
+    { 8, 3, 9'999'999 },    // PLAYER_DAMAGE
+    { 11, 2, 9'999 },       // ITEMS_USED
+    { 13, 3, 9'999'999 },   // COINS_EARNED
+    { 16, 3, 9'999'999 },   // COINS_SPENT
+};
+constexpr const int32_t kNumStoredPlayStats =
+    sizeof(kPlayStatLayouts) / sizeof(kPlayStatLayouts[0]);
+
+// Play stat increments not yet written to play_stats_; these are batched, since
+// some are incremented several times per attack (see FlushPlayStats).
+int32_t g_PendingPlayStats[kNumStoredPlayStats] = { 0 };
+
+int32_t ReadPlayStat(const uint8_t* play_stats, const PlayStatLayout& layout) {
+    int32_t result = 0;
+    for (int32_t i = layout.offset; i < layout.offset + layout.length; ++i) {
+        result = (result << 8) + play_stats[i];
+    }
+    return result;
+}
+
+// Whether the cached string from GetLastSplitString needs to be rebuilt.
+bool g_LastSplitStringDirty = true;
+
+uint8_t* GetSplitLogLocation() {
+    // Store the split log in the e-mail id table, since e-mails are never
+    // received in the Pit.
+    return reinterpret_cast<uint8_t*>(
+        platform::GetPouch()->email_ids);
+}
+
+// Writes a value as a varint (7 bits per byte, least significant first, with
+// the high bit set on all bytes but the last). Returns nullptr if out of room.
+uint8_t* WriteVarint(uint32_t val, uint8_t* out, const uint8_t* end) {
+    for (; out < end; val >>= 7) {
+        if (val < 0x80) {
+            *out++ = val;
+            return out;
+        }
+        *out++ = (val & 0x7f) | 0x80;
+    }
+    return nullptr;
+}
+
+// Reads a varint written by WriteVarint; returns nullptr if malformed.
+const uint8_t* ReadVarint(const uint8_t* in, const uint8_t* end, uint32_t* val) {
+    *val = 0;
+    for (int32_t shift = 0; in < end && shift < 32; shift += 7) {
+        const uint8_t byte = *in++;
+        *val |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return in;
+    }
+    return nullptr;
+}
+
+// The split log consists of the cumulative times at the start of the first
+// logged set of floors, followed by the time taken for each set since.
+bool DecodeSplitLog(int32_t count, SplitTimes* anchor, SplitTimes* splits) {
+    const uint8_t* ptr = GetSplitLogLocation();
+    const uint8_t* end = ptr + sizeof(PouchData::email_ids);
+    if (count > kMaxSplits) return false;
+    for (int32_t i = -1; i < count; ++i) {
+        SplitTimes* times = i < 0 ? anchor : &splits[i];
+        if (!(ptr = ReadVarint(ptr, end, &times->rta)) ||
+            !(ptr = ReadVarint(ptr, end, &times->battle))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false if the log doesn't fit in the space available.
+bool EncodeSplitLog(
+    int32_t count, const SplitTimes& anchor, const SplitTimes* splits) {
+    uint8_t* ptr = GetSplitLogLocation();
+    const uint8_t* end = ptr + sizeof(PouchData::email_ids);
+    for (int32_t i = -1; i < count; ++i) {
+        const SplitTimes& times = i < 0 ? anchor : splits[i];
+        if (!(ptr = WriteVarint(times.rta, ptr, end)) ||
+            !(ptr = WriteVarint(times.battle, ptr, end))) {
+            return false;
+        }
+    }
+    memset(ptr, 0, end - ptr);
+    return true;
+}
+
+// Prints a split in tenths of a second in H:MM:SS.s or M:SS.s format.
+// Returns the number of characters printed to the string.
+int32_t SplitToFmtString(uint32_t val, char* out_buf) {
+    const uint32_t hours   = val / (60 * 60 * 10);
+    const uint32_t minutes = val / (60 * 10) % 60;
+    const uint32_t seconds = val / 10 % 60;
+    const uint32_t tenths  = val % 10;
+    if (hours) {
+        return sprintf(
+            out_buf, "%" PRIu32 ":%02" PRIu32 ":%02" PRIu32 ".%" PRIu32,
+            hours, minutes, seconds, tenths);
+    }
+    return sprintf(
+        out_buf, "%" PRIu32 ":%02" PRIu32 ".%" PRIu32,
+        minutes, seconds, tenths);
 }
 
 // Updates partners' Ultra Rank max HP based how many times each partner
@@ -38,7 +169,7 @@ void InitPartyMaxHpTable(uint8_t* partner_upgrades) {
     static constexpr const int16_t kDefaultUltraRankMaxHp[] = {
         30, 25, 40, 30, 35, 30, 25
     };
-    int16_t* hp_table = ttyd::mario_pouch::_party_max_hp_table + 4;
+    int16_t* hp_table = platform::GetPartyMaxHpTable() + 4;
     for (int32_t i = 0; i < 7; ++i) {
         int32_t hp = kDefaultUltraRankMaxHp[i] +
             (partner_upgrades[i] > 2 ? (partner_upgrades[i] - 2) * 5 : 0);
@@ -50,22 +181,28 @@ void InitPartyMaxHpTable(uint8_t* partner_upgrades) {
 bool LoadFromPreviousVersion(RandomizerState* state) {
     void* saved_state = GetSavedStateLocation();
     uint8_t version = *reinterpret_cast<uint8_t*>(saved_state);
-    if (version < 1) {
+    if (version < 1 || version > 4) {
         // Version is 0 or incompatible with the current version; fail to load.
         return false;
     }
     
     // Version is compatible; load, making any adjustments necessary.
-    if (version == 2) {
-        patch::writePatch(state, saved_state, sizeof(RandomizerState));
+    if (version == 4 || version == 3) {
+        memcpy(state, saved_state, kSavedStateSize);
+    } else if (version == 2) {
+        memcpy(state, saved_state, kSavedStateSize);
+        state->rng_generation_ = RandomizerState::RNG_GEN_ORIGINAL;
     } else if (version == 1) {
-        patch::writePatch(state, saved_state, sizeof(RandomizerState));
+        memcpy(state, saved_state, kSavedStateSize);
         state->hp_multiplier_ = 100;
         state->atk_multiplier_ = 100;
         state->options_ = 2;
+        state->rng_generation_ = RandomizerState::RNG_GEN_ORIGINAL;
     }
     
-    state->version_ = 2;
+    state->version_ = 4;
+    state->ResetStreams();
+    state->UpdateOptionsSnapshot();
     InitPartyMaxHpTable(state->partner_upgrades_);
     return true;
 }
@@ -73,13 +210,19 @@ bool LoadFromPreviousVersion(RandomizerState* state) {
 }
 
 bool RandomizerState::Load(bool new_save) {
+    g_LastSplitStringDirty = true;
+    ClearPendingPlayStats();
     if (!new_save) return LoadFromPreviousVersion(this);
     
-    version_ = 2;
+    version_ = 4;
+    rng_generation_ = RNG_GEN_CURRENT;
     floor_ = 0;
     reward_flags_ = 0x00000000;
     load_from_save_ = false;
     disable_partner_badges_in_shop_ = true;
+    split_log_first_set_ = 0;
+    split_log_count_ = 0;
+    memset(GetSplitLogLocation(), 0, sizeof(PouchData::email_ids));
     for (int32_t i = 0; i < 7; ++i) partner_upgrades_[i] = 0;
     InitPartyMaxHpTable(partner_upgrades_);
     
@@ -101,10 +244,10 @@ bool RandomizerState::Load(bool new_save) {
         !strcmp(filename, "random\xd0") || !strcmp(filename, "Random\xd0") ||
         !strcmp(filename, "RANDOM\xd0") || !strcmp(filename, "\xde\xd0")) { 
         char filenameChars[9];
-        rng_state_ = static_cast<uint32_t>(gc::OSTime::OSGetTime());
+        rng_state_ = static_cast<uint32_t>(platform::GetTime());
         for (int32_t i = 0; i < 8; ++i) {
             // Pick uppercase / lowercase characters randomly (excluding I / l).
-            int32_t ch = Rand(50);
+            int32_t ch = Rand(50, RNG_FILENAME);
             if (ch < 25) {
                 filenameChars[i] = ch + 'a';
                 if (filenameChars[i] == 'l') filenameChars[i] = 'z';
@@ -120,13 +263,15 @@ bool RandomizerState::Load(bool new_save) {
         // Copy generated filename to MarioSt.
         strcpy(const_cast<char*>(filename), filenameChars);
     }
+    UpdateOptionsSnapshot();
     SeedRng(filename);    
     return true;
 }
 
 void RandomizerState::Save() {
+    FlushPlayStats();
     void* saved_state = GetSavedStateLocation();
-    patch::writePatch(saved_state, this, sizeof(RandomizerState));
+    memcpy(saved_state, this, kSavedStateSize);
 }
 
 void RandomizerState::SeedRng(const char* str) {
@@ -135,15 +280,59 @@ void RandomizerState::SeedRng(const char* str) {
         hash = 37 * hash + *c;
     }
     rng_state_ = hash;
+    if (UsesKeyedStreams()) seed_ = hash;
+    ResetStreams();
+    flight_recorder::RecordSeed(hash);
+    // Start a new trace whenever the RNG is reseeded (e.g. on a new file).
+    rng_trace::Reset();
+}
+
+uint32_t RandomizerState::Rand(uint32_t range, RngSource source) {
+    uint32_t* state = &rng_state_;
+    // The filename is picked before the file is seeded, so always uses the
+    // shared state, as do untagged calls.
+    if (UsesKeyedStreams() && source != RNG_UNTAGGED &&
+        source != RNG_FILENAME && source < RNG_NUM_SOURCES) {
+        state = &stream_states_[source];
+        if (stream_floors_[source] != floor_) {
+            stream_floors_[source] = floor_;
+            *state = StreamSeed(seed_, floor_, source);
+        }
+    }
+    *state = *state * 0x41c64e6d + 12345;
+    const uint32_t result = ((*state >> 16) & 0x7fff) % range;
+    rng_trace::Record(source, floor_, range, result, *state);
+    return result;
+}
+
+bool RandomizerState::UsesKeyedStreams() const {
+    return rng_generation_ >= RNG_GEN_KEYED_STREAMS;
 }
 
-uint32_t RandomizerState::Rand(uint32_t range) {
-    rng_state_ = rng_state_ * 0x41c64e6d + 12345;
-    return ((rng_state_ >> 16) & 0x7fff) % range;
+uint32_t RandomizerState::StreamSeed(
+    uint32_t seed, int32_t floor, RngSource source) {
+    // Mixes the key with a 32-bit integer hash, so neighboring floors and
+    // sources start from unrelated states.
+    uint32_t x = seed ^ (static_cast<uint32_t>(floor) * 0x9e3779b9U) ^
+        (static_cast<uint32_t>(source) * 0x85ebca6bU);
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+void RandomizerState::ResetStreams() {
+    for (int32_t i = 0; i < RNG_NUM_SOURCES; ++i) stream_floors_[i] = -1;
+}
+
+void RandomizerState::RestartStream(RngSource source) {
+    stream_floors_[source] = -1;
 }
 
 void RandomizerState::ChangeOption(int32_t option, int32_t change) {
-    PouchData& pouch = *ttyd::mario_pouch::pouchGetPtr();
+    PouchData& pouch = *platform::GetPouch();
     
     switch (option) {
         case NUM_CHEST_REWARDS: {
@@ -177,10 +366,10 @@ void RandomizerState::ChangeOption(int32_t option, int32_t change) {
                 }
             } else {
                 // Re-add starter items.
-                ttyd::mario_pouch::pouchGetItem(ItemType::THUNDER_BOLT);
-                ttyd::mario_pouch::pouchGetItem(ItemType::FIRE_FLOWER);
-                ttyd::mario_pouch::pouchGetItem(ItemType::HONEY_SYRUP);
-                ttyd::mario_pouch::pouchGetItem(ItemType::MUSHROOM);
+                platform::PouchGetItem(ItemType::THUNDER_BOLT);
+                platform::PouchGetItem(ItemType::FIRE_FLOWER);
+                platform::PouchGetItem(ItemType::HONEY_SYRUP);
+                platform::PouchGetItem(ItemType::MUSHROOM);
             }
             break;
         }
@@ -235,6 +424,29 @@ void RandomizerState::ChangeOption(int32_t option, int32_t change) {
             break;
         }
     }
+    UpdateOptionsSnapshot();
+}
+
+void RandomizerState::UpdateOptionsSnapshot() {
+    OptionsSnapshot& snapshot = options_snapshot_;
+    snapshot.hp_multiplier = hp_multiplier_;
+    snapshot.atk_multiplier = atk_multiplier_;
+    snapshot.num_chest_rewards = GetOptionValue(NUM_CHEST_REWARDS);
+    snapshot.switch_party_cost_fp = GetOptionValue(SWITCH_PARTY_COST_FP);
+    snapshot.battle_reward_mode = GetOptionValue(BATTLE_REWARD_MODE);
+    snapshot.merlee = GetOptionValue(MERLEE);
+    snapshot.superguards_cost_fp = GetOptionValue(SUPERGUARDS_COST_FP);
+    snapshot.no_exp_mode = GetOptionValue(NO_EXP_MODE);
+    snapshot.start_with_fx = GetOptionValue(START_WITH_FX);
+    snapshot.start_with_no_items = GetOptionValue(START_WITH_NO_ITEMS);
+    snapshot.yoshi_color_select = GetOptionValue(YOSHI_COLOR_SELECT);
+    snapshot.shine_sprites_mario = GetOptionValue(SHINE_SPRITES_MARIO);
+    snapshot.always_enable_audience = GetOptionValue(ALWAYS_ENABLE_AUDIENCE);
+    snapshot.weaker_rush_badges = GetOptionValue(WEAKER_RUSH_BADGES);
+    snapshot.post_100_hp_scaling = GetOptionValue(POST_100_HP_SCALING);
+    snapshot.post_100_atk_scaling = GetOptionValue(POST_100_ATK_SCALING);
+    snapshot.start_with_partners = GetOptionValue(START_WITH_PARTNERS);
+    snapshot.start_with_sweet_treat = GetOptionValue(START_WITH_SWEET_TREAT);
 }
 
 int32_t RandomizerState::GetOptionValue(int32_t option) const {
@@ -436,113 +648,41 @@ bool RandomizerState::StarPowerEnabled() const {
 }
 
 void RandomizerState::IncrementPlayStat(PlayStats stat, int32_t amount) {
-    int32_t offset, length, max;
-    switch (stat) {
-        case TURNS_SPENT: {
-            offset = 0;
-            length = 3;
-            max = 9'999'999;
-            break;
-        }
-        case TIMES_RAN_AWAY: {
-            offset = 3;
-            length = 2;
-            max = 9999;
-            break;
-        }
-        case ENEMY_DAMAGE: {
-            offset = 5;
-            length = 3;
-            max = 9'999'999;
-            break;
-        }
-        case PLAYER_DAMAGE: {
-            offset = 8;
-            length = 3;
-            max = 9'999'999;
-            break;
-        }
-        case ITEMS_USED: {
-            offset = 11;
-            length = 2;
-            max = 9999;
-            break;
-        }
-        case COINS_EARNED: {
-            offset = 13;
-            length = 3;
-            max = 9'999'999;
-            break;
-        }
-        case COINS_SPENT: {
-            offset = 16;
-            length = 3;
-            max = 9'999'999;
-            break;
-        }
-        default: return;
-    }
-    int32_t current = 0;
-    for (int32_t i = offset; i < offset + length; ++i) {
-        current = (current << 8) + play_stats_[i];
-    }
-    current += amount;
-    if (current > max) current = max;
-    for (int32_t i = offset + length - 1; i >= offset; --i) {
-        play_stats_[i] = current & 0xff;
-        current >>= 8;
-    }
+    // Only accumulated here; written to play_stats_ by FlushPlayStats.
+    if (stat < 0 || stat >= kNumStoredPlayStats) return;
+    g_PendingPlayStats[stat] += amount;
 }
 
 int32_t RandomizerState::GetPlayStat(PlayStats stat) const {
-    int32_t offset, length;
-    switch (stat) {
-        case TURNS_SPENT: {
-            offset = 0;
-            length = 3;
-            break;
-        }
-        case TIMES_RAN_AWAY: {
-            offset = 3;
-            length = 2;
-            break;
-        }
-        case ENEMY_DAMAGE: {
-            offset = 5;
-            length = 3;
-            break;
-        }
-        case PLAYER_DAMAGE: {
-            offset = 8;
-            length = 3;
-            break;
-        }
-        case ITEMS_USED: {
-            offset = 11;
-            length = 2;
-            break;
-        }
-        case COINS_EARNED: {
-            offset = 13;
-            length = 3;
-            break;
-        }
-        case COINS_SPENT: {
-            offset = 16;
-            length = 3;
-            break;
-        }
-        case SHINE_SPRITES_USED: {
-            return ttyd::mario_pouch::pouchGetPtr()->shine_sprites;
-        }
-        // Cannot be reached with a valid PlayStats type.
-        default: return 0;
+    if (stat == SHINE_SPRITES_USED) {
+        return platform::GetPouch()->shine_sprites;
     }
-    int32_t result = 0;
-    for (int32_t i = offset; i < offset + length; ++i) {
-        result = (result << 8) + play_stats_[i];
+    // Cannot be reached with a valid PlayStats type.
+    if (stat < 0 || stat >= kNumStoredPlayStats) return 0;
+    const PlayStatLayout& layout = kPlayStatLayouts[stat];
+    const int32_t result =
+        ReadPlayStat(play_stats_, layout) + g_PendingPlayStats[stat];
+    return result > layout.max ? layout.max : result;
+}
+
+void RandomizerState::FlushPlayStats() {
+    for (int32_t stat = 0; stat < kNumStoredPlayStats; ++stat) {
+        if (!g_PendingPlayStats[stat]) continue;
+        const PlayStatLayout& layout = kPlayStatLayouts[stat];
+        int32_t current =
+            ReadPlayStat(play_stats_, layout) + g_PendingPlayStats[stat];
+        if (current > layout.max) current = layout.max;
+        for (int32_t i = layout.offset + layout.length - 1;
+             i >= layout.offset; --i) {
+            play_stats_[i] = current & 0xff;
+            current >>= 8;
+        }
+        g_PendingPlayStats[stat] = 0;
     }
-    return result;
+}
+
+void RandomizerState::ClearPendingPlayStats() {
+    memset(g_PendingPlayStats, 0, sizeof(g_PendingPlayStats));
 }
 
 const char* RandomizerState::GetEncodedOptions() const {
@@ -581,8 +721,8 @@ const char* RandomizerState::GetEncodedOptions() const {
 }
 
 bool RandomizerState::GetPlayStatsString(char* out_buf) const {
-    const auto* mariost = ttyd::mariost::g_MarioSt;
-    const uint64_t current_time = gc::OSTime::OSGetTime();
+    const auto* mariost = platform::GetMarioSt();
+    const uint64_t current_time = platform::GetTime();
     const int64_t last_save_diff = 
         current_time - mariost->hllPickLastReceivedTime;
     // If the time was never initialized, or the current time is before
@@ -627,33 +767,56 @@ bool RandomizerState::GetPlayStatsString(char* out_buf) const {
     out_buf += IntegerToFmtString(GetPlayStat(COINS_SPENT), out_buf, 9'999'999);
     out_buf += sprintf(out_buf, "\nShine Sprites used: ");
     out_buf += IntegerToFmtString(GetPlayStat(SHINE_SPRITES_USED), out_buf, 999);
+    
+    // Pages 5+: RTA (and in-battle) time taken for the latest sets of floors.
+    SplitTimes anchor;
+    SplitTimes splits[kMaxSplits];
+    const int32_t count = split_log_count_;
+    if (count && DecodeSplitLog(count, &anchor, splits)) {
+        out_buf += sprintf(out_buf, "\n<k><p>Splits (in-battle time):");
+        const int32_t first =
+            count > kMaxSplitsShown ? count - kMaxSplitsShown : 0;
+        for (int32_t i = first; i < count; ++i) {
+            // Three lines per page, including the heading.
+            out_buf += sprintf(
+                out_buf, "%s", (i - first + 1) % 3 ? "\n" : "\n<k><p>");
+            const int32_t set = split_log_first_set_ + i;
+            out_buf += sprintf(
+                out_buf, "Floors %" PRId32 "-%" PRId32 ": ",
+                set * 10 + 1, set * 10 + 10);
+            out_buf += SplitToFmtString(splits[i].rta, out_buf);
+            out_buf += sprintf(out_buf, " (");
+            out_buf += SplitToFmtString(splits[i].battle, out_buf);
+            out_buf += sprintf(out_buf, ")");
+        }
+    }
     out_buf += sprintf(out_buf, "\n<k>");
     
     return true;
 }
 
 void RandomizerState::SaveCurrentTime(bool pit_start) {
-    uint64_t current_time = gc::OSTime::OSGetTime();
+    uint64_t current_time = platform::GetTime();
     // Use the otherwise unused Happy Lucky Lottery timestamps for saving
     // the last time you entered the Pit, and the last time you saved the game.
     if (pit_start) {
-        ttyd::mariost::g_MarioSt->hllSignLastReadTime = current_time;
+        platform::GetMarioSt()->hllSignLastReadTime = current_time;
     }
-    ttyd::mariost::g_MarioSt->hllPickLastReceivedTime = current_time;
+    platform::GetMarioSt()->hllPickLastReceivedTime = current_time;
 }
 
 const char* RandomizerState::GetCurrentTimeString() {
     static char buf[16];
-    const uint64_t current_time = gc::OSTime::OSGetTime();
+    const uint64_t current_time = platform::GetTime();
     const int64_t start_diff = 
-        current_time - ttyd::mariost::g_MarioSt->hllSignLastReadTime;
+        current_time - platform::GetMarioSt()->hllSignLastReadTime;
     const int64_t last_save_diff = 
-        current_time - ttyd::mariost::g_MarioSt->hllPickLastReceivedTime;
+        current_time - platform::GetMarioSt()->hllPickLastReceivedTime;
     // If the time since the last save is negative or the time was never set,
     // return the empty string and clear the timebases previously set.
-    if (last_save_diff < 0 || !ttyd::mariost::g_MarioSt->hllSignLastReadTime) {
-        ttyd::mariost::g_MarioSt->hllSignLastReadTime = 0;
-        ttyd::mariost::g_MarioSt->hllPickLastReceivedTime = 0;
+    if (last_save_diff < 0 || !platform::GetMarioSt()->hllSignLastReadTime) {
+        platform::GetMarioSt()->hllSignLastReadTime = 0;
+        platform::GetMarioSt()->hllPickLastReceivedTime = 0;
         return "";
     }
     // Otherwise, return the time since start as a string.
@@ -661,4 +824,93 @@ const char* RandomizerState::GetCurrentTimeString() {
     return buf;
 }
 
+void RandomizerState::RecordFloorSplit() {
+    const auto* mariost = platform::GetMarioSt();
+    const int64_t start_diff = 
+        platform::GetTime() - mariost->hllSignLastReadTime;
+    // Don't record splits if the RTA timer was never started or is invalid.
+    if (start_diff < 0 || !mariost->hllSignLastReadTime) return;
+    
+    SplitTimes current;
+    current.rta = start_diff / kTicksPerSplitUnit;
+    current.battle = (
+        mariost->animationTimeIncludingBattle - mariost->animationTimeNoBattle)
+        / kTicksPerSplitUnit;
+    const int32_t set = floor_ / 10 - 1;
+    
+    SplitTimes anchor;
+    SplitTimes splits[kMaxSplits];
+    int32_t count = split_log_count_;
+    if (!DecodeSplitLog(count, &anchor, splits) ||
+        set != split_log_first_set_ + count) {
+        // The log is missing earlier splits (e.g. it was started on a file
+        // from before splits were tracked); start over from this set.
+        count = 0;
+        if (set == 0) {
+            anchor = { 0, 0 };
+            split_log_first_set_ = 0;
+        } else {
+            anchor = current;
+            split_log_first_set_ = set + 1;
+        }
+    }
+    if (set == split_log_first_set_ + count) {
+        // Convert the current cumulative times to the time taken for the set.
+        SplitTimes previous = anchor;
+        for (int32_t i = 0; i < count; ++i) {
+            previous.rta += splits[i].rta;
+            previous.battle += splits[i].battle;
+        }
+        if (count == kMaxSplits) {
+            anchor.rta += splits[0].rta;
+            anchor.battle += splits[0].battle;
+            memmove(splits, splits + 1, --count * sizeof(SplitTimes));
+            ++split_log_first_set_;
+        }
+        splits[count].rta = 
+            current.rta > previous.rta ? current.rta - previous.rta : 0;
+        splits[count].battle = 
+            current.battle > previous.battle ? 
+            current.battle - previous.battle : 0;
+        ++count;
+    }
+    // Drop the oldest splits into the anchor until the log fits.
+    while (!EncodeSplitLog(count, anchor, splits) && count > 0) {
+        anchor.rta += splits[0].rta;
+        anchor.battle += splits[0].battle;
+        memmove(splits, splits + 1, --count * sizeof(SplitTimes));
+        ++split_log_first_set_;
+    }
+    split_log_count_ = count;
+    g_LastSplitStringDirty = true;
+}
+
+const char* RandomizerState::GetLastSplitString() {
+    static char buf[48];
+    if (!g_LastSplitStringDirty) return buf;
+    g_LastSplitStringDirty = false;
+    buf[0] = '\0';
+    
+    SplitTimes anchor;
+    SplitTimes splits[kMaxSplits];
+    const int32_t count = split_log_count_;
+    if (!count || !DecodeSplitLog(count, &anchor, splits)) return buf;
+    
+    // Print the latest split, and how it compares to the one before it.
+    const int32_t set = split_log_first_set_ + count - 1;
+    const uint32_t latest = splits[count - 1].rta;
+    char* ptr = buf;
+    ptr += sprintf(
+        ptr, "Fl. %" PRId32 "-%" PRId32 ": ", set * 10 + 1, set * 10 + 10);
+    ptr += SplitToFmtString(latest, ptr);
+    if (count > 1) {
+        const uint32_t previous = splits[count - 2].rta;
+        ptr += sprintf(ptr, " (%c", latest > previous ? '+' : '-');
+        ptr += SplitToFmtString(
+            latest > previous ? latest - previous : previous - latest, ptr);
+        ptr += sprintf(ptr, ")");
+    }
+    return buf;
+}
+
 }
\ No newline at end of file
@@ -1,12 +1,10 @@
 #include "randomizer_strings.h"
 
+#include "platform.h"
 #include "randomizer.h"
 #include "randomizer_data.h"
 #include "randomizer_state.h"
 
-#include <ttyd/mario_pouch.h>
-#include <ttyd/mariost.h>
-
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
@@ -151,7 +149,7 @@ const char* GetYoshiTextColor() {
         RandomizerState::YOSHI_COLOR_SELECT)) {
         return kYoshiColorStrings[7];
     } else {
-        return kYoshiColorStrings[ttyd::mario_pouch::pouchGetPartyColor(4)];
+        return kYoshiColorStrings[platform::PouchGetPartyColor(4)];
     }
 }
 
@@ -159,7 +157,7 @@ const char* GetYoshiTextColor() {
     
 const char* RandomizerStrings::LookupReplacement(const char* msg_key) {
     // Do not use for more than one custom message at a time!
-    static char buf[512];
+    static char buf[1024];
     
     // Handle journal Tattle entries.
     if (strstr(msg_key, "menu_enemy_")) {
@@ -221,7 +219,7 @@ const char* RandomizerStrings::LookupReplacement(const char* msg_key) {
             sprintf(buf, "<kanban>\nYour seed: <col %sff>%s\n</col>"
                 "(Name your file \"random\" or \"\xde\"\n"
                 "to have one picked randomly.)<k>",
-                GetYoshiTextColor(), ttyd::mariost::g_MarioSt->saveFileName);
+                GetYoshiTextColor(), platform::GetMarioSt()->saveFileName);
             return buf;
         }
         case MsgKey::TIK_06_02: {
@@ -0,0 +1,67 @@
+#include "rng_trace.h"
+
+#ifdef PIT_RNG_TRACE
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::rng_trace {
+
+namespace {
+
+// Number of calls kept in the ring buffer (power of 2).
+constexpr const int32_t kNumEntries = 1024;
+
+struct TraceEntry {
+    uint16_t source;            // RandomizerState::RngSource of the call.
+    uint16_t floor;
+    uint32_t range;
+    uint32_t result;
+    uint32_t rng_state;         // RNG state after the call.
+};
+
+// Laid out for the host tool (rngtrace.py) to find in a RAM dump;
+// keep the two in sync if changing the layout.
+struct TraceBuffer {
+    uint32_t magic;             // 'RNGT'
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;             // Total calls recorded since the last reset.
+    TraceEntry entries[kNumEntries];
+};
+
+// Zero-initialized (rather than in .data) to keep it out of the REL file;
+// the header is filled in on the first call (or reset).
+TraceBuffer g_RngTrace;
+
+void WriteHeader() {
+    g_RngTrace.magic = 0x524e4754;
+    g_RngTrace.version = 1;
+    g_RngTrace.capacity = kNumEntries;
+}
+
+}
+
+void Reset() {
+    // Keeps the header, so the (empty) trace can still be found in a dump.
+    g_RngTrace.count = 0;
+    memset(g_RngTrace.entries, 0, sizeof(g_RngTrace.entries));
+    WriteHeader();
+}
+
+void Record(
+    uint32_t source, int32_t floor, uint32_t range, uint32_t result,
+    uint32_t rng_state) {
+    if (!g_RngTrace.magic) WriteHeader();
+    TraceEntry& entry = g_RngTrace.entries[g_RngTrace.count % kNumEntries];
+    entry.source = source;
+    entry.floor = floor;
+    entry.range = range;
+    entry.result = result;
+    entry.rng_state = rng_state;
+    ++g_RngTrace.count;
+}
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include "run_telemetry.h"
+
+#include "card_file.h"
+#include "heap_tracker.h"
+#include "map_events.h"
+#include "randomizer.h"
+#include "randomizer_state.h"
+
+#include <gc/OSTime.h>
+#include <ttyd/mariost.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace mod::run_telemetry {
+
+namespace {
+
+using ::mod::pit_randomizer::g_Randomizer;
+using ::mod::pit_randomizer::RandomizerState;
+
+// Number of floor records kept in the ring; a couple of 100-floor runs' worth,
+// and as many as fit (with the header) in one memory card sector.
+constexpr const int32_t kNumRecords = 255;
+// OSTime ticks per second (the bus clock / 4).
+constexpr const uint32_t kTicksPerSecond = 40'500'000;
+// Memory card file the records are written to at each save prompt, and
+// appended to across sessions.
+constexpr const char* kCardFileName = "pit_telemetry";
+// Play stats tracked per floor (in the order EndFloor reads their deltas).
+constexpr const RandomizerState::PlayStats kTrackedStats[] = {
+    RandomizerState::TURNS_SPENT,
+    RandomizerState::ENEMY_DAMAGE,
+    RandomizerState::PLAYER_DAMAGE,
+    RandomizerState::ITEMS_USED,
+    RandomizerState::COINS_EARNED,
+    RandomizerState::COINS_SPENT,
+};
+constexpr const int32_t kNumTrackedStats =
+    sizeof(kTrackedStats) / sizeof(kTrackedStats[0]);
+
+struct FloorRecord {
+    uint16_t floor;                 // 1-indexed.
+    uint8_t  num_enemies;
+    uint8_t  battle_turns;
+    uint8_t  enemies[5];            // Spawn indices; 0xff if none.
+    uint8_t  items_used;
+    uint16_t damage_dealt;
+    uint16_t damage_taken;
+    uint16_t coins_earned;
+    uint16_t coins_spent;
+    uint16_t run;                   // Which file load the floor was in.
+    uint32_t battle_ticks;          // OSTime ticks spent in battle.
+    uint32_t load_ticks;            // OSTime ticks spent loading the map.
+    uint32_t peak_heap_bytes;       // Main heap's live bytes high-water mark.
+};
+static_assert(sizeof(FloorRecord) == 0x20);
+
+// Laid out for the host tool (telemetry.py) to find in a RAM dump;
+// keep the two in sync if changing the layout.
+struct Telemetry {
+    uint32_t magic;                 // 'PTEL'
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t ticks_per_second;
+    uint32_t count;                 // Records written (next is count % cap).
+    uint32_t flushed_count;         // count as of the last save prompt.
+    uint32_t runs;                  // File loads (new or continued runs).
+    FloorRecord records[kNumRecords];
+};
+static_assert(sizeof(Telemetry) <= 0x2000);
+
+Telemetry g_Telemetry;
+// The copy read from / written to the card (so records made while a write
+// is in progress don't tear it), and the request doing so.
+Telemetry g_CardCopy;
+card_file::Request g_CardRequest;
+// Whether the card's records from earlier sessions have been read (or found
+// not to exist), and whether a Flush is waiting on a card request.
+bool g_HistoryRead = false;
+bool g_FlushQueued = false;
+
+// The record for the floor in progress, and the totals it started from.
+FloorRecord g_Current;
+int32_t g_StartStats[kNumTrackedStats];
+uint64_t g_StartBattleTicks = 0;
+// Whether the start totals need to be taken (e.g. after loading a file).
+bool g_NeedsBaseline = true;
+uint64_t g_LoadStartTime = 0;
+bool g_Loading = false;
+
+uint64_t GetBattleTicks() {
+    const auto* mario_st = ttyd::mariost::g_MarioSt;
+    return mario_st->animationTimeIncludingBattle -
+        mario_st->animationTimeNoBattle;
+}
+
+void TakeBaseline() {
+    const RandomizerState& state = g_Randomizer->state_;
+    for (int32_t i = 0; i < kNumTrackedStats; ++i) {
+        g_StartStats[i] = state.GetPlayStat(kTrackedStats[i]);
+    }
+    g_StartBattleTicks = GetBattleTicks();
+    g_NeedsBaseline = false;
+}
+
+uint32_t Clamp(int32_t value, uint32_t max) {
+    if (value < 0) return 0;
+    return static_cast<uint32_t>(value) > max ? max : value;
+}
+
+void StartWrite() {
+    g_FlushQueued = false;
+    memcpy(&g_CardCopy, &g_Telemetry, sizeof(g_Telemetry));
+    g_CardRequest.data = &g_CardCopy;
+    g_CardRequest.size = sizeof(g_CardCopy);
+    g_CardRequest.write = true;
+    card_file::Submit(&g_CardRequest);
+}
+
+void OnCardRequestDone(card_file::Request* request, bool success) {
+    if (!request->write) {
+        g_HistoryRead = true;
+        const Telemetry& card = g_CardCopy;
+        if (success && card.magic == g_Telemetry.magic &&
+            card.version == g_Telemetry.version &&
+            card.capacity == g_Telemetry.capacity) {
+            // Append the records made this session to the card's.
+            for (uint32_t i = 0; i < g_Telemetry.count; ++i) {
+                if (i + kNumRecords < g_Telemetry.count) continue;
+                FloorRecord& record =
+                    g_CardCopy.records[(card.count + i) % kNumRecords];
+                record = g_Telemetry.records[i % kNumRecords];
+                record.run += card.runs;
+            }
+            g_CardCopy.count += g_Telemetry.count;
+            g_CardCopy.flushed_count += g_Telemetry.flushed_count;
+            g_CardCopy.runs += g_Telemetry.runs;
+            memcpy(&g_Telemetry, &g_CardCopy, sizeof(g_Telemetry));
+        }
+    }
+    if (g_FlushQueued) StartWrite();
+}
+
+void OnMapLoaded(const map_events::Event& event) {
+    if (event.type != map_events::EventType::kMapLoaded) return;
+    if (g_NeedsBaseline && g_Randomizer) TakeBaseline();
+}
+
+}
+
+void Init() {
+    g_Telemetry.magic = 0x5054454c;
+    g_Telemetry.version = 2;
+    g_Telemetry.capacity = kNumRecords;
+    g_Telemetry.ticks_per_second = kTicksPerSecond;
+    g_CardRequest.name = kCardFileName;
+    g_CardRequest.on_done = OnCardRequestDone;
+    map_events::Subscribe(OnMapLoaded);
+}
+
+void OnFileLoad(bool /* new_file */) {
+    // Read the records from earlier sessions, to append to.
+    if (!g_HistoryRead && !g_CardRequest.pending) {
+        g_CardRequest.data = &g_CardCopy;
+        g_CardRequest.size = sizeof(g_CardCopy);
+        g_CardRequest.write = false;
+        card_file::Submit(&g_CardRequest);
+    }
+    g_Telemetry.count = g_Telemetry.flushed_count;
+    ++g_Telemetry.runs;
+    memset(&g_Current, 0, sizeof(g_Current));
+    g_NeedsBaseline = true;
+    g_Loading = false;
+}
+
+void OnMapLoadStep(bool done) {
+    if (!g_Loading) {
+        g_Loading = true;
+        g_LoadStartTime = gc::OSTime::OSGetTime();
+    }
+    if (done) {
+        g_Current.load_ticks += static_cast<uint32_t>(
+            gc::OSTime::OSGetTime() - g_LoadStartTime);
+        g_Loading = false;
+    }
+}
+
+void RecordEnemies(const int32_t* enemies, int32_t count) {
+    g_Current.num_enemies = count;
+    for (int32_t i = 0; i < 5; ++i) {
+        g_Current.enemies[i] = i < count ? enemies[i] : 0xff;
+    }
+}
+
+void EndFloor(int32_t floor) {
+    if (g_NeedsBaseline) TakeBaseline();
+    const RandomizerState& state = g_Randomizer->state_;
+    int32_t deltas[kNumTrackedStats];
+    for (int32_t i = 0; i < kNumTrackedStats; ++i) {
+        deltas[i] = state.GetPlayStat(kTrackedStats[i]) - g_StartStats[i];
+    }
+    g_Current.floor = floor + 1;
+    g_Current.run = g_Telemetry.runs;
+    g_Current.battle_turns = Clamp(deltas[0], 0xff);
+    g_Current.damage_dealt = Clamp(deltas[1], 0xffff);
+    g_Current.damage_taken = Clamp(deltas[2], 0xffff);
+    g_Current.items_used = Clamp(deltas[3], 0xff);
+    g_Current.coins_earned = Clamp(deltas[4], 0xffff);
+    g_Current.coins_spent = Clamp(deltas[5], 0xffff);
+    g_Current.battle_ticks =
+        static_cast<uint32_t>(GetBattleTicks() - g_StartBattleTicks);
+    g_Current.peak_heap_bytes = heap_tracker::GetLiveHighWater(0);
+
+    g_Telemetry.records[g_Telemetry.count % kNumRecords] = g_Current;
+    ++g_Telemetry.count;
+    memset(&g_Current, 0, sizeof(g_Current));
+    TakeBaseline();
+}
+
+void Flush() {
+    if (g_Telemetry.flushed_count == g_Telemetry.count) return;
+    g_Telemetry.flushed_count = g_Telemetry.count;
+    // Written once the read of the earlier sessions' records (or the last
+    // write) is done, if either's in progress.
+    g_FlushQueued = true;
+    if (!g_CardRequest.pending) StartWrite();
+}
+
+}
@@ -0,0 +1,90 @@
+# Prints or compares traces of the randomizer's RNG calls (rel/source/
+# rng_trace.cpp) from dumps of MEM1 taken while running a trace build
+# (`make RNG_TRACE=1`).
+#
+# Usage: python rngtrace.py <mem1.raw> [num_calls]
+#        python rngtrace.py <mem1.raw> <other_mem1.raw> [context]
+#
+# Comparing two dumps (e.g. from builds before and after a change, playing
+# the same file) prints the first call where the traces diverge.
+
+import sys
+import struct
+
+TRACE_MAGIC = b"RNGT"
+TRACE_VERSION = 1
+HEADER_SIZE = 4 * 4
+ENTRY_SIZE = 4 * 4
+
+# Keep in sync with RandomizerState::RngSource.
+SOURCE_NAMES = [
+	"untagged", "filename", "yoshi_color", "select_enemies", "build_battle",
+	"battle_condition", "pick_random_item", "chest_reward", "num_chest_rewards",
+	"charlieton_stock"
+]
+
+def source_name(source):
+	if source < len(SOURCE_NAMES):
+		return SOURCE_NAMES[source]
+	return "source_%d" % source
+
+def load_trace(filename):
+	mem = open(filename, "rb").read()
+	# Find the trace buffer by its magic number and version.
+	offset = 0
+	while True:
+		offset = mem.find(TRACE_MAGIC, offset)
+		if offset < 0:
+			sys.exit("No RNG trace found in %s; is this a trace build?" % filename)
+		if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == TRACE_VERSION:
+			break
+		offset += 4
+	(magic, version, capacity, count) = struct.unpack(">4s3L", mem[offset:offset+HEADER_SIZE])
+	# Returns a dict of call index -> (source, floor, range, result, rng_state),
+	# for the most recent calls still in the ring buffer.
+	calls = {}
+	for index in range(max(0, count - capacity), count):
+		entry_offset = offset + HEADER_SIZE + (index % capacity) * ENTRY_SIZE
+		calls[index] = struct.unpack(">2H3L", mem[entry_offset:entry_offset+ENTRY_SIZE])
+	return (count, calls)
+
+def format_call(index, call):
+	(source, floor, rand_range, result, rng_state) = call
+	return "%7d  fl %4d  %-18s %6d / %-6d  state %08x" % (
+		index, floor + 1, source_name(source), result, rand_range, rng_state)
+
+def print_trace(filename, num_calls):
+	(count, calls) = load_trace(filename)
+	print("%d calls recorded, %d in buffer" % (count, len(calls)))
+	for index in sorted(calls)[-num_calls:]:
+		print(format_call(index, calls[index]))
+
+def diff_traces(filename_a, filename_b, context):
+	(count_a, calls_a) = load_trace(filename_a)
+	(count_b, calls_b) = load_trace(filename_b)
+	common = sorted(set(calls_a) & set(calls_b))
+	if not common:
+		sys.exit("Traces have no calls in common (%d vs. %d calls recorded)." %
+			(count_a, count_b))
+	for pos, index in enumerate(common):
+		if calls_a[index] != calls_b[index]:
+			print("Traces diverge at call %d:" % index)
+			for before in common[max(0, pos - context):pos]:
+				print("   " + format_call(before, calls_a[before]))
+			print("a: " + format_call(index, calls_a[index]))
+			print("b: " + format_call(index, calls_b[index]))
+			mismatches = sum(1 for i in common[pos:] if calls_a[i] != calls_b[i])
+			print("%d of the %d calls from there on differ." % (mismatches, len(common) - pos))
+			return 1
+	print("Traces match for calls %d - %d." % (common[0], common[-1]))
+	if count_a != count_b:
+		print("(Traces have different lengths: %d vs. %d calls.)" % (count_a, count_b))
+		return 1
+	return 0
+
+if len(sys.argv) < 2:
+	sys.exit("Usage: python rngtrace.py <mem1.raw> [<other_mem1.raw>] [n]")
+if len(sys.argv) > 2 and not sys.argv[2].isdigit():
+	context = int(sys.argv[3]) if len(sys.argv) > 3 else 8
+	sys.exit(diff_traces(sys.argv[1], sys.argv[2], context))
+print_trace(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 64)
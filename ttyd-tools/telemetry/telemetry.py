@@ -0,0 +1,99 @@
+# Converts the mod's per-floor run telemetry (rel/source/run_telemetry.cpp)
+# from a dump of MEM1 into CSV, one row per floor, oldest first. The copy the
+# mod writes to the memory card at each save prompt (pit_telemetry, e.g.
+# exported as a .gci) can be read instead of a dump; it keeps the most recent
+# floors across sessions, with "run" telling apart each file load.
+#
+# Usage: python telemetry.py <mem1.raw|card file> [out.csv] [--data=<file>]
+#
+# Writes to stdout if no output file is given. Enemies are named using the
+# spawn order in the enemy data (defaults to ../enemygen/pit_enemies.txt).
+# Rows made after the last save prompt have saved = 0; they're discarded if
+# the save file is reloaded.
+
+import csv
+import os
+import struct
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(SCRIPT_DIR, "..", "enemygen"))
+import enemygen
+
+TELEMETRY_MAGIC = b"PTEL"
+TELEMETRY_VERSION = 2
+HEADER_SIZE = 7 * 4
+RECORD_FORMAT = ">HBB5BBHHHHHLLL"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+COLUMNS = [
+	"run", "floor", "enemies", "battle_turns", "battle_sec", "load_sec",
+	"damage_dealt", "damage_taken", "items_used", "coins_earned",
+	"coins_spent", "peak_heap_kb", "saved"
+]
+
+def find_telemetry(mem):
+	offset = 0
+	while True:
+		offset = mem.find(TELEMETRY_MAGIC, offset)
+		if offset < 0:
+			sys.exit("No run telemetry found in the dump.")
+		if offset % 4 == 0 and struct.unpack(">L", mem[offset+4:offset+8])[0] == TELEMETRY_VERSION:
+			return offset
+		offset += 4
+
+def load_spawn_names(data_file):
+	data = enemygen.EnemyData()
+	try:
+		data.parse(data_file)
+	except enemygen.DataError as e:
+		sys.exit("%s: %s" % (data_file, e))
+	return [spawn["name"] for spawn in data.spawns]
+
+def read_rows(mem, spawn_names):
+	offset = find_telemetry(mem)
+	(capacity, ticks_per_second, count, flushed_count) = struct.unpack(
+		">4L", mem[offset+8:offset+24])
+	rows = []
+	for index in range(max(0, count - capacity), count):
+		pos = offset + HEADER_SIZE + (index % capacity) * RECORD_SIZE
+		fields = struct.unpack(RECORD_FORMAT, mem[pos:pos+RECORD_SIZE])
+		(floor, num_enemies, turns) = fields[0:3]
+		enemies = fields[3:3+num_enemies]
+		(items, dealt, taken, earned, spent, run, battle_ticks, load_ticks, heap) = fields[8:]
+		rows.append([
+			run, floor,
+			" ".join(spawn_names[e] if e < len(spawn_names) else str(e) for e in enemies),
+			turns, "%.2f" % (battle_ticks / float(ticks_per_second)),
+			"%.3f" % (load_ticks / float(ticks_per_second)),
+			dealt, taken, items, earned, spent, heap >> 10,
+			int(index < flushed_count)])
+	return rows
+
+def main(argc, argv):
+	options = {}
+	args = []
+	for arg in argv[1:]:
+		if arg.startswith("--"):
+			(key, _, value) = arg[2:].partition("=")
+			options[key] = value
+		else:
+			args.append(arg)
+	if len(args) < 1 or len(args) > 2:
+		sys.exit("Usage: python telemetry.py <mem1.raw|card file> [out.csv] [--data=<file>]")
+	spawn_names = load_spawn_names(options.get(
+		"data", os.path.join(SCRIPT_DIR, "..", "enemygen", "pit_enemies.txt")))
+	mem = open(args[0], "rb").read()
+	rows = read_rows(mem, spawn_names)
+
+	out = open(args[1], "w", newline="") if len(args) > 1 else sys.stdout
+	writer = csv.writer(out)
+	writer.writerow(COLUMNS)
+	writer.writerows(rows)
+	if out is not sys.stdout:
+		out.close()
+		print("Wrote %d floors to %s." % (len(rows), args[1]))
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main(len(sys.argv), sys.argv))